@@ -28,10 +28,10 @@ public:
         return *this;
     }
 
-    void update(BOARD_TYPE *, const LifeIndex &, LifeCell & next, const QVector<int> & neighbor_indices, const LifeCell *neighbors) const
+    void update(BOARD_TYPE *, const LifeIndex &, LifeCell & next, const LifeIndex *, const int & num_neighbors, const LifeCell *neighbors) const
     {
         int num_alive_neighbors = 0;
-        for (int i = 0; i < neighbor_indices.size(); ++i)
+        for (int i = 0; i < num_neighbors; ++i)
             if (neighbors[i].alive)
                 ++num_alive_neighbors;
 
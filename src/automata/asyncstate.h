@@ -38,6 +38,7 @@ POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include "automata_global.h"
+#include "readystate.h"
 
 #include <QtGlobal>
 #include <QDataStream>
@@ -47,89 +48,54 @@ namespace Automata
 
     /// Internal state for an asynchronous automaton, which requires two copies of a cell's state,
     /// one for the previous state, and one for the next state.
-    /// Uses a seqlock when copying or assigning to ensure cross-thread consistency.
+    ///
+    /// Other threads only ever read the published copy, \c q0, and only while the ready state allows it,
+    /// so a copy is never read while it is being written:
+    ///  - At the start of a timestep (r == 0), \c q0 holds the cell's state, and \c q1 its former state.
+    ///  - The first phase computes the next state into \c q1, then sets r to 1; neighbors still read the old state in \c q0.
+    ///  - The second phase only sets r to 2, after which neighbors wait for the cell.
+    ///  - The third phase exchanges \c q0 and \c q1, then sets r back to 0.
+    ///
+    /// Use AsyncState::current() and AsyncState::former() to get at the states between steps.
     /// \param TState A cell's state.
     /// \param TIndex The index type used by the automaton.
     template <typename TState, typename TIndex>
     struct AsyncState
     {
-        quint16 _sync_0; ///< First seqlock bookend.
         TIndex index;    ///< Index in cell array.
-        TState q0;       ///< First copy of the cell's state.
-        TState q1;       ///< Second copy of the cell's state.
-        quint16 r;       ///< Used to track asynchronous updates.
-        quint16 _sync_1; ///< Second seqlock bookend.
+        TState q0;       ///< The published copy of the cell's state.
+        TState q1;       ///< The cell's next state while r is 1 or 2; its former state while r is 0.
+        ReadyState r;    ///< Used to track asynchronous updates.
 
         //@{
         /// Constructor.
-        AsyncState() : _sync_0(0), index(static_cast<TIndex>(-1)), r(0), _sync_1(0) {}
-        AsyncState(const TState & s0, const TState & s1) : _sync_0(0), index(static_cast<TIndex>(-1)), q0(s0), q1(s1), r(0), _sync_1(0) {}
-
-        /// Copy constructor; makes sure that the data is in a consistent state before it returns.
-        AsyncState(const AsyncState & state)
-            : _sync_0(0), _sync_1(0)
-        {
-            ++_sync_1;
-
-            int sync0, sync1;
-            do
-            {
-                sync0 = state._sync_0;
-                this->r = state.r;
-                this->q1 = state.q1;
-                this->q0 = state.q0;
-                this->index = state.index;
-                sync1 = state._sync_1;
-            }
-            while (sync0 != sync1);
-
-            ++_sync_0;
-        }
-
-        /// Assignment operator.  Increments the synclocks in reverse order so that a read while copying the rest of the data will fail.
-        /// Makes sure that the source data is in a consistent state...
-        AsyncState & operator= (const AsyncState & state)
-        {
-            ++_sync_1;
-
-            int sync0, sync1;
-            do
-            {
-                sync0 = state._sync_0;
-                r = state.r;
-                q1 = state.q1;
-                q0 = state.q0;
-                index = state.index;
-                sync1 = state._sync_1;
-            }
-            while (sync0 != sync1);
-
-            ++_sync_0;
-            return *this;
-        }
+        AsyncState() : index(static_cast<TIndex>(-1)), r(0) {}
+        AsyncState(const TState & s0, const TState & s1) : index(static_cast<TIndex>(-1)), q0(s0), q1(s1), r(0) {}
         //@}
 
-        /// Destructor.
-        virtual ~AsyncState() {}
+        /// Destructor.  Not virtual, so that the state does not carry a vtable pointer.
+        ~AsyncState() {}
 
         //@{
         /// The current state of the cell.
-        const TState & current() const { return q0; }
-        TState & current() { return q0; }
+        const TState & current() const { return r == 0 ? q0 : q1; }
+        TState & current() { return r == 0 ? q0 : q1; }
         //@}
 
         //@{
         /// The former state of the cell.
-        const TState & former() const { return q1; }
-        TState & former() { return q1; }
+        const TState & former() const { return r == 0 ? q1 : q0; }
+        TState & former() { return r == 0 ? q1 : q0; }
         //@}
 
         /// Write the cell's data.
         void writeBinary(QDataStream & ds, const AutomataFileVersion & file_version) const
         {
-            q0.writeBinary(ds, file_version);
-            q1.writeBinary(ds, file_version);
-            ds << r;
+            current().writeBinary(ds, file_version);
+            former().writeBinary(ds, file_version);
+
+            const quint16 ready = r;
+            ds << ready;
         }
 
         /// Read the cell's data (both previous and current states).
@@ -140,7 +106,9 @@ namespace Automata
 
             if (file_version.automata_version >= Automata::AUTOMATA_FILE_VERSION_3)
             {
-                ds >> r;
+                quint16 ready;
+                ds >> ready;
+                r = ready;
             }
             else if (file_version.automata_version >= Automata::AUTOMATA_FILE_VERSION_1)
             {
@@ -154,6 +122,10 @@ namespace Automata
                 ds >> num;
                 r = static_cast<quint8>(num);
             }
+
+            // the file holds the current state first; in the middle of a timestep that is the next state
+            if (r != 0)
+                qSwap(q0, q1);
         }
     };
 
@@ -35,7 +35,60 @@ POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include "automata_global.h"
+#include "pool.h"
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QStack>
 
 namespace Automata
 {
+
+    /// \internal Hands out thread indices, and takes them back when their threads exit.
+    struct ThreadIndices
+    {
+        QMutex lock;
+        QStack<int> free_indices;
+        int next_index;
+
+        ThreadIndices() : next_index(0) {}
+    };
+
+    Q_GLOBAL_STATIC(ThreadIndices, threadIndices)
+
+    /// \internal Held in thread-local storage; returns the thread's index when the thread exits.
+    struct ThreadIndexHolder
+    {
+        int index;
+
+        ThreadIndexHolder()
+        {
+            ThreadIndices *indices = threadIndices();
+            QMutexLocker ml(&indices->lock);
+            index = indices->free_indices.isEmpty() ? indices->next_index++ : indices->free_indices.pop();
+        }
+
+        ~ThreadIndexHolder()
+        {
+            ThreadIndices *indices = threadIndices();
+            if (indices)
+            {
+                QMutexLocker ml(&indices->lock);
+                indices->free_indices.push(index);
+            }
+        }
+    };
+
+    Q_GLOBAL_STATIC(QThreadStorage<ThreadIndexHolder *>, threadIndexHolders)
+
+    int ThreadIndex::current()
+    {
+        QThreadStorage<ThreadIndexHolder *> *holders = threadIndexHolders();
+
+        if (!holders->hasLocalData())
+            holders->setLocalData(new ThreadIndexHolder());
+
+        return holders->localData()->index;
+    }
+
 } // namespace Automata
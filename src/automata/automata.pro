@@ -13,10 +13,15 @@ DEFINES += AUTOMATA_LIBRARY
 HEADERS += automaton.h \
     automata_global.h \
     graph.h \
+    tiling.h \
     asyncstate.h \
-    pool.h
+    readystate.h \
+    pool.h \
+    steppool.h \
+    stepprofile.h
 
-SOURCES += automata.cpp
+SOURCES += automata.cpp \
+    steppool.cpp
 
 CONFIG(release, debug|release) { BUILDDIR=release }
 CONFIG(debug, debug|release) {
@@ -64,6 +64,8 @@ namespace Automata
         AUTOMATA_FILE_VERSION_1   = 1,
         AUTOMATA_FILE_VERSION_2   = 2,
         AUTOMATA_FILE_VERSION_3   = 3,
+        AUTOMATA_FILE_VERSION_4   = 4, ///< Cells as fixed-width records and edges in the frozen layout, aligned so that they can be used from a mapped file.
+        AUTOMATA_FILE_VERSION_5   = 5, ///< Cells and delta-encoded edges in compressed blocks of nodes, which can be decoded in parallel.
         AUTOMATA_NUM_FILE_VERSIONS
     };
 
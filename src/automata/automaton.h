@@ -42,9 +42,15 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "graph.h"
 #include "asyncstate.h"
 #include "pool.h"
+#include "steppool.h"
+#include "stepprofile.h"
 
 #include <QtGlobal>
-#include <QtConcurrentFilter>
+#include <QtConcurrentRun>
+#include <QElapsedTimer>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QReadWriteLock>
 #include <QReadLocker>
 #include <QWriteLocker>
@@ -55,7 +61,7 @@ namespace Automata
     /// An automaton over graphs, with asynchronous update capability.
     /// \param TState A cell's state in the automaton.
     /// \param TIndex The type used to index cells in the automaton.
-    /// \param NUM_PER_LOCK The number of cells per write lock.
+    /// \param NUM_PER_LOCK The default number of cells per chunk when stepping in parallel (see Automaton::setCellsPerChunk()).
     template <typename TState, typename TIndex = quint32, int NUM_PER_LOCK = 1000>
     class Automaton
         : public Graph<AsyncState<TState, TIndex>, TIndex>
@@ -66,28 +72,48 @@ namespace Automata
 
     private:
         typedef TState NEIGHBOR;
-        typedef QVector<NEIGHBOR> NEIGHBOR_VECTOR;
-        typedef Pool<NEIGHBOR_VECTOR> NEIGHBOR_POOL;
 
-        NEIGHBOR_POOL _temp_neighbor_pool;
+        ThreadScratch<NEIGHBOR> _temp_neighbors;
 
-        /// \internal Used in the call to <tt>QtConcurrent::filter()</tt>.
-        struct FilterFunctor
+        /// \internal Updates a range of cells for the step pool.
+        struct UpdateTask
+            : public StepPool::Task
         {
-            Automaton<TState, TIndex> & automaton;
+            Automaton<TState, TIndex, NUM_PER_LOCK> & automaton;
 
-        public:
-            FilterFunctor(Automaton<TState, TIndex> & automaton)
+            UpdateTask(Automaton<TState, TIndex, NUM_PER_LOCK> & automaton)
                 : automaton(automaton) {}
 
-            inline bool operator() (const ASYNC_STATE & cell)
+            virtual void run(const int & begin, const int & end)
             {
-                automaton.update(const_cast<ASYNC_STATE &>(cell));
-                return false;
+                int updated = 0;
+
+                ASYNC_STATE *cell = automaton._nodes.data() + begin;
+                for (int i = begin; i < end; ++i, ++cell)
+                {
+                    if (automaton.update(*cell))
+                        ++updated;
+                }
+
+                if (automaton._profiling)
+                    automaton.addStepCounts(updated, (end - begin) - updated);
             }
         };
 
-        FilterFunctor _functor;
+        UpdateTask _update_task;
+        int _cells_per_chunk;
+        StepPool *_step_pool;
+
+        bool _profiling;
+        int _profile_phase;             ///< The phase of the next step, if the automaton doesn't track its own (see Automaton::stepPhase()).
+        StepProfile _profile;
+        mutable QMutex _profile_mutex;  ///< Guards \c _profile, which the GUI may read while a step is running.
+
+        //@{
+        /// The counts for the step in progress; added to by each chunk of cells as it is done.
+        QAtomicInt _step_updated;
+        QAtomicInt _step_stalled;
+        //@}
 
     public:
         /// Constructor.
@@ -95,7 +121,13 @@ namespace Automata
         /// \param directed Whether or not the automaton's graph is directed.
         Automaton(const int initialCapacity = 0, bool directed = true)
             : Graph<ASYNC_STATE, TIndex>(initialCapacity, directed),
-              _functor(*this)
+              _update_task(*this),
+              _cells_per_chunk(NUM_PER_LOCK),
+              _step_pool(0),
+              _profiling(false),
+              _profile_phase(0),
+              _step_updated(0),
+              _step_stalled(0)
         {
         }
 
@@ -104,42 +136,162 @@ namespace Automata
         {
         }
 
+        /// \return The number of cells that a thread updates at a time when stepping in parallel.
+        /// \see Automaton::setCellsPerChunk()
+        int cellsPerChunk() const { return _cells_per_chunk; }
+
+        /// Sets the number of cells that a thread updates at a time when stepping in parallel.
+        /// A chunk's cells and edges should fit in a core's L2 cache; smaller chunks balance the load better,
+        /// but cost more to hand out.
+        /// \see Automaton::cellsPerChunk()
+        void setCellsPerChunk(const int & num) { _cells_per_chunk = qMax(num, 1); }
+
+        /// \return The pool whose threads step the automaton in parallel.
+        /// \see Automaton::setStepPool()
+        StepPool *stepPool() const { return _step_pool ? _step_pool : StepPool::globalInstance(); }
+
+        /// Sets the pool whose threads step the automaton in parallel; 0 means the global pool.
+        /// The automaton does not take ownership of the pool.
+        /// \see Automaton::stepPool()
+        void setStepPool(StepPool *pool) { _step_pool = pool; }
+
+        /// \return Whether the automaton times its steps and counts its cell updates.
+        /// \see Automaton::setProfiling()
+        bool profiling() const { return _profiling; }
+
+        /// Sets whether the automaton times its steps and counts its cell updates and stalls.
+        /// Profiling costs a timer read per step and an atomic add per chunk of cells.  Off by default.
+        /// \note Call only between steps.
+        /// \see Automaton::profiling(), Automaton::profile()
+        void setProfiling(const bool & profiling) { _profiling = profiling; }
+
+        /// \return A copy of the timings and counters gathered since the last call to Automaton::clearProfile().
+        /// Safe to call while the automaton is stepping; the profile is updated at the end of each step.
+        StepProfile profile() const
+        {
+            QMutexLocker lock(&_profile_mutex);
+            return _profile;
+        }
+
+        /// Resets the timings and counters of the profile.
+        void clearProfile()
+        {
+            QMutexLocker lock(&_profile_mutex);
+            _profile.clear();
+        }
+
+        /// \return The number of steps that make up a timestep.
+        virtual int passesPerStep() const { return 3; }
+
         /// Causes the asynchronous automaton to be advanced by one-third of a timestep.
-        /// \note Executes in a separate thread, and blocks until the step returns.
-        inline void step()
+        /// \note Uses the step pool's threads along with the calling thread, and blocks until the step is done.
+        virtual void step()
         {
-            stepAsync().waitForFinished();
+            this->freezeEdges();
+            stepParallel();
         }
 
         /// Causes the automaton to be advanced by one-third of a timestep, in the calling thread.
-        inline void stepInThread()
+        virtual void stepInThread()
         {
+            this->freezeEdges();
+
+            QElapsedTimer timer;
+            if (_profiling)
+                timer.start();
+
+            int updated = 0;
+
             const int num = this->_nodes.size();
             ASYNC_STATE *cell = this->_nodes.data();
             for (int i = 0; i < num; ++i, ++cell)
-                update(*cell);
+            {
+                if (update(*cell))
+                    ++updated;
+            }
+
+            if (_profiling)
+            {
+                addStepCounts(updated, num - updated);
+                finishProfiledStep(timer.nsecsElapsed());
+            }
         }
 
         /// Causes the asynchronous automaton to be advanced by one-third of a timestep.
         /// Calling code must wait for the future to be finished.
-        inline QFuture<void> stepAsync()
+        virtual QFuture<void> stepAsync()
         {
-            return QtConcurrent::filtered(this->_nodes.constBegin(), this->_nodes.constEnd(), _functor);
+            this->freezeEdges();
+            return QtConcurrent::run(this, &Automaton<TState, TIndex, NUM_PER_LOCK>::stepParallel);
         }
 
         /// Adds a cell to the automaton.
         /// \return The index of the newly-created cell.
-        TIndex addNode(const TState & node)
+        virtual TIndex addNode(const TState & node)
         {
             TIndex result = Graph<ASYNC_STATE, TIndex>::addNode(ASYNC_STATE(node, node));
             this->_nodes[result].index = result;
             return result;
         }
 
+        /// Adds several cells to the automaton at once (see Graph::addNodes()).
+        /// \return The indices of the newly-created cells, in order.
+        virtual QVector<TIndex> addNodes(const QVector<TState> & nodes)
+        {
+            const int num = nodes.size();
+
+            QVector<ASYNC_STATE> states;
+            states.reserve(num);
+            for (int i = 0; i < num; ++i)
+                states.append(ASYNC_STATE(nodes[i], nodes[i]));
+
+            QVector<TIndex> result = Graph<ASYNC_STATE, TIndex>::addNodes(states);
+            for (int i = 0; i < num; ++i)
+                this->_nodes[result[i]].index = result[i];
+
+            return result;
+        }
+
+        /// Adds a grid of tiles that share the edges of a pattern (see Graph::addTiles()).
+        /// \return The index of the first of the cells, which have consecutive indices.
+        virtual TIndex addTiles(const QVector<TState> & nodes, const Tiling & tiling)
+        {
+            const int num = nodes.size();
+
+            QVector<ASYNC_STATE> states;
+            states.reserve(num);
+            for (int i = 0; i < num; ++i)
+                states.append(ASYNC_STATE(nodes[i], nodes[i]));
+
+            TIndex first = Graph<ASYNC_STATE, TIndex>::addTiles(states, tiling);
+            for (int i = 0; i < num; ++i)
+                this->_nodes[first + i].index = first + i;
+
+            return first;
+        }
+
+        /// Resizes a grid of tiles in place (see Graph::resizeTiles()).
+        /// \return The indices of the new tiles' cells.
+        virtual QVector<TIndex> resizeTiles(const TIndex & tiled, const int & num_cols, const int & num_rows, const QVector<TState> & pattern)
+        {
+            const int num = pattern.size();
+
+            QVector<ASYNC_STATE> states;
+            states.reserve(num);
+            for (int i = 0; i < num; ++i)
+                states.append(ASYNC_STATE(pattern[i], pattern[i]));
+
+            QVector<TIndex> added = Graph<ASYNC_STATE, TIndex>::resizeTiles(tiled, num_cols, num_rows, states);
+            foreach (const TIndex & index, added)
+                this->_nodes[index].index = index;
+
+            return added;
+        }
+
         /// The ready state of a cell in the automaton.  Used to track asynchronous updates.
-        /// \note This is not thread-safe; use only for imprecise visualization.
+        /// \note Safe to call while the automaton is stepping, but the state may change at any time; use only for imprecise visualization.
         /// \return The asynchronous ready state of a cell in the automaton.
-        int readyState(const TIndex & index) const
+        virtual int readyState(const TIndex & index) const
         {
             if (index < this->_nodes.size())
                 return this->_nodes[index].r;
@@ -162,64 +314,105 @@ namespace Automata
     protected:
         typedef Automaton<TState, TIndex> BASE;
 
-        /// Implements the asynchronous update operation on a cell in the automaton.
-        inline void update(ASYNC_STATE & state)
+        /// Updates all the cells in parallel on the step pool, blocking until they are done.
+        /// \note The edges must be frozen.
+        void stepParallel()
         {
-            // get a consistent copy of the state
-            ASYNC_STATE state_copy = state;
-            const TIndex & index = state_copy.index;
+            QElapsedTimer timer;
+            if (_profiling)
+                timer.start();
 
-            // get consistent copies of neighbors' states
-            const QVector<TIndex> & neighbor_indices = this->_edges[index];
-            typename NEIGHBOR_POOL::Item tni(_temp_neighbor_pool);
-            NEIGHBOR_VECTOR *temp_neighbors = tni.data;
-            NEIGHBOR *neighbor_ptrs = 0;
+            stepPool()->run(&_update_task, this->_nodes.size(), _cells_per_chunk);
 
-            const int num = neighbor_indices.size();
-            if (num > temp_neighbors->size())
-                temp_neighbors->resize(num);
-            neighbor_ptrs = temp_neighbors->data();
+            if (_profiling)
+                finishProfiledStep(timer.nsecsElapsed());
+        }
 
-            // get appropriate states of neighbors
-            bool ready_0 = true;
-            bool ready_r = true;
+        /// \return The phase (from 0 to Automaton::passesPerStep() - 1) of the step about to be taken, for the profile.
+        /// The default counts the automaton's own steps; subclasses that track their timesteps should override it.
+        virtual int stepPhase() const { return _profile_phase; }
 
-            for (int i = 0; i < num; ++i)
-            {
-                const ASYNC_STATE neighbor = this->_nodes[neighbor_indices[i]];
+        /// Adds the counts for a range of cells to those of the step in progress.  Safe to call from any thread.
+        void addStepCounts(const int & updated, const int & stalled)
+        {
+            _step_updated.fetchAndAddRelaxed(updated);
+            _step_stalled.fetchAndAddRelaxed(stalled);
+        }
 
-                ready_0 = ready_0 && neighbor.r != ((0 + 2) % 3);
-                ready_r = ready_r && neighbor.r != ((state_copy.r + 2) % 3);
+        /// Adds a finished step's time and counts to the profile.  Call from the stepping thread once all the cells are done.
+        void finishProfiledStep(const qint64 & nsecs)
+        {
+            const int phase = stepPhase() % StepProfile::NUM_PHASES;
+            _profile_phase = (_profile_phase + 1) % passesPerStep();
+
+            QMutexLocker lock(&_profile_mutex);
+            ++_profile.phase_steps[phase];
+            _profile.phase_nsecs[phase] += nsecs;
+            _profile.cells_updated += _step_updated.fetchAndStoreRelaxed(0);
+            _profile.cells_stalled += _step_stalled.fetchAndStoreRelaxed(0);
+        }
 
-                if (neighbor.r == 0)
-                    neighbor_ptrs[i] = neighbor.q0;
-                else if (neighbor.r == 1)
-                    neighbor_ptrs[i] = neighbor.q1;
-            }
+        /// Adds the time taken by a pass of post-updates to the profile.
+        void addPostUpdateTime(const qint64 & nsecs)
+        {
+            QMutexLocker lock(&_profile_mutex);
+            ++_profile.post_updates;
+            _profile.post_update_nsecs += nsecs;
+        }
 
-            // update
-            bool do_update = false;
-            if (state_copy.r == 0)
+        /// Implements the asynchronous update operation on a cell in the automaton.
+        /// Only the thread updating a cell writes to it during a step, and it reads its neighbors' published states
+        /// only when their ready states allow it, so no locking or copying of whole cells is needed (see Automata::AsyncState).
+        /// \return Whether the cell advanced; if not, one of its neighbors was not ready.
+        inline bool update(ASYNC_STATE & state)
+        {
+            const int r = state.r;
+            const TIndex & index = state.index;
+
+            int num;
+            const TIndex *neighbor_indices = this->frozenNeighbors(index, num);
+
+            // in the second and third phases, a cell only waits for its neighbors to catch up
+            if (r != 0)
             {
-                if (ready_0)
+                const int waiting = (r + 2) % 3;
+                for (int i = 0; i < num; ++i)
                 {
-                    state_copy.r = 1;
-                    state_copy.q1 = state_copy.q0;
-                    state_copy.q1.update(this, index, state_copy.q0, neighbor_indices, neighbor_ptrs);
-                    do_update = true;
+                    if (this->_nodes[neighbor_indices[i]].r == waiting)
+                        return false;
                 }
-            }
-            else
-            {
-                if (ready_r)
+
+                if (r == 2)
+                {
+                    qSwap(state.q0, state.q1);
+                    state.r = 0;
+                }
+                else
                 {
-                    state_copy.r = (state_copy.r + 1) % 3;
-                    do_update = true;
+                    state.r = 2;
                 }
+
+                return true;
             }
 
-            if (do_update)
-                state = state_copy;
+            // get the published states of the neighbors
+            NEIGHBOR *neighbor_ptrs = _temp_neighbors.data(num);
+
+            for (int i = 0; i < num; ++i)
+            {
+                const ASYNC_STATE & neighbor = this->_nodes[neighbor_indices[i]];
+                if (neighbor.r == 2)
+                    return false;
+
+                neighbor_ptrs[i] = neighbor.q0;
+            }
+
+            // update
+            state.q1 = state.q0;
+            state.q0.update(this, index, state.q1, neighbor_indices, num, neighbor_ptrs);
+            state.r = 1;
+
+            return true;
         }
 
     }; // class Automaton
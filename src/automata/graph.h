@@ -38,15 +38,24 @@ POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include "automata_global.h"
+#include "tiling.h"
 
 #include <QString>
 #include <QVector>
 #include <QStack>
 #include <QMap>
+#include <QHash>
 #include <QSet>
+#include <QPair>
+#include <QBitArray>
 #include <QDataStream>
 #include <QTextStream>
 #include <QReadWriteLock>
+#include <QMutex>
+#include <QtEndian>
+#include <QtAlgorithms>
+
+#include <cstring>
 
 namespace Automata
 {
@@ -61,21 +70,48 @@ namespace Automata
         bool _directed;
 
         QVector<TNode> _nodes;
-        QVector< QVector<TIndex> > _edges; ///< [src -> destination]; vectors for speed of access.
-        QMap<TIndex, QSet<TIndex> > _edges_to;    ///< [destination -> src]; used only for deleting nodes.
+        QVector< QVector<TIndex> > _edges;    ///< [src -> destination]; vectors for speed of access.  Leaves out the edges of tiled nodes that come from their tiling.
+        QVector< QVector<TIndex> > _edges_to; ///< [destination -> src]; used for deleting nodes and edges, and for checking for duplicate edges.  Also leaves out tiled edges.
+        bool _edges_to_valid;                 ///< Whether \c _edges_to is up to date; after loading, it is only built when the edges are changed.
 
         QStack<TIndex> _free_nodes;
 
+        /// The tile that starts at a given index; see Graph::tileOf().
+        struct TileRef
+        {
+            int first;   ///< The index of the tile's first node.
+            int tiling;  ///< The position of the tile's tiling in \c _tilings.
+            int tile;    ///< The number of the tile in its tiling.
+
+            bool operator< (const TileRef & other) const { return first < other.first; }
+        };
+
+        QList<Tiling> _tilings;      ///< Grids of nodes whose edges come from a shared pattern; see Graph::addTiles().
+        QVector<TileRef> _tile_refs; ///< The tiles of all the tilings, in order of their first indices; rebuilt by Graph::indexTiles().
+
+        QVector<int> _csr_offsets;   ///< Frozen layout: the neighbors of node i are <tt>_csr_edges[_csr_offsets[i] .. _csr_offsets[i+1])</tt>.
+        QVector<TIndex> _csr_edges;  ///< Frozen layout: all outgoing edges, contiguous in node order.
+        bool _csr_dirty;             ///< Set whenever the edges change; the frozen layout is rebuilt by Graph::freezeEdges().
+        bool _edges_in_csr;          ///< Set when the edges were loaded in the frozen layout only; Graph::thawEdges() builds \c _edges from it.
+
+        QVector<int> _csr_reverse_offsets;  ///< Frozen reverse layout: the nodes with an edge to node i are <tt>_csr_reverse_edges[_csr_reverse_offsets[i] .. _csr_reverse_offsets[i+1])</tt>.
+        QVector<TIndex> _csr_reverse_edges; ///< Frozen reverse layout: all incoming edges, contiguous in node order.
+        bool _csr_reverse_valid;            ///< Whether the frozen reverse layout matches the frozen layout; built only on demand by Graph::freezeReverseEdges().
+
         QReadWriteLock _nodes_lock;
         QReadWriteLock _edges_lock;
+        QMutex _thaw_lock;
 
     public:
+        /// An edge, from the first node to the second.
+        typedef QPair<TIndex, TIndex> Edge;
+
         /// Constructor.
         /// \param initialCapacity The number of nodes for which the graph object will initially reserve memory.
         /// \param directed Whether or not the graph is directed.  If it is NOT directed, Graph::addEdge() will
         /// add both incoming and outgoing edges.
         Graph(const int initialCapacity = 0, bool directed = false)
-            : _directed(directed)
+            : _directed(directed), _edges_to_valid(true), _csr_dirty(true), _edges_in_csr(false), _csr_reverse_valid(false)
         {
             _nodes.reserve(initialCapacity);
             _edges.reserve(initialCapacity);
@@ -86,6 +122,35 @@ namespace Automata
         {
         }
 
+        /// \return The number of nodes in the graph.
+        int size() const { return _nodes.size(); }
+
+        /// \return An estimate of the number of bytes taken by the graph's nodes and edges, in all their layouts.
+        virtual qint64 memoryUsed() const
+        {
+            qint64 bytes = static_cast<qint64>(_nodes.capacity()) * sizeof(TNode)
+                    + static_cast<qint64>(_edges.capacity()) * sizeof(QVector<TIndex>)
+                    + static_cast<qint64>(_csr_offsets.capacity()) * sizeof(int)
+                    + static_cast<qint64>(_csr_edges.capacity()) * sizeof(TIndex)
+                    + static_cast<qint64>(_csr_reverse_offsets.capacity()) * sizeof(int)
+                    + static_cast<qint64>(_csr_reverse_edges.capacity()) * sizeof(TIndex)
+                    + static_cast<qint64>(_edges_to.capacity()) * sizeof(QVector<TIndex>);
+
+            const int num = _edges.size();
+            for (int i = 0; i < num; ++i)
+                bytes += static_cast<qint64>(_edges[i].capacity()) * sizeof(TIndex);
+
+            const int num_to = _edges_to.size();
+            for (int i = 0; i < num_to; ++i)
+                bytes += static_cast<qint64>(_edges_to[i].capacity()) * sizeof(TIndex);
+
+            foreach (const Tiling & tiling, _tilings)
+                bytes += tiling.memoryUsed();
+            bytes += static_cast<qint64>(_tile_refs.capacity()) * sizeof(TileRef);
+
+            return bytes;
+        }
+
         /// Adds a node to the graph.
         /// \note Makes a copy of the node.
         /// \return The index of the newly-created node.
@@ -93,6 +158,7 @@ namespace Automata
         {
             QWriteLocker nwl(&_nodes_lock);
             QWriteLocker ewl(&_edges_lock);
+            thawEdges();
 
             TIndex index;
 
@@ -101,22 +167,123 @@ namespace Automata
                 index = _free_nodes.pop();
                 _nodes[index] = node;
                 _edges[index].clear();
+
+                if (_edges_to_valid)
+                    _edges_to[index].clear();
             }
             else
             {
                 index = _nodes.size();
                 _nodes.append(node);
                 _edges.append(QVector<TIndex>());
+
+                if (_edges_to_valid)
+                    _edges_to.append(QVector<TIndex>());
             }
 
+            _csr_dirty = true;
             return index;
         }
 
-        /// Removes a node from the graph.
+        /// Adds several nodes to the graph, reusing free indices first as Graph::addNode() would,
+        /// but taking the locks and reserving memory only once.
+        /// \note Makes copies of the nodes.
+        /// \return The indices of the newly-created nodes, in order.
+        QVector<TIndex> addNodes(const QVector<TNode> & nodes)
+        {
+            QWriteLocker nwl(&_nodes_lock);
+            QWriteLocker ewl(&_edges_lock);
+            thawEdges();
+
+            const int num = nodes.size();
+            const int num_new = qMax(num - _free_nodes.size(), 0);
+
+            _nodes.reserve(_nodes.size() + num_new);
+            _edges.reserve(_edges.size() + num_new);
+            if (_edges_to_valid)
+                _edges_to.reserve(_edges_to.size() + num_new);
+
+            QVector<TIndex> indices(num);
+            for (int i = 0; i < num; ++i)
+            {
+                TIndex & index = indices[i];
+
+                if (!_free_nodes.isEmpty())
+                {
+                    index = _free_nodes.pop();
+                    _nodes[index] = nodes[i];
+                    _edges[index].clear();
+
+                    if (_edges_to_valid)
+                        _edges_to[index].clear();
+                }
+                else
+                {
+                    index = _nodes.size();
+                    _nodes.append(nodes[i]);
+                    _edges.append(QVector<TIndex>());
+
+                    if (_edges_to_valid)
+                        _edges_to.append(QVector<TIndex>());
+                }
+            }
+
+            if (num > 0)
+                _csr_dirty = true;
+
+            return indices;
+        }
+
+        /// Adds a grid of tiles to the graph, each tile a copy of the same pattern of nodes, with the edges
+        /// among them given by a tiling instead of being added one by one.  The tiles' edges are not listed
+        /// for each node unless some of them are changed, so a large grid takes little more memory than its nodes.
+        /// Other edges may be added to and from the tiled nodes as usual.
+        /// \note Makes copies of the nodes.
+        /// \param nodes The nodes of the grid, tile by tile in row order, each tile in pattern order.
+        /// \param tiling The edges of the pattern, and the size of the grid.
+        /// \return The index of the first node; the grid's nodes have consecutive indices, reusing free indices if enough of them are consecutive.
+        TIndex addTiles(const QVector<TNode> & nodes, const Tiling & tiling)
+        {
+            QWriteLocker nwl(&_nodes_lock);
+            QWriteLocker ewl(&_edges_lock);
+            thawEdges();
+
+            const int num = nodes.size();
+            if (num != tiling.size())
+                throw Common::Exception("The number of nodes does not match the size of the tiling.");
+
+            const int first = allocateRun(num);
+
+            for (int i = 0; i < num; ++i)
+            {
+                _nodes[first + i] = nodes[i];
+                _edges[first + i].clear();
+
+                if (_edges_to_valid)
+                    _edges_to[first + i].clear();
+            }
+
+            if (num > 0)
+            {
+                Tiling added(tiling);
+                added.setFirst(first);
+                _tilings.append(added);
+                indexTiles();
+
+                _csr_dirty = true;
+            }
+
+            return static_cast<TIndex>(first);
+        }
+
+        /// Removes a node from the graph, along with its incoming and outgoing edges.
+        /// Takes time proportional to the number of edges of the node and of its neighbors.
+        /// \see Graph::removeNodes()
         void removeNode(const TIndex & index)
         {
             QWriteLocker nwl(&_nodes_lock);
             QWriteLocker ewl(&_edges_lock);
+            thawEdges();
 
             if (index < _edges.size())
             {
@@ -125,16 +292,33 @@ namespace Automata
                     throw Common::Exception("You cannot remove a node that does not exist.");
 #endif
 
-                _edges[index].clear();
-
-                foreach (TIndex src, _edges_to[index])
+                const TileRef *ref = tileOf(index);
+                if (ref)
                 {
-                    TIndex neighbor_index = _edges[src].indexOf(index);
-                    if (neighbor_index != -1)
-                        _edges[src].remove(neighbor_index);
+                    const int t = ref->tiling;
+                    if (_tilings[t].size() == 1)
+                    {
+                        _tilings.removeAt(t);
+                        indexTiles();
+                    }
+                    else
+                    {
+                        expandTiling(t);
+                    }
                 }
 
+                buildEdgesTo();
+
+                foreach (const TIndex & to, _edges[index])
+                    takeFromList(_edges_to[to], index);
+                _edges[index].clear();
+
+                foreach (const TIndex & src, _edges_to[index])
+                    removeFromList(_edges[src], index);
+                _edges_to[index].clear();
+
                 _free_nodes.push(index);
+                _csr_dirty = true;
             }
             else
             {
@@ -142,16 +326,232 @@ namespace Automata
             }
         }
 
+        /// Removes several nodes from the graph, along with their edges.  Has the same effect as calling
+        /// Graph::removeNode() for each of them in turn, but visits each neighbor's edge list only once,
+        /// so takes time proportional to the number of edges involved however many of the nodes are connected to each other.
+        /// \param indices The nodes to remove; their indices are reused in the reverse order.
+        void removeNodes(const QVector<TIndex> & indices)
+        {
+            QWriteLocker nwl(&_nodes_lock);
+            QWriteLocker ewl(&_edges_lock);
+            thawEdges();
+
+            const int num = _edges.size();
+            foreach (const TIndex & index, indices)
+            {
+                if (index >= num)
+                    throw Common::IndexOverflow();
+            }
+
+#ifdef DEBUG
+            QBitArray free_nodes(num);
+            foreach (const TIndex & index, _free_nodes)
+                free_nodes.setBit(index);
+            foreach (const TIndex & index, indices)
+            {
+                if (free_nodes.testBit(index))
+                    throw Common::Exception("You cannot remove a node that does not exist.");
+            }
+#endif
+
+            unlinkNodes(indices);
+        }
+
+        /// Changes the number of columns and rows of a grid added by Graph::addTiles() or Graph::adoptTiles(), in place.
+        /// The tiles that are in both the old and the new grid keep their nodes, with their indices, states and other edges;
+        /// the edges across the seams between the tiles follow from the new size, so none of them need to be listed.
+        /// The nodes of the tiles that are dropped are removed, along with their other edges, and the new tiles are copies of the pattern.
+        /// \note Makes copies of the nodes.
+        /// \param tiled A node of the grid.
+        /// \param num_cols The new number of columns.
+        /// \param num_rows The new number of rows.
+        /// \param pattern The nodes of a new tile, in pattern order.
+        /// \return The indices of the new tiles' nodes, tile by tile in row order, each tile in pattern order; the nodes of each tile have consecutive indices.
+        QVector<TIndex> resizeTiles(const TIndex & tiled, const int & num_cols, const int & num_rows, const QVector<TNode> & pattern)
+        {
+            QWriteLocker nwl(&_nodes_lock);
+            QWriteLocker ewl(&_edges_lock);
+            thawEdges();
+
+            if (tiled >= _edges.size())
+                throw Common::IndexOverflow();
+
+            const TileRef *ref = tileOf(tiled);
+            if (!ref)
+                throw Common::Exception("The node is not in a grid of tiles.");
+
+            const int t = ref->tiling;
+            const int pattern_size = _tilings[t].patternSize();
+            if (pattern.size() != pattern_size)
+                throw Common::Exception("The number of nodes does not match the size of the tiling.");
+
+            // the tiling is set aside while the dropped tiles are removed, so that its edges are not listed
+            Tiling tiling = _tilings.takeAt(t);
+            indexTiles();
+
+            const int old_cols = tiling.numCols(), old_rows = tiling.numRows();
+            const int new_cols = qMax(num_cols, 1), new_rows = qMax(num_rows, 1);
+
+            QVector<TIndex> dropped;
+            for (int row = 0; row < old_rows; ++row)
+            {
+                for (int col = 0; col < old_cols; ++col)
+                {
+                    if (row < new_rows && col < new_cols)
+                        continue;
+
+                    const int first = tiling.tileFirst(row * old_cols + col);
+                    for (int node = 0; node < pattern_size; ++node)
+                        dropped.append(static_cast<TIndex>(first + node));
+                }
+            }
+
+            tiling.resize(new_cols, new_rows);
+
+            if (!dropped.isEmpty())
+                unlinkNodes(dropped);
+
+            // the new tiles share one run of indices
+            int num_added = 0;
+            for (int row = 0; row < new_rows; ++row)
+            {
+                for (int col = 0; col < new_cols; ++col)
+                {
+                    if (row >= old_rows || col >= old_cols)
+                        ++num_added;
+                }
+            }
+
+            QVector<TIndex> added;
+            added.reserve(num_added * pattern_size);
+
+            int next = allocateRun(num_added * pattern_size);
+            for (int row = 0; row < new_rows; ++row)
+            {
+                for (int col = 0; col < new_cols; ++col)
+                {
+                    if (row < old_rows && col < old_cols)
+                        continue;
+
+                    tiling.setTileFirst(row * new_cols + col, next);
+                    for (int node = 0; node < pattern_size; ++node, ++next)
+                    {
+                        _nodes[next] = pattern[node];
+                        _edges[next].clear();
+
+                        if (_edges_to_valid)
+                            _edges_to[next].clear();
+
+                        added.append(static_cast<TIndex>(next));
+                    }
+                }
+            }
+
+            _tilings.insert(t, tiling);
+            indexTiles();
+
+            _csr_dirty = true;
+            return added;
+        }
+
+        /// Makes a grid of nodes whose edges are listed for each of them share the edges of a tiling instead,
+        /// as if it had been added by Graph::addTiles(), so that it can be resized in place; used for grids that
+        /// were loaded, since tilings are not saved.  The edges the tiling gives each node must be its first edges, in the same order,
+        /// as they would be for a grid added by Graph::addTiles().  The frozen layout does not change.
+        /// \param tile_firsts The index of the first node of each tile, in row order; the nodes of each tile must have consecutive indices.
+        /// \param tiling The edges of the pattern, and the size of the grid.
+        /// \return False, leaving the graph as it was, if the tiles overlap or are already tiled, or if the nodes' edges don't start with the tiling's.
+        bool adoptTiles(const QVector<TIndex> & tile_firsts, const Tiling & tiling)
+        {
+            QWriteLocker ewl(&_edges_lock);
+            thawEdges();
+
+            const int num_tiles = tiling.numTiles(), pattern_size = tiling.patternSize();
+            if (pattern_size == 0 || tile_firsts.size() != num_tiles)
+                return false;
+
+            QVector<TIndex> sorted(tile_firsts);
+            qSort(sorted.begin(), sorted.end());
+            for (int tile = 0; tile < num_tiles; ++tile)
+            {
+                if (sorted[tile] < 0 || sorted[tile] + pattern_size > _edges.size())
+                    return false;
+                if (tile > 0 && sorted[tile] < sorted[tile - 1] + pattern_size)
+                    return false;
+            }
+
+            Tiling adopted(tiling);
+            for (int tile = 0; tile < num_tiles; ++tile)
+                adopted.setTileFirst(tile, tile_firsts[tile]);
+
+            // check every node before changing any of them
+            QVector<TIndex> listed;
+            for (int tile = 0; tile < num_tiles; ++tile)
+            {
+                for (int node = 0; node < pattern_size; ++node)
+                {
+                    const int index = tile_firsts[tile] + node;
+                    if (tileOf(index))
+                        return false;
+
+                    listed.resize(adopted.maxNeighbors(node));
+                    listed.resize(adopted.neighbors(tile, node, listed.data()));
+
+                    const QVector<TIndex> & outgoing = _edges[index];
+                    if (outgoing.size() < listed.size())
+                        return false;
+
+                    for (int j = 0; j < listed.size(); ++j)
+                    {
+                        if (outgoing[j] != listed[j])
+                            return false;
+                    }
+                }
+            }
+
+            for (int tile = 0; tile < num_tiles; ++tile)
+            {
+                for (int node = 0; node < pattern_size; ++node)
+                {
+                    const int index = tile_firsts[tile] + node;
+
+                    listed.resize(adopted.maxNeighbors(node));
+                    listed.resize(adopted.neighbors(tile, node, listed.data()));
+
+                    if (_edges_to_valid)
+                    {
+                        foreach (const TIndex & to, listed)
+                            takeFromList(_edges_to[to], static_cast<TIndex>(index));
+                    }
+
+                    _edges[index].remove(0, listed.size());
+                }
+            }
+
+            _tilings.append(adopted);
+            indexTiles();
+
+            return true;
+        }
+
+        /// \return Whether a node is in a grid added by Graph::addTiles() or Graph::adoptTiles().
+        bool isTiled(const TIndex & index) const
+        {
+            return tileOf(index) != 0;
+        }
+
         /// Whether or not the graph contains an edge.
+        /// Builds the incoming edges if the graph was loaded without them, so takes the write lock as Graph::addEdge() does.
         /// \return True if the graph contains an edge.
         bool containsEdge(const TIndex & from, const TIndex & to)
         {
-            QReadLocker erl(&_edges_lock);
+            QWriteLocker ewl(&_edges_lock);
+            thawEdges();
 
-            if (from < _edges.size())
+            if (from < _edges.size() && to < _edges.size())
             {
-                QVector<TIndex> & outgoing = _edges[from];
-                return outgoing.contains(to);
+                buildEdgesTo();
+                return hasEdge(from, to);
             }
             else
             {
@@ -159,42 +559,75 @@ namespace Automata
             }
         }
 
-        /// Adds an edge to the graph.  If the graph is NOT directed, will also add a reciprocal edge.
+        /// Adds an edge to the graph, unless it is already there.  If the graph is NOT directed, will also add a reciprocal edge.
         /// \param from The index of the source node.
         /// \param to The index of the destination node.
-        /// \see NeuroLib::Graph::removeEdge()
+        /// \see NeuroLib::Graph::removeEdge(), NeuroLib::Graph::addEdges()
         void addEdge(const TIndex & from, const TIndex & to)
         {
             QWriteLocker ewl(&_edges_lock);
+            thawEdges();
 
-            if (from < _edges.size())
-            {
-                QVector<TIndex> & outgoing = _edges[from];
+            if (from >= _edges.size() || to >= _edges.size())
+                throw Common::IndexOverflow();
 
-                if (!outgoing.contains(to))
-                    outgoing.append(to);
+            buildEdgesTo();
+            _csr_dirty = true;
 
-                _edges_to[to].insert(from);
-            }
-            else
+            linkEdge(from, to);
+            if (!_directed)
+                linkEdge(to, from);
+        }
+
+        /// Adds several edges to the graph, in order, as Graph::addEdge() would, but taking the locks only once.
+        /// The new edges are grouped by source, and a source that gets more than one is checked for duplicates
+        /// against a hash of its edges, so adding many edges to the same node does not search its list for each one.
+        /// \see NeuroLib::Graph::removeEdges()
+        void addEdges(const QVector<Edge> & edges)
+        {
+            QWriteLocker ewl(&_edges_lock);
+            thawEdges();
+
+            checkEdges(edges);
+            buildEdgesTo();
+            _csr_dirty = true;
+
+            QHash<TIndex, QVector<TIndex> > added;
+            foreach (const Edge & edge, edges)
             {
-                throw Common::IndexOverflow();
+                added[edge.first].append(edge.second);
+                if (!_directed)
+                    added[edge.second].append(edge.first);
             }
 
-            if (!_directed)
+            for (typename QHash<TIndex, QVector<TIndex> >::const_iterator i = added.constBegin(); i != added.constEnd(); ++i)
             {
-                if (to < _edges.size())
+                const TIndex & from = i.key();
+                const QVector<TIndex> & destinations = i.value();
+
+                if (destinations.size() == 1)
                 {
-                    QVector<TIndex> & incoming = _edges[to];
+                    linkEdge(from, destinations.first());
+                    continue;
+                }
 
-                    if (!incoming.contains(from))
-                        incoming.append(from);
+                QVector<TIndex> existing;
+                edgesOf(from, existing);
 
-                    _edges_to[from].insert(to);
-                }
-                else
+                QSet<TIndex> present;
+                present.reserve(existing.size() + destinations.size());
+                foreach (const TIndex & to, existing)
+                    present.insert(to);
+
+                QVector<TIndex> & outgoing = _edges[from];
+                foreach (const TIndex & to, destinations)
                 {
-                    throw Common::IndexOverflow();
+                    if (present.contains(to))
+                        continue;
+
+                    present.insert(to);
+                    outgoing.append(to);
+                    _edges_to[to].append(from);
                 }
             }
         }
@@ -202,44 +635,82 @@ namespace Automata
         /// Removes an edge from the graph.  If the graph is NOT directed, will also remove the reciprocal edge.
         /// \param from The index of the source node.
         /// \param to The index of the destination node.
-        /// \see NeuroLib::Graph::addEdge()
+        /// \see NeuroLib::Graph::addEdge(), NeuroLib::Graph::removeEdges()
         void removeEdge(const TIndex & from, const TIndex & to)
         {
             QWriteLocker eql(&_edges_lock);
+            thawEdges();
 
-            if (from < _edges.size())
-            {
-                QVector<TIndex> & outgoing = _edges[from];
-                int i = outgoing.indexOf(to);
-                if (i != -1)
-                    outgoing.remove(i);
-
-                _edges_to[to].remove(from);
-            }
-            else
-            {
+            if (from >= _edges.size() || to >= _edges.size())
                 throw Common::IndexOverflow();
-            }
 
+            buildEdgesTo();
+            _csr_dirty = true;
+
+            unlinkEdge(from, to);
             if (!_directed)
+                unlinkEdge(to, from);
+        }
+
+        /// Removes several edges from the graph, as Graph::removeEdge() would, but taking the locks only once.
+        /// The edges are grouped by source and by destination, and each list involved is filtered in one pass,
+        /// so the time taken is proportional to the lengths of the lists rather than to their lengths times the number of edges.
+        /// \see NeuroLib::Graph::addEdges()
+        void removeEdges(const QVector<Edge> & edges)
+        {
+            QWriteLocker eql(&_edges_lock);
+            thawEdges();
+
+            checkEdges(edges);
+            buildEdgesTo();
+            _csr_dirty = true;
+
+            QHash<TIndex, QVector<TIndex> > from_sources, to_destinations;
+            foreach (const Edge & edge, edges)
             {
-                if (to < _edges.size())
-                {
-                    QVector<TIndex> & incoming = _edges[to];
-                    int i = incoming.indexOf(from);
-                    if (i != -1)
-                        incoming.remove(i);
+                from_sources[edge.first].append(edge.second);
+                to_destinations[edge.second].append(edge.first);
 
-                    _edges_to[from].remove(to);
+                if (!_directed)
+                {
+                    from_sources[edge.second].append(edge.first);
+                    to_destinations[edge.first].append(edge.second);
                 }
-                else
+            }
+
+            // tiled edges are listed before any lists are filtered, as listing them adds to the incoming lists
+            for (typename QHash<TIndex, QVector<TIndex> >::const_iterator i = from_sources.constBegin(); i != from_sources.constEnd(); ++i)
+            {
+                const TIndex & from = i.key();
+                const TileRef *ref = tileOf(from);
+                if (!ref)
+                    continue;
+
+                const int t = ref->tiling, tile = ref->tile, node = from - ref->first;
+                foreach (const TIndex & to, i.value())
                 {
-                    throw Common::IndexOverflow();
+                    if (_tilings[t].hasNeighbor(tile, node, to))
+                    {
+                        expandTiling(t);
+                        break;
+                    }
                 }
             }
+
+            for (typename QHash<TIndex, QVector<TIndex> >::iterator i = from_sources.begin(); i != from_sources.end(); ++i)
+            {
+                qSort(i.value().begin(), i.value().end());
+                removeFromList(_edges[i.key()], i.value());
+            }
+
+            for (typename QHash<TIndex, QVector<TIndex> >::iterator i = to_destinations.begin(); i != to_destinations.end(); ++i)
+            {
+                qSort(i.value().begin(), i.value().end());
+                removeFromList(_edges_to[i.key()], i.value());
+            }
         }
 
-        void clear()
+        virtual void clear()
         {
             QWriteLocker nl(&_nodes_lock);
             QWriteLocker el(&_edges_lock);
@@ -247,24 +718,151 @@ namespace Automata
             _nodes.clear();
             _edges.clear();
             _edges_to.clear();
+            _edges_to_valid = true;
             _free_nodes.clear();
+            _tilings.clear();
+            _tile_refs.clear();
+
+            _csr_offsets.clear();
+            _csr_edges.clear();
+            _csr_dirty = true;
+            _edges_in_csr = false;
+
+            _csr_reverse_offsets.clear();
+            _csr_reverse_edges.clear();
+            _csr_reverse_valid = false;
         }
 
-        /// Access a node in the graph.
-        /// \returns A const reference to a node in the graph.
+        /// Builds the frozen compressed-sparse-row layout of the edges, if they have changed since it was last built.
+        /// The frozen layout keeps all outgoing edges in one contiguous array, so walking the neighbors of
+        /// consecutive nodes does not chase a separate allocation for each node.
+        /// \note Must not be called while other threads are reading the frozen layout.
+        /// \see Graph::frozenNeighbors()
+        void freezeEdges()
+        {
+            QWriteLocker ewl(&_edges_lock);
+
+            if (!_csr_dirty)
+                return;
+
+            const int num = _edges.size();
+
+            // the tiled nodes' edges from their patterns come first, as they would if they had been added one by one
+            QVector<TIndex> buf;
+            int num_edges = 0;
+            for (int i = 0; i < num; ++i)
+            {
+                num_edges += _edges[i].size();
+
+                const TileRef *ref = tileOf(i);
+                if (ref)
+                {
+                    const Tiling & tiling = _tilings[ref->tiling];
+                    buf.resize(tiling.maxNeighbors(i - ref->first));
+                    num_edges += tiling.neighbors(ref->tile, i - ref->first, buf.data());
+                }
+            }
+
+            _csr_offsets.resize(num + 1);
+            _csr_edges.resize(num_edges);
+
+            int *offsets = _csr_offsets.data();
+            TIndex *edges = _csr_edges.data();
+            int pos = 0;
+
+            for (int i = 0; i < num; ++i)
+            {
+                const QVector<TIndex> & outgoing = _edges[i];
+                const int n_num = outgoing.size();
+
+                offsets[i] = pos;
+
+                const TileRef *ref = tileOf(i);
+                if (ref)
+                    pos += _tilings[ref->tiling].neighbors(ref->tile, i - ref->first, edges + pos);
+
+                for (int j = 0; j < n_num; ++j)
+                    edges[pos++] = outgoing[j];
+            }
+
+            offsets[num] = pos;
+            _csr_dirty = false;
+            _csr_reverse_valid = false;
+        }
+
+        /// \return Whether the frozen reverse layout is up to date, i.e. the edges have not changed since Graph::freezeReverseEdges() was last called.
+        bool reverseEdgesFrozen() const { return _csr_reverse_valid && !_csr_dirty; }
+
+        /// Builds the frozen layout of the reverse edges, freezing the edges first if necessary.
+        /// Nothing else uses the reverse layout, so it is only built for those who ask for it.
+        /// \note Must not be called while other threads are reading the frozen layouts.
+        /// \see Graph::frozenReverseNeighbors()
+        void freezeReverseEdges()
+        {
+            freezeEdges();
+
+            QWriteLocker ewl(&_edges_lock);
+
+            if (_csr_reverse_valid)
+                return;
+
+            const int num = _csr_offsets.size() - 1;
+            const int num_edges = _csr_edges.size();
+
+            _csr_reverse_offsets.fill(0, qMax(num, 0) + 1);
+            _csr_reverse_edges.resize(num_edges);
+
+            const int *offsets = _csr_offsets.constData();
+            const TIndex *edges = _csr_edges.constData();
+            int *reverse_offsets = _csr_reverse_offsets.data();
+            TIndex *reverse_edges = _csr_reverse_edges.data();
+
+            // count the incoming edges of each node, then place the sources in node order
+            for (int j = 0; j < num_edges; ++j)
+                ++reverse_offsets[edges[j] + 1];
+            for (int i = 0; i < num; ++i)
+                reverse_offsets[i + 1] += reverse_offsets[i];
+
+            QVector<int> next(num);
+            for (int i = 0; i < num; ++i)
+                next[i] = reverse_offsets[i];
+
+            for (int i = 0; i < num; ++i)
+            {
+                for (int j = offsets[i]; j < offsets[i + 1]; ++j)
+                    reverse_edges[next[edges[j]]++] = static_cast<TIndex>(i);
+            }
+
+            _csr_reverse_valid = true;
+        }
+
+        /// Returns a pointer to the indices of the nodes to which there is an edge from the given node, in the frozen layout.
+        /// \note Only valid after a call to Graph::freezeEdges(), and until the edges are changed.  Does no bounds checking.
         /// \param index The index of the node.
-        const TNode & operator[] (const TIndex & index) const
+        /// \param num Is set to the number of neighbors.
+        inline const TIndex * frozenNeighbors(const TIndex & index, int & num) const
         {
-            if (index < _nodes.size())
-                return _nodes[index];
-            else
-                throw Common::IndexOverflow();
+            const int *offsets = _csr_offsets.constData() + index;
+            num = offsets[1] - offsets[0];
+            return _csr_edges.constData() + offsets[0];
+        }
+
+        /// Returns a pointer to the indices of the nodes which have an edge to the given node, in the frozen reverse layout.
+        /// \note Only valid after a call to Graph::freezeReverseEdges(), and until the edges are changed.  Does no bounds checking.
+        /// \param index The index of the node.
+        /// \param num Is set to the number of nodes.
+        inline const TIndex * frozenReverseNeighbors(const TIndex & index, int & num) const
+        {
+            const int *offsets = _csr_reverse_offsets.constData() + index;
+            num = offsets[1] - offsets[0];
+            return _csr_reverse_edges.constData() + offsets[0];
         }
 
         /// Access a node in the graph.
-        /// \returns A reference to a node in the graph.
+        /// \returns A copy of a node in the graph, so that a derived graph that keeps its nodes' state elsewhere
+        /// can build it without changing the graph.
         /// \param index The index of the node.
-        TNode & operator[] (const TIndex & index)
+        virtual TNode operator[] (const TIndex & index) const
         {
             if (index < _nodes.size())
                 return _nodes[index];
@@ -272,32 +870,30 @@ namespace Automata
                 throw Common::IndexOverflow();
         }
 
-        /// Returns a pointer to an array containing the indices of all the
-        /// nodes to which there is an edge from the given node.
-        /// \note This pointer is not stable over graph updates, obviously.
+        /// Access a node in the graph.
+        /// \returns A reference to a node in the graph.
         /// \param index The index of the node.
-        /// \param num Is set to the size of the array.
-        const TIndex * neighbors(const TIndex & index, int & num) const
+        virtual TNode & operator[] (const TIndex & index)
         {
             if (index < _nodes.size())
-            {
-                const QVector<TIndex> & nbrs = _edges[index];
-                num = nbrs.size();
-                return nbrs.data();
-            }
+                return _nodes[index];
             else
-            {
                 throw Common::IndexOverflow();
-            }
         }
 
-        /// Returns the vector of the indices of all nodes to which there is an edge from the given node.
+        /// Returns the indices of all nodes to which there is an edge from the given node.
+        /// The edges a tiled node gets from its tiling are worked out from the tiling, so this returns a copy
+        /// and leaves the graph as it is.
         /// \param index The index of the node.
-        const QVector<TIndex> & neighbors(const TIndex & index) const
+        QVector<TIndex> neighbors(const TIndex & index) const
         {
             if (index < _nodes.size())
             {
-                return _edges[index];
+                thawEdges();
+
+                QVector<TIndex> result;
+                edgesOf(index, result);
+                return result;
             }
             else
             {
@@ -308,6 +904,8 @@ namespace Automata
         /// Writes the graph's data.  Should be called by derived classes' implementations.
         virtual void writeBinary(QDataStream & ds, const AutomataFileVersion & file_version) const
         {
+            thawEdges();
+
             // directed flag
             ds << _directed;
 
@@ -323,9 +921,11 @@ namespace Automata
             // edges
             num = static_cast<quint32>(_edges.size());
             ds << num;
+
+            QVector<TIndex> neighbors;
             for (quint32 i = 0; i < num; ++i)
             {
-                const QVector<TIndex> & neighbors = _edges[i];
+                edgesOf(i, neighbors);
                 quint32 n_num = static_cast<quint32>(neighbors.size());
                 ds << n_num;
                 for (quint32 j = 0; j < n_num; ++j)
@@ -349,6 +949,15 @@ namespace Automata
         /// Reads the graph's data.  Should be called by derived classes' implementations.
         virtual void readBinary(QDataStream & ds, const AutomataFileVersion & file_version)
         {
+            _csr_dirty = true;
+            _edges_in_csr = false;
+            _tilings.clear();
+            _tile_refs.clear();
+
+            // the reverse map is built if it is needed
+            _edges_to.clear();
+            _edges_to_valid = false;
+
             if (file_version.automata_version >= Automata::AUTOMATA_FILE_VERSION_1)
             {
                 ds >> _directed;
@@ -388,15 +997,6 @@ namespace Automata
                     ds >> _edges;
                 }
 
-                _edges_to.clear();
-                for (int from = 0; from < _edges.size(); ++from)
-                {
-                    foreach (TIndex to, _edges[from])
-                    {
-                        _edges_to[to].insert(from);
-                    }
-                }
-
                 // free nodes
                 if (file_version.automata_version >= Automata::AUTOMATA_FILE_VERSION_2)
                 {
@@ -423,6 +1023,498 @@ namespace Automata
                 ds >> this->_edges;
             }
         }
+
+    protected:
+        /// Builds the per-node edge lists from the frozen layout, if the edges were loaded by Graph::readFrozenEdges().
+        /// Called before anything that reads or changes the per-node lists, so that a graph that is only loaded
+        /// and stepped never builds them.  The frozen layout stays valid.
+        void thawEdges() const
+        {
+            if (!_edges_in_csr)
+                return;
+
+            Graph<TNode, TIndex> *self = const_cast<Graph<TNode, TIndex> *>(this);
+            QMutexLocker lock(&self->_thaw_lock);
+
+            if (!_edges_in_csr)
+                return;
+
+            const int num = _csr_offsets.size() - 1;
+            const int *offsets = _csr_offsets.constData();
+            const TIndex *edges = _csr_edges.constData();
+
+            self->_edges.resize(num);
+
+            for (int i = 0; i < num; ++i)
+            {
+                QVector<TIndex> & outgoing = self->_edges[i];
+                outgoing.resize(offsets[i + 1] - offsets[i]);
+
+                for (int j = offsets[i]; j < offsets[i + 1]; ++j)
+                    outgoing[j - offsets[i]] = edges[j];
+            }
+
+            self->_edges_in_csr = false;
+        }
+
+        /// Finds a run of free indices long enough for a number of nodes, or makes one at the end of the graph, and takes it off the free list.
+        /// The nodes in the run must be set by the caller.
+        /// \return The first index of the run.
+        int allocateRun(const int & num)
+        {
+            // look for a long enough run of free indices, or a run at the end that can be extended
+            const int size = _nodes.size();
+            QBitArray free_nodes(size);
+            foreach (const TIndex & index, _free_nodes)
+                free_nodes.setBit(index);
+
+            int first = -1, run = 0;
+            for (int i = 0; i < size && first == -1; ++i)
+            {
+                run = free_nodes.testBit(i) ? run + 1 : 0;
+                if (num > 0 && run == num)
+                    first = i - num + 1;
+            }
+            if (first == -1)
+                first = size - run;
+
+            const int end = first + num;
+            if (end > size)
+            {
+                _nodes.resize(end);
+                _edges.resize(end);
+                if (_edges_to_valid)
+                    _edges_to.resize(end);
+            }
+
+            if (first < size)
+            {
+                QStack<TIndex> remaining;
+                foreach (const TIndex & index, _free_nodes)
+                {
+                    if (index < first || index >= end)
+                        remaining.push(index);
+                }
+                _free_nodes = remaining;
+            }
+
+            return first;
+        }
+
+        /// Removes nodes along with their edges, and puts them on the free list; see Graph::removeNodes().
+        /// \note The edges must be thawed, and the indices checked.
+        void unlinkNodes(const QVector<TIndex> & indices)
+        {
+            const int num = _edges.size();
+
+            QBitArray removed(num);
+            foreach (const TIndex & index, indices)
+                removed.setBit(index);
+
+            // a tiling whose nodes are all removed is simply forgotten; one that loses only some of them has its edges listed
+            for (int t = _tilings.size() - 1; t >= 0; --t)
+            {
+                const Tiling & tiling = _tilings[t];
+                const int num_tiles = tiling.numTiles(), pattern_size = tiling.patternSize();
+
+                int count = 0;
+                for (int tile = 0; tile < num_tiles; ++tile)
+                {
+                    const int first = tiling.tileFirst(tile);
+                    for (int i = first; i < first + pattern_size; ++i)
+                    {
+                        if (removed.testBit(i))
+                            ++count;
+                    }
+                }
+
+                if (count == tiling.size())
+                {
+                    _tilings.removeAt(t);
+                    indexTiles();
+                }
+                else if (count > 0)
+                {
+                    expandTiling(t);
+                }
+            }
+
+            buildEdgesTo();
+
+            // find the remaining nodes whose lists refer to the removed nodes
+            QBitArray touched_from(num), touched_to(num);
+            QVector<TIndex> sources, destinations;
+
+            foreach (const TIndex & index, indices)
+            {
+                foreach (const TIndex & to, _edges[index])
+                {
+                    if (!removed.testBit(to) && !touched_to.testBit(to))
+                    {
+                        touched_to.setBit(to);
+                        destinations.append(to);
+                    }
+                }
+
+                foreach (const TIndex & src, _edges_to[index])
+                {
+                    if (!removed.testBit(src) && !touched_from.testBit(src))
+                    {
+                        touched_from.setBit(src);
+                        sources.append(src);
+                    }
+                }
+            }
+
+            foreach (const TIndex & src, sources)
+                removeFromList(_edges[src], removed);
+            foreach (const TIndex & to, destinations)
+                removeFromList(_edges_to[to], removed);
+
+            foreach (const TIndex & index, indices)
+            {
+                if (!removed.testBit(index))
+                    continue;
+
+                _edges[index].clear();
+                _edges_to[index].clear();
+                _free_nodes.push(index);
+                removed.clearBit(index);
+            }
+
+            _csr_dirty = true;
+        }
+
+        /// \return The tile that contains a node, or 0 if it is not tiled.  Binary-searches the tiles' first indices.
+        const TileRef * tileOf(const int & index) const
+        {
+            if (_tile_refs.isEmpty())
+                return 0;
+
+            TileRef key;
+            key.first = index;
+
+            typename QVector<TileRef>::const_iterator i = qUpperBound(_tile_refs.constBegin(), _tile_refs.constEnd(), key);
+            if (i == _tile_refs.constBegin())
+                return 0;
+
+            --i;
+            if (index >= i->first + _tilings[i->tiling].patternSize())
+                return 0;
+
+            return &*i;
+        }
+
+        /// Rebuilds the sorted list of tiles that Graph::tileOf() searches; called whenever \c _tilings changes.
+        void indexTiles()
+        {
+            _tile_refs.clear();
+
+            const int num = _tilings.size();
+            for (int t = 0; t < num; ++t)
+            {
+                const int num_tiles = _tilings[t].numTiles();
+                for (int tile = 0; tile < num_tiles; ++tile)
+                {
+                    TileRef ref;
+                    ref.first = _tilings[t].tileFirst(tile);
+                    ref.tiling = t;
+                    ref.tile = tile;
+                    _tile_refs.append(ref);
+                }
+            }
+
+            qSort(_tile_refs.begin(), _tile_refs.end());
+        }
+
+        /// Lists the edges that a tiling gives its nodes along with their other edges, and forgets the tiling.
+        /// Called before anything that changes the edges of some of the tiled nodes, or needs them listed.
+        /// \note The edges must be thawed.
+        void expandTiling(const int & t)
+        {
+            const Tiling tiling = _tilings.takeAt(t);
+            indexTiles();
+
+            const int num_tiles = tiling.numTiles(), pattern_size = tiling.patternSize();
+            for (int tile = 0; tile < num_tiles; ++tile)
+            {
+                const int first = tiling.tileFirst(tile);
+                for (int node = 0; node < pattern_size; ++node)
+                {
+                    const int index = first + node;
+
+                    QVector<TIndex> listed(tiling.maxNeighbors(node));
+                    listed.resize(tiling.neighbors(tile, node, listed.data()));
+
+                    if (_edges_to_valid)
+                    {
+                        foreach (const TIndex & to, listed)
+                            _edges_to[to].append(static_cast<TIndex>(index));
+                    }
+
+                    listed += _edges[index];
+                    _edges[index] = listed;
+                }
+            }
+        }
+
+        /// Gets all the edges from a node, including those from its tiling, without listing the tiling's edges.
+        /// \note The edges must be thawed.
+        void edgesOf(const TIndex & index, QVector<TIndex> & result) const
+        {
+            const TileRef *ref = tileOf(index);
+            if (!ref)
+            {
+                result = _edges[index];
+                return;
+            }
+
+            const Tiling & tiling = _tilings[ref->tiling];
+            const int node = index - ref->first;
+
+            result.resize(tiling.maxNeighbors(node));
+            result.resize(tiling.neighbors(ref->tile, node, result.data()));
+            result += _edges[index];
+        }
+
+        /// Builds the lists of incoming edges, if they were not built when the graph was loaded.
+        /// \note The edges must be thawed.
+        void buildEdgesTo()
+        {
+            if (_edges_to_valid)
+                return;
+
+            const int num = _edges.size();
+
+            QVector<int> counts(num, 0);
+            for (int from = 0; from < num; ++from)
+            {
+                foreach (const TIndex & to, _edges[from])
+                    ++counts[to];
+            }
+
+            _edges_to.clear();
+            _edges_to.resize(num);
+            for (int to = 0; to < num; ++to)
+                _edges_to[to].reserve(counts[to]);
+
+            for (int from = 0; from < num; ++from)
+            {
+                foreach (const TIndex & to, _edges[from])
+                    _edges_to[to].append(static_cast<TIndex>(from));
+            }
+
+            _edges_to_valid = true;
+        }
+
+        /// \return Whether there is an edge between two nodes.  Searches the shorter of the source's outgoing
+        /// and the destination's incoming edges, so it is quick if either node has few edges.
+        /// \note The edges must be thawed, and the incoming edges built.
+        bool hasEdge(const TIndex & from, const TIndex & to) const
+        {
+            const QVector<TIndex> & outgoing = _edges[from];
+            const QVector<TIndex> & incoming = _edges_to[to];
+
+            if (incoming.size() < outgoing.size() ? incoming.contains(from) : outgoing.contains(to))
+                return true;
+
+            const TileRef *ref = tileOf(from);
+            return ref && _tilings[ref->tiling].hasNeighbor(ref->tile, from - ref->first, to);
+        }
+
+        /// Adds an edge in one direction, unless it is already there.
+        /// \note The edges must be thawed, and the incoming edges built.
+        void linkEdge(const TIndex & from, const TIndex & to)
+        {
+            if (hasEdge(from, to))
+                return;
+
+            _edges[from].append(to);
+            _edges_to[to].append(from);
+        }
+
+        /// Removes an edge in one direction, if it is there.
+        /// \note The edges must be thawed, and the incoming edges built.
+        void unlinkEdge(const TIndex & from, const TIndex & to)
+        {
+            const TileRef *ref = tileOf(from);
+            if (ref && _tilings[ref->tiling].hasNeighbor(ref->tile, from - ref->first, to))
+                expandTiling(ref->tiling);
+
+            if (removeFromList(_edges[from], to))
+                takeFromList(_edges_to[to], from);
+        }
+
+        /// Throws Common::IndexOverflow if any of the edges refers to a node that is not in the graph.
+        void checkEdges(const QVector<Edge> & edges) const
+        {
+            const int num = _edges.size();
+            foreach (const Edge & edge, edges)
+            {
+                if (edge.first >= num || edge.second >= num)
+                    throw Common::IndexOverflow();
+            }
+        }
+
+        /// Removes a value from a list of edges, keeping the others in order; the order of a node's edges
+        /// is the order in which its neighbors' values are summed, so it must not change.
+        /// \return Whether the value was in the list.
+        static bool removeFromList(QVector<TIndex> & list, const TIndex & value)
+        {
+            const int i = list.indexOf(value);
+            if (i == -1)
+                return false;
+
+            list.remove(i);
+            return true;
+        }
+
+        /// Removes a value from a list of incoming edges by moving the last value into its place; the order of
+        /// a node's incoming edges does not matter, so this saves moving the rest of the list.
+        /// \return Whether the value was in the list.
+        static bool takeFromList(QVector<TIndex> & list, const TIndex & value)
+        {
+            const int i = list.indexOf(value);
+            if (i == -1)
+                return false;
+
+            list[i] = list.last();
+            list.resize(list.size() - 1);
+            return true;
+        }
+
+        /// Removes all the values in a sorted list from a list of edges in one pass, keeping the others in order.
+        static void removeFromList(QVector<TIndex> & list, const QVector<TIndex> & sorted)
+        {
+            const int num = list.size();
+            TIndex *values = list.data();
+
+            int kept = 0;
+            for (int i = 0; i < num; ++i)
+            {
+                if (qBinaryFind(sorted.constBegin(), sorted.constEnd(), values[i]) == sorted.constEnd())
+                    values[kept++] = values[i];
+            }
+
+            list.resize(kept);
+        }
+
+        /// Removes all the nodes marked in a bit array from a list of edges, keeping the others in order.
+        static void removeFromList(QVector<TIndex> & list, const QBitArray & removed)
+        {
+            const int num = list.size();
+            TIndex *values = list.data();
+
+            int kept = 0;
+            for (int i = 0; i < num; ++i)
+            {
+                if (!removed.testBit(values[i]))
+                    values[kept++] = values[i];
+            }
+
+            list.resize(kept);
+        }
+
+        /// \return The number of bytes written by Graph::writeFrozenEdges() for a graph of the given size.
+        static qint64 frozenEdgesSize(const int & num_nodes, const int & num_edges)
+        {
+            return (static_cast<qint64>(num_nodes) + 1 + num_edges) * sizeof(quint32);
+        }
+
+        /// Writes the frozen layout of the edges, for Automata::AUTOMATA_FILE_VERSION_4: the offsets of each node's
+        /// edges, then all the edges, as little-endian 32-bit integers that can be used straight from a mapped file.
+        /// \note Builds the frozen layout if necessary.
+        void writeFrozenEdges(QDataStream & ds) const
+        {
+            const_cast<Graph<TNode, TIndex> *>(this)->freezeEdges();
+
+            writeLittleEndian(ds, _csr_offsets.constData(), _csr_offsets.size());
+            writeLittleEndian(ds, _csr_edges.constData(), _csr_edges.size());
+        }
+
+        /// Adopts edges in the frozen layout, as written by Graph::writeFrozenEdges().
+        /// \param data The offsets followed by the edges.
+        void readFrozenEdges(const uchar *data, const int & num_nodes, const int & num_edges)
+        {
+            QVector<int> offsets(num_nodes + 1);
+            QVector<TIndex> edges(num_edges);
+
+            readLittleEndian(data, offsets.data(), num_nodes + 1);
+            readLittleEndian(data + (num_nodes + 1) * sizeof(quint32), edges.data(), num_edges);
+
+            adoptFrozenEdges(offsets, edges);
+        }
+
+        /// Adopts edges in the frozen layout, after checking that they are consistent with each other and the nodes.
+        /// The per-node edge lists are only built if they are needed; see Graph::thawEdges().
+        void adoptFrozenEdges(const QVector<int> & offsets, const QVector<TIndex> & edges)
+        {
+            QWriteLocker ewl(&_edges_lock);
+
+            const int num_nodes = offsets.size() - 1;
+            const int num_edges = edges.size();
+
+            if (num_nodes < 0 || offsets[0] != 0 || offsets[num_nodes] != num_edges)
+                throw Common::FileFormatError();
+
+            for (int i = 0; i < num_nodes; ++i)
+            {
+                if (offsets[i + 1] < offsets[i])
+                    throw Common::FileFormatError();
+            }
+
+            for (int j = 0; j < num_edges; ++j)
+            {
+                if (edges[j] < 0 || edges[j] >= num_nodes)
+                    throw Common::FileFormatError();
+            }
+
+            _csr_offsets = offsets;
+            _csr_edges = edges;
+
+            _edges.clear();
+            _edges_to.clear();
+            _edges_to_valid = false;
+            _edges_in_csr = true;
+            _tilings.clear();
+            _tile_refs.clear();
+            _csr_dirty = false;
+            _csr_reverse_valid = false;
+        }
+
+        /// Writes 32-bit integers in little-endian order.
+        template <typename T>
+        static void writeLittleEndian(QDataStream & ds, const T *values, const int & num)
+        {
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+            if (sizeof(T) == sizeof(quint32))
+            {
+                ds.writeRawData(reinterpret_cast<const char *>(values), num * sizeof(quint32));
+                return;
+            }
+#endif
+            uchar buf[sizeof(quint32)];
+            for (int i = 0; i < num; ++i)
+            {
+                qToLittleEndian<quint32>(static_cast<quint32>(values[i]), buf);
+                ds.writeRawData(reinterpret_cast<const char *>(buf), sizeof(quint32));
+            }
+        }
+
+        /// Reads 32-bit integers in little-endian order.
+        template <typename T>
+        static void readLittleEndian(const uchar *data, T *values, const int & num)
+        {
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+            if (sizeof(T) == sizeof(quint32))
+            {
+                ::memcpy(values, data, num * sizeof(quint32));
+                return;
+            }
+#endif
+            for (int i = 0; i < num; ++i)
+                values[i] = static_cast<T>(qFromLittleEndian<quint32>(data + i * sizeof(quint32)));
+        }
     };
 
 } // namespace Automata
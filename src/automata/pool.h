@@ -40,85 +40,48 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "automata_global.h"
 
 #include <QVector>
-#include <QStack>
-#include <QReadWriteLock>
-#include <QWriteLocker>
+#include <QThreadStorage>
 
 namespace Automata
 {
 
-    /// A simple pool of objects.
+    /// Gives each running thread a small index, so that per-thread data can be kept in plain arrays.
+    /// An index is reused once its thread has exited, so indices stay below the number of threads running at once.
+    class AUTOMATASHARED_EXPORT ThreadIndex
+    {
+    public:
+        /// \return The index of the calling thread.
+        static int current();
+    };
+
+    /// A scratch array for each thread, for temporary data such as copies of a cell's neighbors.
+    /// The array grows as needed and is reused by later calls in the same thread, without locking.
+    /// All scratch objects with the same item type share the same per-thread array, so a thread must not use
+    /// the data from one call after making another.
     template <typename T>
-    class Pool
+    class ThreadScratch
     {
-        QVector<T*> items;
-        QStack<T*> free_items;
-        QReadWriteLock lock;
+        static QThreadStorage<QVector<T> *> arrays;
 
     public:
-        /// Constructor.
-        /// \param initial_capacity The number of objects to initially create.
-        Pool(const int initial_capacity = 0)
-        {
-            for (int i = 0; i < initial_capacity; ++i)
-            {
-                T *item = new T();
-                items.append(item);
-                free_items.push(item);
-            }
-        }
-
-        /// Destructor.
-        virtual ~Pool()
+        /// \return A pointer to at least \c num items of the calling thread's scratch array.
+        /// \note The items may not be initialized, if they were used before.
+        inline T *data(const int & num)
         {
-            for (int i = 0; i < items.size(); ++i)
-                delete items[i];
-        }
+            if (!arrays.hasLocalData())
+                arrays.setLocalData(new QVector<T>());
 
-        /// A convenience class for automatically allocating and releasing an item from the pool in RAII style.
-        class Item
-        {
-            Pool<T> & pool;
-        public:
-            /// A pointer to the item from the pool.
-            T *data;
-
-            /// Constructor.
-            /// \param pool The pool from which to get an item.
-            Item(Pool<T> & pool) : pool(pool), data(pool.getItem()) {}
-            ~Item() { pool.returnItem(data); }
-        };
-
-    protected:
-
-        /// Get an item from the pool.
-        /// \note The item may not be initialized, if it was used before.
-        /// \return An item from the pool.
-        T *getItem()
-        {
-            QWriteLocker l(&lock);
-
-            if (free_items.size() > 0)
-            {
-                T *item = free_items.pop();
-                return item;
-            }
-            else
-            {
-                T *item = new T();
-                items.append(item);
-                return item;
-            }
-        }
+            QVector<T> *array = arrays.localData();
+            if (array->size() < num)
+                array->resize(num);
 
-        /// Releases a pool item for use by other code.
-        void returnItem(T *item)
-        {
-            QWriteLocker l(&lock);
-            free_items.push(item);
+            return array->data();
         }
     };
 
+    template <typename T>
+    QThreadStorage<QVector<T> *> ThreadScratch<T>::arrays;
+
 }
 
 #endif // POOL_H
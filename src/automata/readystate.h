@@ -0,0 +1,120 @@
+#ifndef READYSTATE_H
+#define READYSTATE_H
+
+/*
+Neurocognitive Linguistics Lab
+Copyright (c) 2010,2011 Gordon Tisher
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+ - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+ - Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in
+   the documentation and/or other materials provided with the
+   distribution.
+
+ - Neither the name of the Neurocognitive Linguistics Lab nor the
+   names of its contributors may be used to endorse or promote
+   products derived from this software without specific prior
+   written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "automata_global.h"
+
+#include <QtGlobal>
+#include <QAtomicInt>
+
+#if QT_VERSION < 0x050000 && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace Automata
+{
+
+    /// The ready state of a cell in an asynchronous automaton, which tells the cell's neighbors which copy of its state they may read.
+    /// Stores have release semantics and loads have acquire semantics, so a thread that loads a ready state
+    /// also sees the writes to the cell's state that were made before it was stored.
+    class ReadyState
+    {
+        QAtomicInt _value;
+
+    public:
+        //@{
+        /// Constructor.
+        ReadyState(const int & value = 0) : _value(value) {}
+        ReadyState(const ReadyState & other) : _value(other.load()) {}
+        //@}
+
+        //@{
+        /// Assignment operator.
+        ReadyState & operator= (const ReadyState & other) { store(other.load()); return *this; }
+        ReadyState & operator= (const int & value) { store(value); return *this; }
+        //@}
+
+        /// \return The ready state.
+        operator int() const { return load(); }
+
+        /// \return The ready state, with acquire semantics.
+        int load() const
+        {
+#if QT_VERSION >= 0x050000
+            return _value.loadAcquire();
+#elif defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+            // x86 does not reorder loads with other loads, so it is enough to keep the compiler from doing so
+            const int value = _value;
+            compilerBarrier();
+            return value;
+#else
+            return const_cast<QAtomicInt &>(_value).fetchAndAddAcquire(0);
+#endif
+        }
+
+        /// Sets the ready state, with release semantics.
+        void store(const int & value)
+        {
+#if QT_VERSION >= 0x050000
+            _value.storeRelease(value);
+#elif defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+            // x86 does not reorder stores with earlier loads or stores
+            compilerBarrier();
+            _value = value;
+#else
+            _value.fetchAndStoreRelease(value);
+#endif
+        }
+
+    private:
+#if QT_VERSION < 0x050000
+        static inline void compilerBarrier()
+        {
+#if defined(_MSC_VER)
+            _ReadWriteBarrier();
+#else
+            __asm__ __volatile__("" ::: "memory");
+#endif
+        }
+#endif
+    };
+
+} // namespace Automata
+
+
+#endif // READYSTATE_H
@@ -0,0 +1,257 @@
+/*
+Neurocognitive Linguistics Lab
+Copyright (c) 2010,2011 Gordon Tisher
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+ - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+ - Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in
+   the documentation and/or other materials provided with the
+   distribution.
+
+ - Neither the name of the Neurocognitive Linguistics Lab nor the
+   names of its contributors may be used to endorse or promote
+   products derived from this software without specific prior
+   written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "steppool.h"
+
+#include <QThread>
+#include <QMutexLocker>
+
+namespace Automata
+{
+
+    /// The number of chunks in a share must fit in the 15 bits of its packed range.
+    static const int MAX_CHUNKS_PER_SHARE = 0x7fff;
+
+    static inline int packRange(const int & front, const int & back)
+    {
+        return (front << 16) | back;
+    }
+
+    /// \internal A persistent thread of a StepPool.
+    class StepPool::Worker
+        : public QThread
+    {
+        StepPool & _pool;
+        int _share;
+
+    public:
+        Worker(StepPool & pool, const int & share)
+            : QThread(), _pool(pool), _share(share)
+        {
+        }
+
+    protected:
+        virtual void run()
+        {
+            int generation = 0;
+
+            forever
+            {
+                {
+                    QMutexLocker ml(&_pool._mutex);
+
+                    while (_pool._generation == generation && !_pool._quit)
+                        _pool._start.wait(&_pool._mutex);
+
+                    if (_pool._quit)
+                        return;
+
+                    generation = _pool._generation;
+                }
+
+                _pool.work(_share);
+
+                {
+                    QMutexLocker ml(&_pool._mutex);
+
+                    if (--_pool._busy == 0)
+                        _pool._done.wakeAll();
+                }
+            }
+        }
+    };
+
+    StepPool::StepPool(const int & num_threads)
+        : _shares(0), _generation(0), _busy(0), _quit(false), _task(0), _num(0), _chunk_size(1)
+    {
+        int num = num_threads > 0 ? num_threads : QThread::idealThreadCount();
+        if (num < 1)
+            num = 1;
+
+        _shares = new Share[num];
+
+        for (int i = 1; i < num; ++i)
+        {
+            Worker *worker = new Worker(*this, i);
+            _workers.append(worker);
+            worker->start();
+        }
+    }
+
+    StepPool::~StepPool()
+    {
+        {
+            QMutexLocker ml(&_mutex);
+            _quit = true;
+            _start.wakeAll();
+        }
+
+        foreach (Worker *worker, _workers)
+        {
+            worker->wait();
+            delete worker;
+        }
+
+        delete [] _shares;
+    }
+
+    Q_GLOBAL_STATIC(StepPool, globalStepPool)
+
+    StepPool *StepPool::globalInstance()
+    {
+        return globalStepPool();
+    }
+
+    void StepPool::run(Task *task, const int & num, const int & chunk_size)
+    {
+        if (num <= 0)
+            return;
+
+        QMutexLocker rl(&_run_lock);
+
+        const int num_shares = numThreads();
+
+        // make sure each share's chunks can be packed
+        int size = qMax(chunk_size, 1);
+        if ((num + size - 1) / size > MAX_CHUNKS_PER_SHARE * num_shares)
+            size = (num + MAX_CHUNKS_PER_SHARE * num_shares - 1) / (MAX_CHUNKS_PER_SHARE * num_shares);
+
+        const int num_chunks = (num + size - 1) / size;
+
+        // not worth waking the workers
+        if (num_chunks == 1 || num_shares == 1)
+        {
+            task->run(0, num);
+            return;
+        }
+
+        _task = task;
+        _num = num;
+        _chunk_size = size;
+
+        const int per_share = num_chunks / num_shares;
+        const int extra = num_chunks % num_shares;
+        int first = 0;
+
+        for (int i = 0; i < num_shares; ++i)
+        {
+            const int count = per_share + (i < extra ? 1 : 0);
+            _shares[i].first = first;
+            _shares[i].range = packRange(0, count);
+            first += count;
+        }
+
+        {
+            QMutexLocker ml(&_mutex);
+            _busy = _workers.size();
+            ++_generation;
+            _start.wakeAll();
+        }
+
+        work(0);
+
+        {
+            QMutexLocker ml(&_mutex);
+            while (_busy > 0)
+                _done.wait(&_mutex);
+        }
+
+        _task = 0;
+    }
+
+    void StepPool::work(const int & share)
+    {
+        const int num_shares = numThreads();
+        int chunk;
+
+        while (takeFront(_shares[share], chunk))
+        {
+            const int begin = chunk * _chunk_size;
+            _task->run(begin, qMin(begin + _chunk_size, _num));
+        }
+
+        // shares only ever shrink, so one pass over the others leaves no chunks behind
+        for (int i = 1; i < num_shares; ++i)
+        {
+            Share & victim = _shares[(share + i) % num_shares];
+
+            while (takeBack(victim, chunk))
+            {
+                const int begin = chunk * _chunk_size;
+                _task->run(begin, qMin(begin + _chunk_size, _num));
+            }
+        }
+    }
+
+    bool StepPool::takeFront(Share & share, int & chunk)
+    {
+        forever
+        {
+            const int range = share.range;
+            const int front = range >> 16;
+            const int back = range & 0xffff;
+
+            if (front >= back)
+                return false;
+
+            if (share.range.testAndSetOrdered(range, packRange(front + 1, back)))
+            {
+                chunk = share.first + front;
+                return true;
+            }
+        }
+    }
+
+    bool StepPool::takeBack(Share & share, int & chunk)
+    {
+        forever
+        {
+            const int range = share.range;
+            const int front = range >> 16;
+            const int back = range & 0xffff;
+
+            if (front >= back)
+                return false;
+
+            if (share.range.testAndSetOrdered(range, packRange(front, back - 1)))
+            {
+                chunk = share.first + back - 1;
+                return true;
+            }
+        }
+    }
+
+} // namespace Automata
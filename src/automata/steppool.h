@@ -0,0 +1,126 @@
+#ifndef STEPPOOL_H
+#define STEPPOOL_H
+
+/*
+Neurocognitive Linguistics Lab
+Copyright (c) 2010,2011 Gordon Tisher
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+ - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+ - Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in
+   the documentation and/or other materials provided with the
+   distribution.
+
+ - Neither the name of the Neurocognitive Linguistics Lab nor the
+   names of its contributors may be used to endorse or promote
+   products derived from this software without specific prior
+   written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "automata_global.h"
+
+#include <QList>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+
+namespace Automata
+{
+
+    /// A pool of persistent threads for stepping automata.
+    /// A run splits a range of cells into chunks, and gives each participating thread (including the caller)
+    /// a contiguous share of the chunks.  A thread takes chunks from the front of its own share, and when it runs out,
+    /// steals chunks from the back of the others' shares.  The threads wait between runs rather than exiting,
+    /// so a step does not pay for starting threads or for per-cell task bookkeeping.
+    class AUTOMATASHARED_EXPORT StepPool
+    {
+    public:
+        /// The work done by a run of the pool.
+        class AUTOMATASHARED_EXPORT Task
+        {
+        public:
+            virtual ~Task() {}
+
+            /// Processes the cells in <tt>[begin, end)</tt>.  Called concurrently for disjoint ranges.
+            virtual void run(const int & begin, const int & end) = 0;
+        };
+
+        /// Constructor.
+        /// \param num_threads The number of threads that work on a run, including the calling thread.
+        ///        If less than 1, uses <tt>QThread::idealThreadCount()</tt>.
+        StepPool(const int & num_threads = 0);
+
+        /// Destructor.  Stops the threads.
+        ~StepPool();
+
+        /// \return The number of threads that work on a run, including the calling thread.
+        int numThreads() const { return _workers.size() + 1; }
+
+        /// Processes the cells in <tt>[0, num)</tt> in chunks of \c chunk_size cells.
+        /// The calling thread takes part, and the call blocks until all the chunks are done.
+        /// Concurrent calls are run one after the other.
+        void run(Task *task, const int & num, const int & chunk_size);
+
+        /// \return The pool shared by all automata.
+        static StepPool *globalInstance();
+
+    private:
+        class Worker;
+        friend class Worker;
+
+        /// A share of the chunks; padded so that different threads' shares don't share a cache line.
+        struct Share
+        {
+            int first;         ///< The first chunk of the share.
+            QAtomicInt range;  ///< The front and back of the remaining chunks, relative to \c first, packed into 15 bits each.
+            char _pad[64 - sizeof(int) - sizeof(QAtomicInt)];
+        };
+
+        /// Does chunks from a thread's own share, then steals from the others, until there are none left.
+        void work(const int & share);
+
+        /// Takes a chunk from the front of a share.
+        bool takeFront(Share & share, int & chunk);
+
+        /// Takes a chunk from the back of a share.
+        bool takeBack(Share & share, int & chunk);
+
+        QList<Worker *> _workers;
+        Share *_shares;
+
+        QMutex _run_lock;      ///< Serializes runs.
+        QMutex _mutex;         ///< Protects the members below.
+        QWaitCondition _start; ///< Signals the workers that a run has started, or that they should quit.
+        QWaitCondition _done;  ///< Signals the caller that all workers are done.
+        int _generation;       ///< Incremented for each run.
+        int _busy;             ///< Number of workers still working on the current run.
+        bool _quit;
+
+        Task *_task;
+        int _num;
+        int _chunk_size;
+    }; // class StepPool
+
+} // namespace Automata
+
+#endif // STEPPOOL_H
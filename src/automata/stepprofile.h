@@ -0,0 +1,93 @@
+#ifndef STEPPROFILE_H
+#define STEPPROFILE_H
+
+/*
+Neurocognitive Linguistics Lab
+Copyright (c) 2010,2011 Gordon Tisher
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+ - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+ - Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in
+   the documentation and/or other materials provided with the
+   distribution.
+
+ - Neither the name of the Neurocognitive Linguistics Lab nor the
+   names of its contributors may be used to endorse or promote
+   products derived from this software without specific prior
+   written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "automata_global.h"
+
+#include <QtGlobal>
+
+namespace Automata
+{
+
+    /// Timings and counters gathered while an automaton steps with profiling on (see Automaton::setProfiling()).
+    /// The totals accumulate until Automaton::clearProfile() is called.
+    struct StepProfile
+    {
+        /// The number of phases that are timed separately; an asynchronous timestep takes three steps.
+        static const int NUM_PHASES = 3;
+
+        qint64 phase_steps[NUM_PHASES];  ///< The number of steps taken in each phase.
+        qint64 phase_nsecs[NUM_PHASES];  ///< Wall time spent in the steps of each phase.
+        qint64 post_updates;             ///< The number of post-update passes (see NeuroLib::NeuroNet::postUpdate()).
+        qint64 post_update_nsecs;        ///< Wall time spent in post-update passes.
+        qint64 cells_updated;            ///< The number of cell updates that advanced a cell.
+        qint64 cells_stalled;            ///< The number of cell updates that did nothing, because a neighbor was not ready.
+
+        StepProfile() { clear(); }
+
+        /// Resets all the timings and counters to zero.
+        void clear()
+        {
+            for (int i = 0; i < NUM_PHASES; ++i)
+                phase_steps[i] = phase_nsecs[i] = 0;
+            post_updates = post_update_nsecs = 0;
+            cells_updated = cells_stalled = 0;
+        }
+
+        /// \return The total number of steps taken.
+        qint64 totalSteps() const
+        {
+            qint64 result = 0;
+            for (int i = 0; i < NUM_PHASES; ++i)
+                result += phase_steps[i];
+            return result;
+        }
+
+        /// \return The total wall time spent stepping, not counting post-updates.
+        qint64 totalNsecs() const
+        {
+            qint64 result = 0;
+            for (int i = 0; i < NUM_PHASES; ++i)
+                result += phase_nsecs[i];
+            return result;
+        }
+    };
+
+} // namespace Automata
+
+#endif // STEPPROFILE_H
@@ -0,0 +1,228 @@
+#ifndef TILING_H
+#define TILING_H
+
+/*
+Neurocognitive Linguistics Lab
+Copyright (c) 2010,2011 Gordon Tisher
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+ - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+ - Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in
+   the documentation and/or other materials provided with the
+   distribution.
+
+ - Neither the name of the Neurocognitive Linguistics Lab nor the
+   names of its contributors may be used to endorse or promote
+   products derived from this software without specific prior
+   written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "automata_global.h"
+
+#include <QtGlobal>
+#include <QVector>
+
+namespace Automata
+{
+
+    /// A grid of tiles, each of them a copy of the same pattern of nodes, whose edges are stored once for the pattern
+    /// rather than for each tile.  Each tile holds its copies of the pattern nodes at consecutive indices, in pattern order,
+    /// so the index of a node's neighbor in the same or an adjacent tile is found by arithmetic from the first indices
+    /// of the tiles.  The tiles are numbered in row order.  The columns wrap around; the rows do not.
+    /// \see Graph::addTiles()
+    class Tiling
+    {
+    public:
+        /// The tile in which the destination of a pattern edge lies, relative to the tile of its source.
+        enum Side
+        {
+            SAME_TILE = 0,
+            TILE_ABOVE,    ///< The tile in the previous row; no edge in the first row.
+            TILE_BELOW,    ///< The tile in the next row; no edge in the last row.
+            TILE_LEFT,     ///< The tile in the previous column, wrapping around.
+            TILE_RIGHT     ///< The tile in the next column, wrapping around.
+        };
+
+        /// An edge from a pattern node to a pattern node in the same or an adjacent tile.
+        struct Link
+        {
+            qint32 to;     ///< The number of the destination in the pattern.
+            qint32 side;   ///< The tile of the destination (see Tiling::Side).
+        };
+
+    private:
+        int _pattern_size;
+        int _num_cols, _num_rows;
+        QVector<int> _tile_first;        ///< The index of the first node of each tile.
+        QVector< QVector<Link> > _links; ///< The edges of each pattern node, in the order they are added.
+
+    public:
+        /// Constructor.
+        /// \param pattern_size The number of nodes in each tile.
+        /// \param num_cols The number of columns of tiles.
+        /// \param num_rows The number of rows of tiles.
+        Tiling(const int & pattern_size = 0, const int & num_cols = 1, const int & num_rows = 1)
+            : _pattern_size(pattern_size), _num_cols(qMax(num_cols, 1)), _num_rows(qMax(num_rows, 1)),
+              _tile_first(_num_cols * _num_rows, 0), _links(pattern_size)
+        {
+        }
+
+        /// Places the tiles at consecutive indices, starting from the given index; done by Graph::addTiles().
+        void setFirst(const int & first)
+        {
+            const int num_tiles = numTiles();
+            for (int tile = 0; tile < num_tiles; ++tile)
+                _tile_first[tile] = first + tile * _pattern_size;
+        }
+
+        /// \return The index of the first node of a tile.
+        int tileFirst(const int & tile) const { return _tile_first[tile]; }
+
+        /// Sets the index of the first node of a tile; done by Graph::resizeTiles() and Graph::adoptTiles().
+        void setTileFirst(const int & tile, const int & first) { _tile_first[tile] = first; }
+
+        /// \return The number of nodes in each tile.
+        int patternSize() const { return _pattern_size; }
+
+        int numCols() const { return _num_cols; }
+        int numRows() const { return _num_rows; }
+        int numTiles() const { return _num_cols * _num_rows; }
+
+        /// Changes the number of columns and rows, keeping the tiles that are in both grids, with their first indices.
+        /// The first indices of the new tiles must be set afterwards.
+        void resize(const int & num_cols, const int & num_rows)
+        {
+            const int new_cols = qMax(num_cols, 1), new_rows = qMax(num_rows, 1);
+
+            QVector<int> tile_first(new_cols * new_rows, 0);
+            for (int row = 0; row < qMin(_num_rows, new_rows); ++row)
+            {
+                for (int col = 0; col < qMin(_num_cols, new_cols); ++col)
+                    tile_first[row * new_cols + col] = _tile_first[row * _num_cols + col];
+            }
+
+            _num_cols = new_cols;
+            _num_rows = new_rows;
+            _tile_first = tile_first;
+        }
+
+        /// \return The number of nodes in the grid.
+        int size() const { return numTiles() * _pattern_size; }
+
+        /// Adds an edge from a pattern node to a pattern node in the same or an adjacent tile, for every tile that has such a neighbor.
+        /// The edges of a node are added to its tiles in the order in which they are added here, ahead of any other edges.
+        void addLink(const int & from, const int & to, const Side & side)
+        {
+            Link link;
+            link.to = to;
+            link.side = side;
+            _links[from].append(link);
+        }
+
+        /// \return The most edges any copy of a pattern node can have from its pattern.
+        /// \param node The number of the node in the pattern.
+        int maxNeighbors(const int & node) const { return _links[node].size(); }
+
+        /// Finds the nodes to which a node of the grid has edges from its pattern, leaving out edges that would lead off
+        /// the top or bottom of the grid, and duplicates, as Graph::addEdge() would.
+        /// \param tile The number of the node's tile.
+        /// \param node The number of the node in the pattern.
+        /// \param neighbors Receives the indices of the neighbors; must have room for Tiling::maxNeighbors() of them.
+        /// \return The number of neighbors.
+        template <typename TIndex>
+        int neighbors(const int & tile, const int & node, TIndex *neighbors) const
+        {
+            const int row = tile / _num_cols;
+            const int col = tile % _num_cols;
+
+            const QVector<Link> & links = _links[node];
+            const int num_links = links.size();
+
+            int num = 0;
+            for (int i = 0; i < num_links; ++i)
+            {
+                int to_row = row, to_col = col;
+
+                switch (links[i].side)
+                {
+                case TILE_ABOVE:
+                    if (--to_row < 0)
+                        continue;
+                    break;
+                case TILE_BELOW:
+                    if (++to_row >= _num_rows)
+                        continue;
+                    break;
+                case TILE_LEFT:
+                    to_col = (col + _num_cols - 1) % _num_cols;
+                    break;
+                case TILE_RIGHT:
+                    to_col = (col + 1) % _num_cols;
+                    break;
+                default:
+                    break;
+                }
+
+                const TIndex to = static_cast<TIndex>(_tile_first[to_row * _num_cols + to_col] + links[i].to);
+
+                int j = 0;
+                while (j < num && neighbors[j] != to)
+                    ++j;
+                if (j == num)
+                    neighbors[num++] = to;
+            }
+
+            return num;
+        }
+
+        /// \return Whether a node of the grid has an edge from its pattern to another node.
+        /// \param tile The number of the node's tile.
+        /// \param node The number of the node in the pattern.
+        template <typename TIndex>
+        bool hasNeighbor(const int & tile, const int & node, const TIndex & to) const
+        {
+            QVector<TIndex> buf(maxNeighbors(node));
+            const int num = neighbors(tile, node, buf.data());
+            for (int i = 0; i < num; ++i)
+            {
+                if (buf[i] == to)
+                    return true;
+            }
+            return false;
+        }
+
+        /// \return An estimate of the number of bytes taken by the pattern's edges and the tiles' first indices.
+        qint64 memoryUsed() const
+        {
+            qint64 bytes = static_cast<qint64>(_links.capacity()) * sizeof(QVector<Link>)
+                    + static_cast<qint64>(_tile_first.capacity()) * sizeof(int);
+            for (int i = 0; i < _links.size(); ++i)
+                bytes += static_cast<qint64>(_links[i].capacity()) * sizeof(Link);
+            return bytes;
+        }
+    };
+
+} // namespace Automata
+
+
+#endif // TILING_H
@@ -137,6 +137,8 @@ namespace GridItems
     {
         if (_grid_item)
         {
+            LabNetwork::HandlerTimer timer(_grid_item->network(), "GridViewer::postStep");
+
             _grid_item->copyColors();
             updateGL();
         }
@@ -273,10 +273,12 @@ namespace GridItems
     {
         if (_frontward_lines.size() > 0 && _frontward_lines.first().size() > 0)
         {
-            const NeuroNet::ASYNC_STATE *fcell = getCell(_frontward_lines.first().last());
+            NeuroNet::ASYNC_STATE fcell;
+            bool found = getCell(_frontward_lines.first().last(), fcell);
 
-            Q_ASSERT(fcell != 0);
-            return fcell->current().weight();
+            Q_ASSERT(found);
+            Q_UNUSED(found);
+            return fcell.current().weight();
         }
 
         return 0;
@@ -310,18 +312,18 @@ namespace GridItems
         {
             foreach (Index index, line)
             {
-                const NeuroNet::ASYNC_STATE *cell = getCell(index);
-                if (cell->current().outputValue() > max)
-                    max = cell->current().outputValue();
+                NeuroNet::ASYNC_STATE cell;
+                if (getCell(index, cell) && cell.current().outputValue() > max)
+                    max = cell.current().outputValue();
             }
         }
         foreach (QList<Index> line, _backward_lines)
         {
             foreach (Index index, line)
             {
-                const NeuroNet::ASYNC_STATE *cell = getCell(index);
-                if (cell->current().outputValue() > max)
-                    max = cell->current().outputValue();
+                NeuroNet::ASYNC_STATE cell;
+                if (getCell(index, cell) && cell.current().outputValue() > max)
+                    max = cell.current().outputValue();
             }
         }
 
@@ -479,16 +481,19 @@ namespace GridItems
         for (int i = 0; i < steps.size(); ++i)
         {
             qreal max = 0;
+            NeuroNet::ASYNC_STATE cell;
             foreach (QList<Index> line, _frontward_lines)
             {
-                const NeuroNet::ASYNC_STATE *cell = getCell(line[i]);
-                qreal val = qAbs(cell->current().outputValue());
+                if (!getCell(line[i], cell))
+                    continue;
+                qreal val = qAbs(cell.current().outputValue());
                 if (val > max) max = val;
             }
             foreach (QList<Index> line, _backward_lines)
             {
-                const NeuroNet::ASYNC_STATE *cell = getCell(line[(steps.size()-1) - i]);
-                qreal val = qAbs(cell->current().outputValue());
+                if (!getCell(line[(steps.size()-1) - i], cell))
+                    continue;
+                qreal val = qAbs(cell.current().outputValue());
                 if (val > max) max = val;
             }
 
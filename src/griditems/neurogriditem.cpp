@@ -45,6 +45,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "multigridioitem.h"
 
 #include <QtAlgorithms>
+#include <QtConcurrentMap>
 
 #include <cmath>
 #include <cfloat>
@@ -69,7 +70,8 @@ namespace GridItems
         : SubNetworkItem(network, scenePos, context),
           _horizontal_property(this, &NeuroGridItem::horizontalCols, &NeuroGridItem::setHorizontalCols, tr("Width")),
           _vertical_property(this, &NeuroGridItem::verticalRows, &NeuroGridItem::setVerticalRows, tr("Height")),
-          _num_horiz(1), _num_vert(1), _connections_changed(true), _pattern_changed(true)
+          _num_horiz(1), _num_vert(1), _connections_changed(true), _pattern_changed(true),
+          _grid_horiz(0), _grid_vert(0), _build(0)
     {
         if (context == NeuroItem::CREATE_UI)
         {
@@ -88,15 +90,17 @@ namespace GridItems
         connect(MainWindow::instance(), SIGNAL(itemDeleted(NeuroItem*)), this, SLOT(itemChanged(NeuroItem*)));
 
         connect(network, SIGNAL(stepClicked()), this, SLOT(networkStepClicked()));
-        connect(network, SIGNAL(postStep()), this, SLOT(networkPostStep()));
         connect(network, SIGNAL(stepFinished()), this, SLOT(networkStepFinished()));
 
-        connect(&_horizontal_property, SIGNAL(valueInBrowserChanged()), this, SLOT(propertyChanged()));
-        connect(&_vertical_property, SIGNAL(valueInBrowserChanged()), this, SLOT(propertyChanged()));
+        connect(&_build_watcher, SIGNAL(finished()), this, SLOT(gridBuilt()));
+        connect(&_build_watcher, SIGNAL(progressRangeChanged(int,int)), MainWindow::instance(), SLOT(setProgressRange(int,int)));
+        connect(&_build_watcher, SIGNAL(progressValueChanged(int)), MainWindow::instance(), SLOT(setProgressValue(int)));
     }
 
     NeuroGridItem::~NeuroGridItem()
     {
+        _build_watcher.waitForFinished();
+        delete _build;
     }
 
     void NeuroGridItem::makeSubNetwork()
@@ -107,22 +111,21 @@ namespace GridItems
 
     void NeuroGridItem::itemChanged(NeuroItem *item)
     {
-        if (item && item->scene() && this->treeNode() && (item == this || item->scene() == this->treeNode()->scene()))
+        // changes to the grid item itself (e.g. its number of tiles) don't change the pattern
+        if (item && item->scene() && this->treeNode() && item != this && item->scene() == this->treeNode()->scene())
             _pattern_changed = true;
     }
 
-    void NeuroGridItem::propertyChanged()
-    {
-        _pattern_changed = true;
-    }
-
     void NeuroGridItem::networkStepClicked()
     {
-        generateGrid();
-    }
+        LabNetwork::HandlerTimer timer(network(), "NeuroGridItem::networkStepClicked");
 
-    void NeuroGridItem::networkPostStep()
-    {
+        // a grid that is still being built is left to finish in the background, and the step uses the grid that is
+        // in the network now; it is swapped in when it is ready (see gridBuilt() and networkStepFinished())
+        if (_build && _build_watcher.isFinished())
+            finishGrid();
+
+        generateGrid();
     }
 
     void NeuroGridItem::networkStepFinished()
@@ -132,6 +135,10 @@ namespace GridItems
         _pattern_changed = false;
         _connections_changed = false;
 
+        // a grid that was finished during the step can be swapped in now
+        if (_build && _build_watcher.isFinished())
+            finishGrid();
+
 #ifdef DEBUG
         // dump graph
         {
@@ -284,6 +291,9 @@ namespace GridItems
         const int out_step = outgoing.size() / num_groups;
         const int in_step = incoming.size() / num_groups;
 
+        QVector<NeuroLib::NeuroNet::Edge> edges;
+        edges.reserve(num_groups * out_step * in_step);
+
         for (int i = 0; i < num_groups; ++i)
         {
             for (int j = 0; j < out_step; ++j)
@@ -294,10 +304,12 @@ namespace GridItems
                     int in_index = i * in_step + k;
 
                     if (out_index < outgoing.size() && in_index < incoming.size())
-                        neuronet->addEdge(incoming[in_index], outgoing[out_index]);
+                        edges.append(NeuroLib::NeuroNet::Edge(incoming[in_index], outgoing[out_index]));
                 }
             }
         }
+
+        neuronet->addEdges(edges);
     }
 
     void NeuroGridItem::addAllEdges(NeuroItem *except)
@@ -357,6 +369,8 @@ namespace GridItems
         Q_ASSERT(network()->neuronet());
         NeuroLib::NeuroNet *neuronet = network()->neuronet();
 
+        QVector<NeuroLib::NeuroNet::Edge> edges;
+
         foreach (NeuroItem *item, this->connections())
         {
             NeuroNetworkItem *ni = dynamic_cast<NeuroNetworkItem *>(item);
@@ -366,12 +380,14 @@ namespace GridItems
                 QMap<Index, Index>::const_iterator i = item_edges.constBegin(), end = item_edges.constEnd();
                 while (i != end)
                 {
-                    neuronet->removeEdge(i.key(), i.value());
+                    edges.append(NeuroLib::NeuroNet::Edge(i.key(), i.value()));
                     ++i;
                 }
                 _edges.remove(ni);
             }
         }
+
+        neuronet->removeEdges(edges);
     }
 
     void NeuroGridItem::onEnterView()
@@ -567,18 +583,10 @@ namespace GridItems
             gi->setPos(scenePos().x(), scenePos().y() + rect().height()/2 + gi->rect().height()/2);
     }
 
-    static QMap<NeuroGridItem::Index, NeuroGridItem::Index> &
-    get_to_copy(QVector<QMap<NeuroGridItem::Index, NeuroGridItem::Index> > & all_copies, int row, int col, int num_cols)
-    {
-        return all_copies[(row * num_cols) + col];
-    }
-
     static double GL_WIDTH = 2;
     static double GL_HEIGHT = 3;
 
-    static void set_gl_vertex(int & vertex_index, QVector<float> & vertices, QVector<float> & colors,
-                              QMap<NeuroGridItem::Index, int> & color_index,
-                              NeuroGridItem::Index cell_index, const QPointF & pt,
+    static void set_gl_vertex(int & vertex_index, float *vertices, const QPointF & pt,
                               float min_x, float max_x, float min_y, float max_y,
                               int col, int row, int num_cols, int num_rows)
     {
@@ -602,17 +610,10 @@ namespace GridItems
 
         y = GL_HEIGHT/2 - (((float)row + pat_y)/(float)num_rows) * GL_HEIGHT;
 
-        if (cell_index != -1)
-            color_index[cell_index] = vertex_index;
-
         vertices[vertex_index + 0] = x;
         vertices[vertex_index + 1] = y;
         vertices[vertex_index + 2] = z;
 
-        colors[vertex_index + 0] = 0;
-        colors[vertex_index + 1] = 0;
-        colors[vertex_index + 2] = 0;
-
         vertex_index += 3;
     }
 
@@ -621,260 +622,496 @@ namespace GridItems
     static const int LEFT = 2;
     static const int RIGHT = 3;
 
-    void NeuroGridItem::generateGrid()
+    /// \internal One tile of a grid being generated.
+    struct GridTile
     {
-        if (!network() || network()->loading() || !network()->neuronet() || !scene() || !treeNode() || !treeNode()->scene())
-            return;
+        GridBuild *build;
+        int row, col;
+    };
 
-        NeuroLib::NeuroNet *neuronet = network()->neuronet();
+    /// \internal A grid that is generated in the background, and swapped into the network when it is finished.
+    /// The cells of the grid are numbered tile by tile: the copy of the <tt>i</tt>th pattern cell in tile \c t is
+    /// number <tt>t * num_pattern_cells + i</tt>, which is also its offset from the first of its cells in the network.
+    /// The edges between them are not generated; they are given by \c tiling (see Automata::Graph::addTiles()).
+    struct GridBuild
+    {
+        int num_horiz, num_vert;
+        int num_pattern_cells;
+        float min_x, max_x, min_y, max_y;
 
-        if (_pattern_changed)
+        QVector<NeuroLib::NeuroCell> pattern_states; ///< The states of the pattern cells.
+
+        QVector<int> line_slots;                     ///< For each pattern cell, its place among a tile's lines, or -1.
+        QVector<int> point_slots;                    ///< For each pattern cell, its place among a tile's points, or -1.
+        QVector<QLineF> lines;
+        QVector<QPointF> points;
+        int lines_per_tile, points_per_tile;
+
+        Automata::Tiling tiling;                     ///< The edges of the pattern, within a tile and to the neighboring tiles.
+        QVector<int> top_incoming, top_outgoing;     ///< Pattern cells that connect to items outside the grid.
+        QVector<int> bot_incoming, bot_outgoing;
+
+        QVector<NeuroLib::NeuroCell> cells;          ///< The states of the grid's cells.
+        QVector<float> line_array, point_array;      ///< Geometry for the viewer.
+
+        QVector<GridTile> tiles;                     ///< The tiles, which are built concurrently.
+    };
+
+    /// \internal Adds connections between pattern cells to a tiling, by the pattern cells' numbers.
+    static void add_pattern_links(Automata::Tiling & tiling, const Automata::Tiling::Side & side,
+                                  const QMap<NeuroGridItem::Index, QVector<NeuroGridItem::Index> > & connections,
+                                  const QHash<NeuroGridItem::Index, int> & pattern_offsets)
+    {
+        QMap<NeuroGridItem::Index, QVector<NeuroGridItem::Index> >::const_iterator i = connections.constBegin(), end = connections.constEnd();
+        for (; i != end; ++i)
         {
-            MainWindow::instance()->setStatus(tr("Generating neural network grid..."));
-            QApplication::setOverrideCursor(Qt::WaitCursor);
+            const int in = pattern_offsets.value(i.key());
+            foreach (const NeuroGridItem::Index pat_out, i.value())
+                tiling.addLink(in, pattern_offsets.value(pat_out), side);
+        }
+    }
 
-            removeAllEdges();
+    /// \internal Converts pattern cells to their numbers.
+    static QVector<int> pattern_numbers(const QVector<NeuroGridItem::Index> & cells, const QHash<NeuroGridItem::Index, int> & pattern_offsets)
+    {
+        QVector<int> result;
+        result.reserve(cells.size());
+        foreach (const NeuroGridItem::Index index, cells)
+            result.append(pattern_offsets.value(index));
+        return result;
+    }
 
-            // remove old pattern cells
-            foreach (const Index & index, _all_grid_cells)
+    /// \internal Writes the viewer geometry for one tile of a grid.
+    static void tile_geometry(GridBuild & b, const int & row, const int & col)
+    {
+        const int t = row * b.num_horiz + col;
+        float *line_vertices = b.line_array.data() + t * b.lines_per_tile * 6;
+        float *point_vertices = b.point_array.data() + t * b.points_per_tile * 3;
+
+        for (int i = 0; i < b.num_pattern_cells; ++i)
+        {
+            if (b.line_slots.at(i) != -1)
             {
-                neuronet->removeNode(index);
+                int vertex_index = b.line_slots.at(i) * 6;
+                const QLineF & ln = b.lines.at(i);
+                set_gl_vertex(vertex_index, line_vertices, ln.p1(),
+                              b.min_x, b.max_x, b.min_y, b.max_y, col, row, b.num_horiz, b.num_vert);
+                set_gl_vertex(vertex_index, line_vertices, ln.p2(),
+                              b.min_x, b.max_x, b.min_y, b.max_y, col, row, b.num_horiz, b.num_vert);
             }
-            _all_grid_cells.clear();
-
-            // get pattern cells; map pattern cells to 2d pattern positions
-            QVector<Index> all_pattern_cells;
-            QVector<QMap<Index, QVector<Index> > > pattern_connections(4);
-            QVector<Index> pattern_top_incoming, pattern_top_outgoing;
-            QVector<Index> pattern_bot_incoming, pattern_bot_outgoing;
-            QMap<Index, QLineF> pattern_cells_to_lines;
-            QMap<Index, QPointF> pattern_cells_to_points;
-            bool hasTopEdge, hasBottomEdge, hasLeftEdge, hasRightEdge;
-
-            collectPatternCells(neuronet,
-                                all_pattern_cells, pattern_connections,
-                                pattern_top_incoming, pattern_top_outgoing,
-                                pattern_bot_incoming, pattern_bot_outgoing,
-                                pattern_cells_to_lines, pattern_cells_to_points,
-                                hasTopEdge, hasBottomEdge, hasLeftEdge, hasRightEdge);
-
-            //  get min and max coordinate extents
-            float min_x, max_x, min_y, max_y;
-            getMinMaxCoords(pattern_cells_to_lines, pattern_cells_to_points,
-                            min_x, max_x, min_y, max_y,
-                            hasTopEdge, hasBottomEdge, hasLeftEdge, hasRightEdge);
+            else if (b.point_slots.at(i) != -1)
+            {
+                int vertex_index = b.point_slots.at(i) * 3;
+                set_gl_vertex(vertex_index, point_vertices, b.points.at(i),
+                              b.min_x, b.max_x, b.min_y, b.max_y, col, row, b.num_horiz, b.num_vert);
+            }
+        }
+    }
 
-            // make enough copies of the pattern, and connect their internal edges
-            QVector<QMap<Index, Index> > all_copies(_num_vert * _num_horiz);
-            makeCopies(neuronet, all_pattern_cells, pattern_cells_to_lines, pattern_cells_to_points,
-                       all_copies, min_x, max_x, min_y, max_y);
+    /// \internal Copies the pattern into one tile of a grid.
+    /// Tiles are built concurrently; each one only writes to its own ranges of the build's arrays,
+    /// which are allocated beforehand.
+    static void build_tile(GridTile & tile)
+    {
+        GridBuild & b = *tile.build;
+        const int t = tile.row * b.num_horiz + tile.col;
+
+        // copy cells
+        qCopy(b.pattern_states.constBegin(), b.pattern_states.constEnd(), b.cells.data() + t * b.num_pattern_cells);
 
-            // connect outside edges
-            connectCopies(neuronet, all_copies, pattern_connections,
-                          pattern_top_incoming, pattern_top_outgoing,
-                          pattern_bot_incoming, pattern_bot_outgoing);
+        // add geometry info for the viewer
+        tile_geometry(b, tile.row, tile.col);
+    }
+
+    /// Generates the grid if the pattern has changed, resizes it if only its number of tiles has changed,
+    /// or reconnects it if its connections have changed.  A new grid is generated in the background;
+    /// it replaces the old one when it is finished (see finishGrid()).
+    void NeuroGridItem::generateGrid()
+    {
+        if (!network() || network()->loading() || !network()->neuronet() || !scene() || !treeNode() || !treeNode()->scene())
+            return;
 
-            // done
+        // the new grid will be connected when it is swapped in
+        if (_build)
+            return;
+
+        NeuroLib::NeuroNet *neuronet = network()->neuronet();
+
+        if (_pattern_changed)
+        {
+            startGrid(snapshotPattern(neuronet));
+        }
+        else if (_num_horiz != _grid_horiz || _num_vert != _grid_vert)
+        {
+            resizeGrid(snapshotPattern(neuronet));
+        }
+        else if (_connections_changed)
+        {
+            removeAllEdges();
             addAllEdges(0);
-            _pattern_changed = false;
             _connections_changed = false;
+        }
+    }
 
-            copyColors();
+    /// Waits for a grid that is being generated in the background, and swaps it into the network.
+    void NeuroGridItem::waitForGrid()
+    {
+        if (!_build)
+            return;
+
+        if (!_build_watcher.isFinished())
+        {
+            QApplication::setOverrideCursor(Qt::WaitCursor);
+            _build_watcher.waitForFinished();
             QApplication::restoreOverrideCursor();
-            MainWindow::instance()->setStatus(tr("Generated neural network grid."));
+        }
+
+        finishGrid();
+    }
+
+    /// Called when the background generation of a grid is finished.  Swaps the grid in, unless the network is stepping,
+    /// in which case it is swapped in when the step is finished.
+    void NeuroGridItem::gridBuilt()
+    {
+        if (_build && _build_watcher.isFinished() && network() && !network()->running())
+            finishGrid();
+    }
+
+    /// Takes a snapshot of the pattern, for a grid of the current size.
+    GridBuild *NeuroGridItem::snapshotPattern(NeuroLib::NeuroNet *neuronet)
+    {
+        // get pattern cells; map pattern cells to 2d pattern positions
+        QVector<Index> all_pattern_cells;
+        QVector<QMap<Index, QVector<Index> > > pattern_connections(4);
+        QVector<Index> pattern_top_incoming, pattern_top_outgoing;
+        QVector<Index> pattern_bot_incoming, pattern_bot_outgoing;
+        QMap<Index, QLineF> pattern_cells_to_lines;
+        QMap<Index, QPointF> pattern_cells_to_points;
+        bool hasTopEdge, hasBottomEdge, hasLeftEdge, hasRightEdge;
+
+        collectPatternCells(neuronet,
+                            all_pattern_cells, pattern_connections,
+                            pattern_top_incoming, pattern_top_outgoing,
+                            pattern_bot_incoming, pattern_bot_outgoing,
+                            pattern_cells_to_lines, pattern_cells_to_points,
+                            hasTopEdge, hasBottomEdge, hasLeftEdge, hasRightEdge);
 
-            emit gridChanged();
+        GridBuild *build = new GridBuild();
+        build->num_horiz = _num_horiz;
+        build->num_vert = _num_vert;
+        build->num_pattern_cells = all_pattern_cells.size();
+
+        //  get min and max coordinate extents
+        getMinMaxCoords(pattern_cells_to_lines, pattern_cells_to_points,
+                        build->min_x, build->max_x, build->min_y, build->max_y,
+                        hasTopEdge, hasBottomEdge, hasLeftEdge, hasRightEdge);
+
+        // number the pattern cells; a pattern cell that appears more than once is copied each time,
+        // but its last copy in each tile is the one that is connected
+        QHash<Index, int> pattern_offsets;
+        for (int i = 0; i < all_pattern_cells.size(); ++i)
+            pattern_offsets[all_pattern_cells[i]] = i;
+
+        // snapshot the pattern cells' states and positions
+        const NeuroLib::NeuroNet & pattern_net = *neuronet;
+
+        build->pattern_states.resize(build->num_pattern_cells);
+        build->line_slots.fill(-1, build->num_pattern_cells);
+        build->point_slots.fill(-1, build->num_pattern_cells);
+        build->lines.resize(build->num_pattern_cells);
+        build->points.resize(build->num_pattern_cells);
+        build->lines_per_tile = build->points_per_tile = 0;
+
+        for (int i = 0; i < build->num_pattern_cells; ++i)
+        {
+            const Index pat_index = all_pattern_cells[i];
+            build->pattern_states[i] = pattern_net[pat_index].current();
 
-    #ifdef DEBUG
-            // dump graph
+            if (pattern_cells_to_lines.contains(pat_index))
             {
-                QFile file("neuronet_after_gen.gv");
-                if (file.open(QIODevice::WriteOnly))
-                {
-                    QTextStream ts(&file);
-                    neuronet->dumpGraph(ts, true);
-                }
+                build->line_slots[i] = build->lines_per_tile++;
+                build->lines[i] = pattern_cells_to_lines[pat_index];
+            }
+            else if (pattern_cells_to_points.contains(pat_index))
+            {
+                build->point_slots[i] = build->points_per_tile++;
+                build->points[i] = pattern_cells_to_points[pat_index];
             }
-    #endif
         }
-        else if (_connections_changed)
+
+        // internal connections and seams, by pattern cell number; a cell's internal connections come first,
+        // then its seams, as if all the internal edges of the grid were added before all its seams
+        build->tiling = Automata::Tiling(build->num_pattern_cells, build->num_horiz, build->num_vert);
+
+        for (int i = 0; i < build->num_pattern_cells; ++i)
         {
-            removeAllEdges();
-            addAllEdges(0);
-            _connections_changed = false;
+            const int from = pattern_offsets.value(all_pattern_cells[i]);
+            foreach (const Index pat_neighbor, neuronet->neighbors(all_pattern_cells[i]))
+            {
+                if (pattern_offsets.contains(pat_neighbor))
+                    build->tiling.addLink(from, pattern_offsets.value(pat_neighbor), Automata::Tiling::SAME_TILE);
+            }
         }
+
+        add_pattern_links(build->tiling, Automata::Tiling::TILE_ABOVE, pattern_connections[TOP], pattern_offsets);
+        add_pattern_links(build->tiling, Automata::Tiling::TILE_BELOW, pattern_connections[BOTTOM], pattern_offsets);
+        add_pattern_links(build->tiling, Automata::Tiling::TILE_LEFT, pattern_connections[LEFT], pattern_offsets);
+        add_pattern_links(build->tiling, Automata::Tiling::TILE_RIGHT, pattern_connections[RIGHT], pattern_offsets);
+
+        build->top_incoming = pattern_numbers(pattern_top_incoming, pattern_offsets);
+        build->top_outgoing = pattern_numbers(pattern_top_outgoing, pattern_offsets);
+        build->bot_incoming = pattern_numbers(pattern_bot_incoming, pattern_offsets);
+        build->bot_outgoing = pattern_numbers(pattern_bot_outgoing, pattern_offsets);
+
+        // changes to the pattern from now on will need another grid
+        _pattern_changed = false;
+
+        return build;
     }
 
-    void NeuroGridItem::connectCopies(NeuroLib::NeuroNet *neuronet,
-                                      QVector<QMap<Index, Index> > & all_copies,
-                                      QVector<QMap<Index, QVector<Index> > > & pattern_connections,
-                                      QVector<Index> & pattern_top_incoming, QVector<Index> & pattern_top_outgoing,
-                                      QVector<Index> & pattern_bot_incoming, QVector<Index> & pattern_bot_outgoing)
+    /// Starts building the tiles of a grid in the background.
+    void NeuroGridItem::startGrid(GridBuild *build)
     {
-        _top_incoming.clear();
-        _top_outgoing.clear();
-        _bot_incoming.clear();
-        _bot_outgoing.clear();
+        MainWindow::instance()->setStatus(tr("Generating neural network grid..."));
+
+        // allocate each tile's ranges
+        const int num_tiles = build->num_vert * build->num_horiz;
+        QVector<GridTile> & tiles = build->tiles;
+        tiles.resize(num_tiles);
 
-        for (int row = 0; row < _num_vert; ++row)
+        for (int row = 0; row < build->num_vert; ++row)
         {
-            for (int col = 0; col < _num_horiz; ++col)
+            for (int col = 0; col < build->num_horiz; ++col)
             {
-                int left_col = (col + _num_horiz - 1) % _num_horiz;
-                int right_col = (col + 1) % _num_horiz;
-                int up_row = row - 1;
-                int down_row = row + 1;
+                const int t = row * build->num_horiz + col;
+                tiles[t].build = build;
+                tiles[t].row = row;
+                tiles[t].col = col;
+            }
+        }
 
-                const QMap<Index, Index> & pat_to_copy = get_to_copy(all_copies, row, col, _num_horiz);
+        build->cells.resize(num_tiles * build->num_pattern_cells);
+        build->line_array.resize(num_tiles * build->lines_per_tile * 6);
+        build->point_array.resize(num_tiles * build->points_per_tile * 3);
 
-                // top
-                if (row == 0)
-                {
-                    foreach (const Index index, pattern_top_incoming)
-                        _top_incoming.append(pat_to_copy[index]);
-                    foreach (const Index index, pattern_top_outgoing)
-                        _top_outgoing.append(pat_to_copy[index]);
-                }
-                else
-                {
-                    const QMap<Index, Index> & pat_to_copy_above = get_to_copy(all_copies, up_row, col, _num_horiz);
+        // build the tiles
+        _build = build;
+        _build_watcher.setFuture(QtConcurrent::map(tiles, build_tile));
+    }
 
-                    foreach (const Index pat_in, pattern_connections[TOP].keys())
-                    {
-                        const Index copy_in = pat_to_copy[pat_in];
+    /// Swaps a grid built in the background into the network, replacing the old one.
+    void NeuroGridItem::finishGrid()
+    {
+        if (!_build)
+            return;
 
-                        foreach (const Index pat_out, pattern_connections[TOP][pat_in])
-                        {
-                            const Index copy_out = pat_to_copy_above[pat_out];
-                            neuronet->addEdge(copy_in, copy_out);
-                        }
-                    }
-                }
+        GridBuild *build = _build;
+        _build = 0;
 
-                // bottom
-                if (row == _num_vert - 1)
-                {
-                    foreach (const Index index, pattern_bot_incoming)
-                        _bot_incoming.append(pat_to_copy[index]);
-                    foreach (const Index index, pattern_bot_outgoing)
-                        _bot_outgoing.append(pat_to_copy[index]);
-                }
-                else
-                {
-                    const QMap<Index, Index> & pat_to_copy_below = get_to_copy(all_copies, down_row, col, _num_horiz);
+        if (!network() || !network()->neuronet())
+        {
+            delete build;
+            return;
+        }
 
-                    foreach (const Index pat_in, pattern_connections[BOTTOM].keys())
-                    {
-                        const Index copy_in = pat_to_copy[pat_in];
+        NeuroLib::NeuroNet *neuronet = network()->neuronet();
 
-                        foreach (const Index pat_out, pattern_connections[BOTTOM][pat_in])
-                        {
-                            const Index copy_out = pat_to_copy_below[pat_out];
-                            neuronet->addEdge(copy_in, copy_out);
-                        }
-                    }
-                }
+        removeAllEdges();
 
-                // left
-                const QMap<Index, Index> & pat_to_copy_left = get_to_copy(all_copies, row, left_col, _num_horiz);
+        // remove old grid cells
+        neuronet->removeNodes(QVector<Index>::fromList(_all_grid_cells.toList()));
 
-                foreach (const Index pat_in, pattern_connections[LEFT].keys())
-                {
-                    const Index copy_in = pat_to_copy[pat_in];
+        // add new cells, all at once, sharing the pattern's edges
+        setGrid(build, addGridCells(neuronet, build));
+        delete build;
 
-                    foreach (const Index pat_out, pattern_connections[LEFT][pat_in])
-                    {
-                        const Index copy_out = pat_to_copy_left[pat_out];
-                        neuronet->addEdge(copy_in, copy_out);
-                    }
-                }
+        MainWindow::instance()->setStatus(tr("Generated neural network grid."));
+
+#ifdef DEBUG
+        // dump graph
+        {
+            QFile file("neuronet_after_gen.gv");
+            if (file.open(QIODevice::WriteOnly))
+            {
+                QTextStream ts(&file);
+                neuronet->dumpGraph(ts, true);
+            }
+        }
+#endif
+    }
 
-                // right
-                const QMap<Index, Index> & pat_to_copy_right = get_to_copy(all_copies, row, right_col, _num_horiz);
+    /// \return The cells of a grid added to the network, in tile order.
+    QVector<NeuroGridItem::Index> NeuroGridItem::addGridCells(NeuroLib::NeuroNet *neuronet, GridBuild *build)
+    {
+        const Index first = neuronet->addTiles(build->cells, build->tiling);
 
-                foreach (const Index pat_in, pattern_connections[RIGHT].keys())
-                {
-                    const Index copy_in = pat_to_copy[pat_in];
+        QVector<Index> cells(build->cells.size());
+        for (int i = 0; i < cells.size(); ++i)
+            cells[i] = first + i;
+        return cells;
+    }
 
-                    foreach (const Index pat_out, pattern_connections[RIGHT][pat_in])
-                    {
-                        const Index copy_out = pat_to_copy_right[pat_out];
-                        neuronet->addEdge(copy_in, copy_out);
-                    }
-                }
+    /// \internal Makes a grid whose edges are listed for each of its cells share its pattern's edges again
+    /// (see Automata::Graph::adoptTiles()), so that it can be resized in place.
+    /// \return False if the grid's cells or edges don't match the pattern.
+    static bool adopt_grid(NeuroLib::NeuroNet *neuronet, const GridBuild & build, const QVector<NeuroGridItem::Index> & cells,
+                           const int & num_horiz, const int & num_vert)
+    {
+        const int n = build.num_pattern_cells;
+        const int num_tiles = num_horiz * num_vert;
+
+        QVector<NeuroGridItem::Index> tile_firsts(num_tiles);
+        for (int t = 0; t < num_tiles; ++t)
+        {
+            const NeuroGridItem::Index *tile_cells = cells.constData() + t * n;
+            for (int i = 0; i < n; ++i)
+            {
+                if (tile_cells[i] != tile_cells[0] + i)
+                    return false;
             }
+            tile_firsts[t] = tile_cells[0];
         }
+
+        Automata::Tiling tiling(build.tiling);
+        tiling.resize(num_horiz, num_vert);
+        return neuronet->adoptTiles(tile_firsts, tiling);
     }
 
-    void NeuroGridItem::makeCopies(NeuroLib::NeuroNet *neuronet,
-                                   QVector<Index> & all_pattern_cells,
-                                   QMap<Index, QLineF> & pattern_cells_to_lines,
-                                   QMap<Index, QPointF> & pattern_cells_to_points,
-                                   QVector<QMap<Index, Index> > & all_copies,
-                                   float min_x, float max_x, float min_y, float max_y)
+    /// Resizes the grid in place, without generating it anew.  The cells of the tiles that are kept are left as they are,
+    /// with their indices and states; only the cells of the tiles that are dropped are removed, and only the new tiles
+    /// are added, as copies of the pattern.  The edges across the seams follow from the new size of the grid's tiling
+    /// (see Automata::Graph::resizeTiles()).
+    /// If the grid in the network doesn't match the pattern (e.g. it was loaded from an older file), generates it anew.
+    void NeuroGridItem::resizeGrid(GridBuild *build)
     {
-        _gl_line_array.resize(_num_vert * _num_horiz * pattern_cells_to_lines.size() * 6);
-        _gl_line_color_array.resize(_num_vert * _num_horiz * pattern_cells_to_lines.size() * 6);
-        _gl_point_array.resize(_num_vert * _num_horiz * pattern_cells_to_points.size() * 3);
-        _gl_point_color_array.resize(_num_vert * _num_horiz * pattern_cells_to_points.size() * 3);
+        const int n = build->num_pattern_cells;
+        const int old_horiz = _grid_horiz, old_vert = _grid_vert;
+        const int new_horiz = build->num_horiz, new_vert = build->num_vert;
 
-        int line_index = 0;
-        int point_index = 0;
+        if (n == 0 || old_horiz < 1 || old_vert < 1 || _grid_cells.size() != old_horiz * old_vert * n)
+        {
+            startGrid(build);
+            return;
+        }
 
-        // copy cells
-        for (int row = 0; row < _num_vert; ++row)
+        NeuroLib::NeuroNet *neuronet = network()->neuronet();
+
+        // only the grid's own edges are left on its cells while it is resized; a grid that was loaded has them listed
+        removeAllEdges();
+
+        if (!neuronet->isTiled(_grid_cells.first()) && !adopt_grid(neuronet, *build, _grid_cells, old_horiz, old_vert))
+        {
+            addAllEdges(0);
+            startGrid(build);
+            return;
+        }
+
+        const QVector<Index> added = neuronet->resizeTiles(_grid_cells.first(), new_horiz, new_vert, build->pattern_states);
+
+        // the cells of the new grid, tile by tile
+        const int num_tiles = new_vert * new_horiz;
+        QVector<Index> cells(num_tiles * n);
+        const Index *added_cells = added.constData();
+
+        for (int row = 0; row < new_vert; ++row)
         {
-            for (int col = 0; col < _num_horiz; ++col)
+            for (int col = 0; col < new_horiz; ++col)
             {
-                QMap<Index, Index> & pat_to_copy = get_to_copy(all_copies, row, col, _num_horiz);
+                Index *tile_cells = cells.data() + (row * new_horiz + col) * n;
 
-                // copy pattern cells
-                foreach (const Index pat_index, all_pattern_cells)
+                if (row < old_vert && col < old_horiz)
                 {
-                    Index copy_index = neuronet->addNode((*neuronet)[pat_index].current());
-                    _all_grid_cells.insert(copy_index);
-                    pat_to_copy[pat_index] = copy_index;
-
-                    // add geometry info for the viewer
-                    if (pattern_cells_to_lines.contains(pat_index))
-                    {
-                        const QLineF ln = pattern_cells_to_lines[pat_index];
-                        set_gl_vertex(line_index, _gl_line_array, _gl_line_color_array,
-                                      _gl_line_colors, copy_index, ln.p1(),
-                                      min_x, max_x, min_y, max_y, col, row, _num_horiz, _num_vert);
-                        set_gl_vertex(line_index, _gl_line_array, _gl_line_color_array,
-                                      _gl_line_colors, -1, ln.p2(),
-                                      min_x, max_x, min_y, max_y, col, row, _num_horiz, _num_vert);
-                    }
-                    else if (pattern_cells_to_points.contains(pat_index))
-                    {
-                        const QPointF pt = pattern_cells_to_points[pat_index];
-                        set_gl_vertex(point_index, _gl_point_array, _gl_point_color_array,
-                                      _gl_point_colors, copy_index, pt,
-                                      min_x, max_x, min_y, max_y, col, row, _num_horiz, _num_vert);
-                    }
+                    const Index *old_cells = _grid_cells.constData() + (row * old_horiz + col) * n;
+                    qCopy(old_cells, old_cells + n, tile_cells);
+                }
+                else
+                {
+                    qCopy(added_cells, added_cells + n, tile_cells);
+                    added_cells += n;
                 }
             }
         }
 
-        // now copy internal connections
-        for (int row = 0; row < _num_vert; ++row)
+        // the positions of all the tiles change
+        build->line_array.resize(num_tiles * build->lines_per_tile * 6);
+        build->point_array.resize(num_tiles * build->points_per_tile * 3);
+
+        for (int row = 0; row < new_vert; ++row)
+        {
+            for (int col = 0; col < new_horiz; ++col)
+                tile_geometry(*build, row, col);
+        }
+
+        setGrid(build, cells);
+        delete build;
+
+        MainWindow::instance()->setStatus(tr("Resized neural network grid."));
+    }
+
+    /// Records the cells of a grid that is now in the network, in tile order, and updates everything that refers to them.
+    void NeuroGridItem::setGrid(GridBuild *build, const QVector<Index> & cells)
+    {
+        _grid_horiz = build->num_horiz;
+        _grid_vert = build->num_vert;
+        _grid_cells = cells;
+
+        _all_grid_cells.clear();
+        foreach (const Index & index, cells)
+            _all_grid_cells.insert(index);
+
+        // cells for connecting to items outside the grid
+        const int num_pattern_cells = build->num_pattern_cells;
+        const int bot_base = (build->num_vert - 1) * build->num_horiz;
+
+        _top_incoming.clear();
+        _top_outgoing.clear();
+        _bot_incoming.clear();
+        _bot_outgoing.clear();
+
+        for (int col = 0; col < build->num_horiz; ++col)
+        {
+            foreach (const int i, build->top_incoming)
+                _top_incoming.append(cells[col * num_pattern_cells + i]);
+            foreach (const int i, build->top_outgoing)
+                _top_outgoing.append(cells[col * num_pattern_cells + i]);
+        }
+
+        for (int col = 0; col < build->num_horiz; ++col)
         {
-            for (int col = 0; col < _num_horiz; ++col)
+            foreach (const int i, build->bot_incoming)
+                _bot_incoming.append(cells[(bot_base + col) * num_pattern_cells + i]);
+            foreach (const int i, build->bot_outgoing)
+                _bot_outgoing.append(cells[(bot_base + col) * num_pattern_cells + i]);
+        }
+
+        // geometry for the viewer
+        _gl_line_array = build->line_array;
+        _gl_point_array = build->point_array;
+        _gl_line_color_array.fill(0, _gl_line_array.size());
+        _gl_point_color_array.fill(0, _gl_point_array.size());
+        _gl_line_colors.clear();
+        _gl_point_colors.clear();
+
+        const int num_tiles = build->num_horiz * build->num_vert;
+        for (int t = 0; t < num_tiles; ++t)
+        {
+            for (int i = 0; i < num_pattern_cells; ++i)
             {
-                QMap<Index, Index> & pat_to_copy = get_to_copy(all_copies, row, col, _num_horiz);
+                const Index index = cells[t * num_pattern_cells + i];
 
-                foreach (const Index pat_index, all_pattern_cells)
-                {
-                    const Index copy_index = pat_to_copy[pat_index];
-                    foreach (const Index pat_neighbor, neuronet->neighbors(pat_index))
-                    {
-                        const Index copy_neighbor = pat_to_copy[pat_neighbor];
-                        neuronet->addEdge(copy_index, copy_neighbor);
-                    }
-                }
+                if (build->line_slots[i] != -1)
+                    _gl_line_colors[index] = (t * build->lines_per_tile + build->line_slots[i]) * 6;
+                else if (build->point_slots[i] != -1)
+                    _gl_point_colors[index] = (t * build->points_per_tile + build->point_slots[i]) * 3;
             }
         }
+
+        // done
+        addAllEdges(0);
+        _connections_changed = false;
+
+        copyColors();
+        emit gridChanged();
     }
 
     void NeuroGridItem::getMinMaxCoords(QMap<Index, QLineF> & pattern_cells_to_lines,
@@ -1154,6 +1391,7 @@ namespace GridItems
     void NeuroGridItem::writeBinary(QDataStream &ds, const NeuroLabFileVersion &file_version) const
     {
         const_cast<NeuroGridItem *>(this)->generateGrid();
+        const_cast<NeuroGridItem *>(this)->waitForGrid();
 
         SubNetworkItem::writeBinary(ds, file_version);
 
@@ -1205,6 +1443,10 @@ namespace GridItems
             ds << static_cast<quint32>(index);
             ds << static_cast<quint32>(_gl_point_colors[index]);
         }
+
+        ds << static_cast<quint32>(_grid_horiz);
+        ds << static_cast<quint32>(_grid_vert);
+        write_collection<QVector<Index>, Index, quint32>(ds, _grid_cells);
     }
 
     template <typename TCollection, typename TData, typename TRead>
@@ -1302,6 +1544,18 @@ namespace GridItems
                     _gl_point_colors[static_cast<Index>(index)] = static_cast<int>(val);
                 }
             }
+
+            // cells in tile order; without them, the grid is generated anew when it is resized
+            _grid_horiz = _num_horiz;
+            _grid_vert = _num_vert;
+            _grid_cells.clear();
+
+            if (file_version.neurolab_version >= NeuroGui::NEUROLAB_FILE_VERSION_14)
+            {
+                ds >> num; _grid_horiz = num;
+                ds >> num; _grid_vert = num;
+                read_collection<QVector<Index>, Index, quint32>(ds, _grid_cells);
+            }
         }
     }
 
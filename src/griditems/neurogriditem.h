@@ -41,11 +41,14 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "../neurogui/subnetwork/subnetworkitem.h"
 
 #include <QVector>
+#include <QHash>
+#include <QFutureWatcher>
 
 namespace GridItems
 {
 
     class MultiGridIOItem;
+    struct GridBuild;
 
     class GRIDITEMSSHARED_EXPORT NeuroGridItem
         : public NeuroGui::SubNetworkItem
@@ -64,6 +67,8 @@ namespace GridItems
         QSet<NeuroNetworkItem *> _top_connections, _bottom_connections;
 
         QSet<Index> _all_grid_cells; // all automaton cells used by the grid
+        QVector<Index> _grid_cells; // the same cells, tile by tile, each tile in pattern order
+        qint32 _grid_horiz, _grid_vert; // the size of the grid that is in the automaton
         QList<Index> _top_incoming, _top_outgoing; // cells to use for getIncomingCellsFor etc.
         QList<Index> _bot_incoming, _bot_outgoing;
 
@@ -78,6 +83,9 @@ namespace GridItems
         QVector<float> _gl_line_color_array;
         QVector<float> _gl_point_color_array;
 
+        GridBuild *_build; // grid being generated in the background, if any
+        QFutureWatcher<void> _build_watcher;
+
     public:
         NeuroGridItem(NeuroGui::LabNetwork *network, const QPointF & scenePos, const CreateContext & context);
         virtual ~NeuroGridItem();
@@ -106,12 +114,11 @@ namespace GridItems
 
     public slots:
         void itemChanged(NeuroItem *item);
-        void propertyChanged();
         void networkStepClicked();
-        void networkPostStep();
         void networkStepFinished();
 
         void generateGrid();
+        void waitForGrid();
 
         void resizeScene();
         void copyColors();
@@ -133,17 +140,12 @@ namespace GridItems
                              QMap<Index, QPointF> & pattern_cells_to_points,
                              float & min_x, float & max_x, float & min_y, float & max_y,
                              bool &hasTopEdge, bool &hasBottomEdge, bool &hasLeftEdge, bool &hasRightEdge);
-        void makeCopies(NeuroLib::NeuroNet *neuronet,
-                        QVector<Index> & all_pattern_cells,
-                        QMap<Index, QLineF> & pattern_cells_to_lines,
-                        QMap<Index, QPointF> & pattern_cells_to_points,
-                        QVector<QMap<Index, Index> > & all_copies,
-                        float min_x, float max_x, float min_y, float max_y);
-        void connectCopies(NeuroLib::NeuroNet *neuronet,
-                           QVector<QMap<Index, Index> > & all_copies,
-                           QVector<QMap<Index, QVector<Index> > > & pattern_connections,
-                           QVector<Index> & pattern_top_incoming, QVector<Index> & pattern_top_outgoing,
-                           QVector<Index> & pattern_bot_incoming, QVector<Index> & pattern_bot_outgoing);
+        GridBuild *snapshotPattern(NeuroLib::NeuroNet *neuronet);
+        void startGrid(GridBuild *build);
+        void finishGrid();
+        void resizeGrid(GridBuild *build);
+        QVector<Index> addGridCells(NeuroLib::NeuroNet *neuronet, GridBuild *build);
+        void setGrid(GridBuild *build, const QVector<Index> & cells);
 
         virtual void onEnterView();
         virtual void onLeaveView();
@@ -170,6 +172,9 @@ namespace GridItems
 
         virtual void postLoad();
 
+    private slots:
+        void gridBuilt();
+
     private:
         void adjustIOItem(MultiGridIOItem *gi, bool top);
 
@@ -234,6 +234,8 @@ namespace GridItems
 
     void TextGridIOItem::networkPreStep()
     {
+        LabNetwork::HandlerTimer timer(network(), "TextGridIOItem::networkPreStep");
+
         // calculate new value
         qreal new_val = 0;
         if ((_cur_step % (_input_spike + _input_gap)) < _input_spike)
@@ -271,6 +273,8 @@ namespace GridItems
 
     void TextGridIOItem::networkPostStep()
     {
+        LabNetwork::HandlerTimer timer(network(), "TextGridIOItem::networkPostStep");
+
         _step_output_text.clear();
 
         // calculate average
@@ -120,6 +120,7 @@ namespace GridItems
         void setInputText(const QString & s) { _input_text = s;  }
 
         virtual QString dataValue() const;
+        virtual bool dataSample(float &) const { return false; }
 
         virtual void addToShape(QPainterPath &drawPath, QList<TextPathRec> &texts) const;
 
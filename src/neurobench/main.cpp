@@ -0,0 +1,984 @@
+/*
+Neurocognitive Linguistics Lab
+Copyright (c) 2010,2011 Gordon Tisher
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+ - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+ - Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in
+   the documentation and/or other materials provided with the
+   distribution.
+
+ - Neither the name of the Neurocognitive Linguistics Lab nor the
+   names of its contributors may be used to endorse or promote
+   products derived from this software without specific prior
+   written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "../common/exception.h"
+#include "../automata/steppool.h"
+#include "../neurolib/neuronet.h"
+#include "../asyncLife/lifeboard.h"
+
+#include <QCoreApplication>
+#include <QStringList>
+#include <QFile>
+#include <QBuffer>
+#include <QDataStream>
+#include <QTextStream>
+#include <QTime>
+#include <QThread>
+
+#include <cstdio>
+#include <cmath>
+
+using namespace NeuroLib;
+
+static const char *USAGE =
+    "Usage: neurolab-bench [options]\n"
+    "Builds synthetic networks, steps them on different numbers of threads,\n"
+    "and reports the stepping throughput and memory used.\n"
+    "\n"
+    "  -w, --workload LIST   Workloads to run: life, random, grid, or all (default).\n"
+    "  -s, --size N          Approximate number of cells in each network (default 100000).\n"
+    "  -n, --steps N         Number of timesteps to time in each run (default 100).\n"
+    "      --warmup N        Number of untimed timesteps before each run (default 10).\n"
+    "  -t, --threads LIST    Numbers of threads to run with, e.g. 1,2,4 (default: powers\n"
+    "                        of two up to the number of cores, and the number of cores).\n"
+    "      --fan-in N        Number of inputs of each cell in the random network (default 4).\n"
+    "      --kinds N:E:I:O   Relative numbers of nodes, excitatory links, inhibitory links\n"
+    "                        and oscillators in the random network (default 3:5:1:1).\n"
+    "      --seed N          Seed for the random network and the Life board (default 1).\n"
+    "      --sync            Use the synchronous step mode.\n"
+    "      --vector          Use the vectorised kernels (with --sync).\n"
+    "      --active-set      Only update the cells whose state or inputs changed (with --sync).\n"
+    "      --cell-storage    Step the cells directly rather than in arrays.\n"
+    "      --check-vector    Rather than timing, step each network with the vectorised and\n"
+    "                        the scalar kernels from the same state, and fail if they differ\n"
+    "                        by more than the bound the vectorised kernels promise.\n"
+    "      --check-resize    Rather than timing, resize a grid part-way through a timestep,\n"
+    "                        and fail if the cells that are kept change, or if it steps\n"
+    "                        differently from a grid built at the new size in the same state.\n"
+    "      --format FORMAT   Write the results as csv (default) or json.\n"
+    "  -o, --output FILE     Write the results to FILE rather than to the standard output.\n"
+    "  -h, --help            Show this message.\n";
+
+/// The options given on the command line.
+struct BenchOptions
+{
+    QStringList workloads;
+    QList<int> threads;
+    QString output_fname;
+    QString format;
+    int size;
+    int steps;
+    int warmup;
+    int fan_in;
+    int kinds[4];
+    quint32 seed;
+    bool sync;
+    bool vector;
+    bool active_set;
+    bool cell_storage;
+    bool check_vector;
+    bool check_resize;
+
+    BenchOptions()
+        : format("csv"), size(100000), steps(100), warmup(10), fan_in(4), seed(1), sync(false), vector(false), active_set(false), cell_storage(false), check_vector(false), check_resize(false)
+    {
+        kinds[0] = 3;
+        kinds[1] = 5;
+        kinds[2] = 1;
+        kinds[3] = 1;
+    }
+};
+
+/// The measurements of one run.
+struct BenchResult
+{
+    QString workload;
+    QString mode;
+    int cells;
+    int edges;
+    int threads;
+    int steps;
+    double secs;
+    qint64 memory;   ///< Bytes taken by the network's cells, edges and arrays.
+};
+
+/// A small random number generator whose sequence doesn't depend on the platform's \c rand().
+class BenchRandom
+{
+    quint32 _state;
+
+public:
+    explicit BenchRandom(const quint32 & seed) : _state(seed ? seed : 1) {}
+
+    /// \return A number in <tt>[0, n)</tt>.
+    int next(const int & n)
+    {
+        // xorshift32
+        _state ^= _state << 13;
+        _state ^= _state >> 17;
+        _state ^= _state << 5;
+        return static_cast<int>(_state % static_cast<quint32>(n));
+    }
+};
+
+static int toInt(const QString & arg, const QString & value)
+{
+    bool ok;
+    int result = value.toInt(&ok);
+    if (!ok || result < 0)
+        throw Common::Exception(QObject::tr("Invalid value for %1: %2").arg(arg).arg(value));
+    return result;
+}
+
+/// Parses the command line.
+/// \return False if the usage should be shown.
+static bool parseArguments(const QStringList & args, BenchOptions & options)
+{
+    for (int i = 1; i < args.size(); ++i)
+    {
+        const QString & arg = args[i];
+
+        if (arg == "-h" || arg == "--help")
+            return false;
+        else if (arg == "--sync")
+            options.sync = true;
+        else if (arg == "--vector")
+            options.vector = true;
+        else if (arg == "--active-set")
+            options.active_set = true;
+        else if (arg == "--cell-storage")
+            options.cell_storage = true;
+        else if (arg == "--check-vector")
+            options.check_vector = true;
+        else if (arg == "--check-resize")
+            options.check_resize = true;
+        else if (arg.startsWith("-"))
+        {
+            if (i + 1 >= args.size())
+                throw Common::Exception(QObject::tr("Missing value for %1").arg(arg));
+
+            const QString & value = args[++i];
+
+            if (arg == "-w" || arg == "--workload")
+                options.workloads = value.split(",");
+            else if (arg == "-s" || arg == "--size")
+                options.size = qMax(toInt(arg, value), 1);
+            else if (arg == "-n" || arg == "--steps")
+                options.steps = qMax(toInt(arg, value), 1);
+            else if (arg == "--warmup")
+                options.warmup = toInt(arg, value);
+            else if (arg == "-t" || arg == "--threads")
+            {
+                options.threads.clear();
+                foreach (const QString & t, value.split(","))
+                    options.threads.append(qMax(toInt(arg, t), 1));
+            }
+            else if (arg == "--fan-in")
+                options.fan_in = toInt(arg, value);
+            else if (arg == "--kinds")
+            {
+                const QStringList kinds = value.split(":");
+                if (kinds.size() != 4)
+                    throw Common::Exception(QObject::tr("Invalid value for %1: %2").arg(arg).arg(value));
+
+                int total = 0;
+                for (int k = 0; k < 4; ++k)
+                    total += options.kinds[k] = toInt(arg, kinds[k]);
+                if (total == 0)
+                    throw Common::Exception(QObject::tr("Invalid value for %1: %2").arg(arg).arg(value));
+            }
+            else if (arg == "--seed")
+                options.seed = static_cast<quint32>(toInt(arg, value));
+            else if (arg == "--format")
+            {
+                if (value != "csv" && value != "json")
+                    throw Common::Exception(QObject::tr("Unknown format: %1").arg(value));
+                options.format = value;
+            }
+            else if (arg == "-o" || arg == "--output")
+                options.output_fname = value;
+            else
+                throw Common::Exception(QObject::tr("Unknown option: %1").arg(arg));
+        }
+        else
+        {
+            throw Common::Exception(QObject::tr("Unexpected argument: %1").arg(arg));
+        }
+    }
+
+    if (options.workloads.isEmpty() || options.workloads.contains("all"))
+        options.workloads = QString("life,random,grid").split(",");
+
+    foreach (const QString & workload, options.workloads)
+    {
+        if (workload != "life" && workload != "random" && workload != "grid")
+            throw Common::Exception(QObject::tr("Unknown workload: %1").arg(workload));
+    }
+
+    if (options.threads.isEmpty())
+    {
+        const int cores = qMax(QThread::idealThreadCount(), 1);
+        for (int t = 1; t < cores; t *= 2)
+            options.threads.append(t);
+        options.threads.append(cores);
+    }
+
+    return true;
+}
+
+/// Builds a network of cells of random kinds, each with BenchOptions::fan_in inputs chosen at random.
+/// \return The number of edges.
+static int buildRandom(NeuroNet & network, const BenchOptions & options)
+{
+    static const NeuroCell::KindOfCell KINDS[4] =
+        { NeuroCell::NODE, NeuroCell::EXCITORY_LINK, NeuroCell::INHIBITORY_LINK, NeuroCell::OSCILLATOR };
+
+    BenchRandom random(options.seed);
+    const int total = options.kinds[0] + options.kinds[1] + options.kinds[2] + options.kinds[3];
+
+    for (int i = 0; i < options.size; ++i)
+    {
+        int k = random.next(total);
+        int kind = 0;
+        while (k >= options.kinds[kind])
+            k -= options.kinds[kind++];
+
+        NeuroCell cell(KINDS[kind], KINDS[kind] == NeuroCell::INHIBITORY_LINK ? -1.0f : 1.0f, 0.1f,
+                       random.next(4) == 0 ? 1.0f : 0.0f);
+
+        if (KINDS[kind] == NeuroCell::OSCILLATOR)
+        {
+            cell.setGap(3);
+            cell.setPeak(2);
+            cell.setPhase(random.next(5));
+        }
+
+        network.addNode(cell);
+    }
+
+    for (int i = 0; i < options.size; ++i)
+    {
+        for (int j = 0; j < options.fan_in; ++j)
+            network.addEdge(i, random.next(options.size));
+    }
+
+    return options.size * options.fan_in;
+}
+
+/// Builds a square grid of copies of a small pattern, connected to their neighbours the way
+/// a NeuroGridItem connects the copies of its pattern: each copy has a node, excitatory links
+/// that feed the nodes of the copies to its right and below, and an inhibitory link that inhibits
+/// the link coming in from the left.  The grid wraps around horizontally; copies in the first column
+/// are driven by an oscillator.
+/// \return The number of edges.
+static int buildGrid(NeuroNet & network, const BenchOptions & options)
+{
+    enum { NODE = 0, RIGHT, DOWN, INHIBIT, PATTERN_SIZE };
+
+    const int side = qMax(static_cast<int>(::sqrt(static_cast<double>(options.size) / PATTERN_SIZE)), 2);
+    BenchRandom random(options.seed);
+
+    QVector<NeuroCell::Index> nodes(side * side), rights(side * side), downs(side * side), inhibits(side * side);
+    int edges = 0;
+
+    for (int tile = 0; tile < side * side; ++tile)
+    {
+        nodes[tile] = network.addNode(NeuroCell(NeuroCell::NODE, 1.0f, 0.1f, random.next(10) == 0 ? 1.0f : 0.0f));
+        rights[tile] = network.addNode(NeuroCell(NeuroCell::EXCITORY_LINK, 0.6f));
+        downs[tile] = network.addNode(NeuroCell(NeuroCell::EXCITORY_LINK, 0.6f));
+        inhibits[tile] = network.addNode(NeuroCell(NeuroCell::INHIBITORY_LINK, -0.5f));
+
+        network.addEdge(rights[tile], nodes[tile]);
+        network.addEdge(downs[tile], nodes[tile]);
+        network.addEdge(inhibits[tile], nodes[tile]);
+        edges += 3;
+
+        if (tile % side == 0)
+        {
+            NeuroCell oscillator(NeuroCell::OSCILLATOR);
+            oscillator.setGap(3);
+            oscillator.setPeak(2);
+
+            network.addEdge(nodes[tile], network.addNode(oscillator));
+            ++edges;
+        }
+    }
+
+    for (int row = 0; row < side; ++row)
+    {
+        for (int col = 0; col < side; ++col)
+        {
+            const int tile = row * side + col;
+            const int left = row * side + (col + side - 1) % side;
+            const int right = row * side + (col + 1) % side;
+
+            network.addEdge(nodes[right], rights[tile]);
+            network.addEdge(rights[left], inhibits[tile]);
+            edges += 2;
+
+            if (row + 1 < side)
+            {
+                network.addEdge(nodes[tile + side], downs[tile]);
+                ++edges;
+            }
+        }
+    }
+
+    return edges;
+}
+
+static void stepNetwork(NeuroNet & network, const int & num_steps)
+{
+    const int passes = network.passesPerStep();
+
+    for (int s = 0; s < num_steps; ++s)
+    {
+        for (int p = 0; p < passes; ++p)
+        {
+            network.preUpdate();
+            network.step();
+            network.postUpdate();
+        }
+    }
+}
+
+static void stepBoard(LifeBoard & board, const int & num_steps)
+{
+    for (int s = 0; s < num_steps * 3; ++s)
+        board.step();
+}
+
+/// Sets a network's storage and step modes from the options.
+static void setModes(NeuroNet & network, const BenchOptions & options)
+{
+    network.setStorageMode(options.cell_storage ? NeuroNet::CELL_STORAGE : NeuroNet::ARRAY_STORAGE);
+    network.setStepMode(options.sync ? NeuroNet::SYNCHRONOUS_STEP : NeuroNet::ASYNCHRONOUS_STEP);
+    network.setVectorKernels(options.vector);
+    network.setActiveSet(options.active_set);
+}
+
+/// Times the network on each number of threads.
+static void runNetwork(const QString & workload, NeuroNet & network, const int & edges,
+                       const BenchOptions & options, QList<BenchResult> & results)
+{
+    setModes(network, options);
+
+    // the first step allocates the frozen edges and the arrays
+    stepNetwork(network, 1);
+    const qint64 memory = network.memoryUsed();
+
+    foreach (const int & num_threads, options.threads)
+    {
+        Automata::StepPool pool(num_threads);
+        network.setStepPool(&pool);
+
+        stepNetwork(network, options.warmup);
+
+        QTime timer;
+        timer.start();
+        stepNetwork(network, options.steps);
+
+        BenchResult result;
+        result.workload = workload;
+        result.mode = options.sync ? (options.vector ? "sync-vector" : "sync") : (options.cell_storage ? "cells" : "async");
+        if (options.sync && options.active_set)
+            result.mode += "-active";
+        result.cells = network.size();
+        result.edges = edges;
+        result.threads = pool.numThreads();
+        result.steps = options.steps;
+        result.secs = timer.elapsed() / 1000.0;
+        result.memory = memory;
+        results.append(result);
+
+        network.setStepPool(0);
+    }
+}
+
+/// Times the Life board on each number of threads.
+static void runBoard(LifeBoard & board, const BenchOptions & options, QList<BenchResult> & results)
+{
+    stepBoard(board, 1);
+    const qint64 memory = board.memoryUsed();
+
+    foreach (const int & num_threads, options.threads)
+    {
+        Automata::StepPool pool(num_threads);
+        board.setStepPool(&pool);
+
+        stepBoard(board, options.warmup);
+
+        QTime timer;
+        timer.start();
+        stepBoard(board, options.steps);
+
+        BenchResult result;
+        result.workload = "life";
+        result.mode = "async";
+        result.cells = board.size();
+        result.edges = board.size() * 8;
+        result.threads = pool.numThreads();
+        result.steps = options.steps;
+        result.secs = timer.elapsed() / 1000.0;
+        result.memory = memory;
+        results.append(result);
+
+        board.setStepPool(0);
+    }
+}
+
+/// How far the vectorised kernels may take a cell's output, running average or weight from the scalar kernels' in one step;
+/// see NeuroArrays::updateBatch().
+static const double VECTOR_TOLERANCE = 2e-6;
+
+/// The largest differences between the vectorised and the scalar kernels over a run.
+struct CheckResult
+{
+    QString workload;
+    int cells;
+    int steps;
+    double output, average, weight;
+    int violations;  ///< The number of values that differed by more than VECTOR_TOLERANCE.
+};
+
+/// Notes the difference between two values.
+static void compareValues(const NeuroCell::Value & a, const NeuroCell::Value & b, double & max_diff, int & violations)
+{
+    const double diff = ::fabs(static_cast<double>(a) - static_cast<double>(b));
+    if (diff > max_diff)
+        max_diff = diff;
+    if (!(diff <= VECTOR_TOLERANCE))
+        ++violations;
+}
+
+/// Steps copies of a network with the vectorised and the scalar kernels, a timestep at a time, and compares them.
+/// Before each step the vectorised copy is given the scalar copy's state, so the bound is checked for one step at a time
+/// rather than for differences that have built up over many steps.
+static CheckResult checkVector(const QString & workload, NeuroNet & scalar, NeuroNet & vector, const BenchOptions & options)
+{
+    NeuroNet *networks[2] = { &scalar, &vector };
+    for (int i = 0; i < 2; ++i)
+    {
+        networks[i]->setStorageMode(NeuroNet::ARRAY_STORAGE);
+        networks[i]->setStepMode(NeuroNet::SYNCHRONOUS_STEP);
+        networks[i]->setVectorKernels(i == 1);
+        networks[i]->setActiveSet(options.active_set);
+    }
+
+    CheckResult result;
+    result.workload = workload;
+    result.cells = scalar.size();
+    result.steps = options.steps;
+    result.output = result.average = result.weight = 0;
+    result.violations = 0;
+
+    const int num = scalar.size();
+    QVector<uchar> records(num * NeuroNet::CELL_RECORD_SIZE);
+
+    for (int s = 0; s < options.steps; ++s)
+    {
+        scalar.writeCellRecords(records.data(), 0, num);
+        vector.readCellRecords(records.constData(), 0, num);
+
+        stepNetwork(scalar, 1);
+        stepNetwork(vector, 1);
+
+        const NeuroNet & a = scalar;
+        const NeuroNet & b = vector;
+
+        for (NeuroCell::Index i = 0; i < num; ++i)
+        {
+            const NeuroCell ca = a[i].current();
+            const NeuroCell cb = b[i].current();
+
+            compareValues(ca.outputValue(), cb.outputValue(), result.output, result.violations);
+
+            // an oscillator keeps its gap and peak in its weight
+            if (ca.kind() != NeuroCell::OSCILLATOR)
+            {
+                compareValues(ca.runningAverage(), cb.runningAverage(), result.average, result.violations);
+                compareValues(ca.weight(), cb.weight(), result.weight, result.violations);
+            }
+        }
+    }
+
+    return result;
+}
+
+static void writeCheckResults(const QList<CheckResult> & results, const QString & format, QTextStream & ts)
+{
+    if (format == "json")
+        ts << "[\n";
+    else
+        ts << "workload,cells,steps,tolerance,max_output_diff,max_average_diff,max_weight_diff,violations\n";
+
+    for (int i = 0; i < results.size(); ++i)
+    {
+        const CheckResult & r = results[i];
+
+        if (format == "json")
+        {
+            ts << "  { \"workload\": \"" << r.workload << "\""
+               << ", \"cells\": " << r.cells << ", \"steps\": " << r.steps << ", \"tolerance\": " << VECTOR_TOLERANCE
+               << ", \"max_output_diff\": " << r.output << ", \"max_average_diff\": " << r.average
+               << ", \"max_weight_diff\": " << r.weight << ", \"violations\": " << r.violations
+               << " }" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        else
+        {
+            ts << r.workload << "," << r.cells << "," << r.steps << "," << VECTOR_TOLERANCE << ","
+               << r.output << "," << r.average << "," << r.weight << "," << r.violations << "\n";
+        }
+    }
+
+    if (format == "json")
+        ts << "]\n";
+}
+
+/// The outcome of resizing a grid in place.
+struct ResizeResult
+{
+    QString resize;
+    bool reloaded;
+    int cells;
+    int steps;
+    int kept_changed;     ///< The number of cells that are kept whose state changed when the grid was resized.
+    int step_mismatches;  ///< The number of cells whose state differed from the freshly built grid's after a step.
+};
+
+/// The cells of each copy of the pattern in a tiled grid.
+enum { TILE_NODE = 0, TILE_RIGHT, TILE_DOWN, TILE_INHIBIT, TILE_SIZE };
+
+/// \return The edges of the pattern of buildGrid(), as a tiling of the given size.
+static Automata::Tiling gridTiling(const int & num_cols, const int & num_rows)
+{
+    Automata::Tiling tiling(TILE_SIZE, num_cols, num_rows);
+    tiling.addLink(TILE_RIGHT, TILE_NODE, Automata::Tiling::SAME_TILE);
+    tiling.addLink(TILE_DOWN, TILE_NODE, Automata::Tiling::SAME_TILE);
+    tiling.addLink(TILE_INHIBIT, TILE_NODE, Automata::Tiling::SAME_TILE);
+    tiling.addLink(TILE_NODE, TILE_DOWN, Automata::Tiling::TILE_ABOVE);
+    tiling.addLink(TILE_NODE, TILE_RIGHT, Automata::Tiling::TILE_LEFT);
+    tiling.addLink(TILE_RIGHT, TILE_INHIBIT, Automata::Tiling::TILE_RIGHT);
+    return tiling;
+}
+
+/// Builds a grid of copies of the same pattern as buildGrid(), sharing the pattern's edges (see NeuroNet::addTiles()).
+/// The copies in the first column of the first few rows are driven by oscillators.
+/// \param oscillators Receives the oscillators, by row.
+/// \return The index of the first cell of each tile, in row order.
+static QVector<NeuroCell::Index> buildTiles(NeuroNet & network, const int & num_cols, const int & num_rows, const int & oscillator_rows,
+                                            const BenchOptions & options, QVector<NeuroCell::Index> & oscillators)
+{
+    BenchRandom random(options.seed);
+    const int num_tiles = num_cols * num_rows;
+
+    QVector<NeuroCell> cells;
+    cells.reserve(num_tiles * TILE_SIZE);
+    for (int tile = 0; tile < num_tiles; ++tile)
+    {
+        cells.append(NeuroCell(NeuroCell::NODE, 1.0f, 0.1f, random.next(10) == 0 ? 1.0f : 0.0f));
+        cells.append(NeuroCell(NeuroCell::EXCITORY_LINK, 0.6f));
+        cells.append(NeuroCell(NeuroCell::EXCITORY_LINK, 0.6f));
+        cells.append(NeuroCell(NeuroCell::INHIBITORY_LINK, -0.5f));
+    }
+
+    const NeuroCell::Index first = network.addTiles(cells, gridTiling(num_cols, num_rows));
+
+    QVector<NeuroCell::Index> tile_firsts(num_tiles);
+    for (int tile = 0; tile < num_tiles; ++tile)
+        tile_firsts[tile] = first + tile * TILE_SIZE;
+
+    oscillators.clear();
+    for (int row = 0; row < oscillator_rows; ++row)
+    {
+        NeuroCell oscillator(NeuroCell::OSCILLATOR);
+        oscillator.setGap(3);
+        oscillator.setPeak(2);
+
+        const NeuroCell::Index index = network.addNode(oscillator);
+        network.addEdge(tile_firsts[row * num_cols] + TILE_NODE, index);
+        oscillators.append(index);
+    }
+
+    return tile_firsts;
+}
+
+/// Steps a network through the first pass of a timestep, if a timestep has more than one.
+static void stepPass(NeuroNet & network)
+{
+    if (network.passesPerStep() > 1)
+    {
+        network.preUpdate();
+        network.step();
+        network.postUpdate();
+    }
+}
+
+/// \return The cell records of a whole network; see NeuroNet::writeCellRecords().
+static QVector<uchar> cellRecords(const NeuroNet & network)
+{
+    QVector<uchar> records(network.size() * NeuroNet::CELL_RECORD_SIZE);
+    network.writeCellRecords(records.data(), 0, network.size());
+    return records;
+}
+
+/// \return Whether a cell has the same record in two sets of records.
+static bool sameRecord(const QVector<uchar> & a, const NeuroCell::Index & index_a, const QVector<uchar> & b, const NeuroCell::Index & index_b)
+{
+    return ::memcmp(a.constData() + index_a * NeuroNet::CELL_RECORD_SIZE, b.constData() + index_b * NeuroNet::CELL_RECORD_SIZE,
+                    NeuroNet::CELL_RECORD_SIZE) == 0;
+}
+
+/// Resizes a grid part-way through a timestep, and checks that the cells of the tiles that are kept, and the oscillators,
+/// are left as they were.  Then builds a grid of the new size, gives it the resized grid's state, and checks that the two step alike.
+/// \param reloaded Whether to save and load the network before resizing it, so that its edges are listed for each cell.
+static ResizeResult checkResize(const QString & resize, const int & old_cols, const int & old_rows,
+                                const int & new_cols, const int & new_rows, const bool & reloaded, const BenchOptions & options)
+{
+    const int oscillator_rows = qMin(old_rows, new_rows);
+
+    NeuroNet network;
+    QVector<NeuroCell::Index> oscillators;
+    const QVector<NeuroCell::Index> old_firsts = buildTiles(network, old_cols, old_rows, oscillator_rows, options, oscillators);
+
+    setModes(network, options);
+    stepNetwork(network, options.warmup);
+
+    if (reloaded)
+    {
+        QBuffer buffer;
+        buffer.open(QIODevice::ReadWrite);
+        QDataStream ds(&buffer);
+        Automata::AutomataFileVersion file_version;
+
+        network.writeBinary(ds, file_version);
+        buffer.seek(0);
+        network.readBinary(ds, file_version);
+        setModes(network, options);
+    }
+
+    stepPass(network);
+    const QVector<uchar> before = cellRecords(network);
+
+    // the pattern for the new tiles
+    NeuroNet pattern_net;
+    QVector<NeuroCell::Index> pattern_oscillators;
+    buildTiles(pattern_net, 1, 1, 0, options, pattern_oscillators);
+
+    QVector<NeuroCell> pattern;
+    for (NeuroCell::Index i = 0; i < TILE_SIZE; ++i)
+        pattern.append(pattern_net[i].current());
+
+    // tilings are not saved, so a reloaded grid has its edges listed for each cell
+    if (reloaded)
+    {
+        if (network.isTiled(old_firsts.first()) || !network.adoptTiles(old_firsts, gridTiling(old_cols, old_rows)))
+            throw Common::Exception(QObject::tr("The reloaded grid could not be tiled again."));
+    }
+
+    const QVector<NeuroCell::Index> added = network.resizeTiles(old_firsts.first(), new_cols, new_rows, pattern);
+
+    ResizeResult result;
+    result.resize = resize;
+    result.reloaded = reloaded;
+    result.cells = network.size();
+    result.steps = options.steps;
+    result.kept_changed = 0;
+    result.step_mismatches = 0;
+
+    // the cells of each tile of the resized grid
+    QVector<NeuroCell::Index> new_firsts(new_cols * new_rows);
+    int next_added = 0;
+    for (int row = 0; row < new_rows; ++row)
+    {
+        for (int col = 0; col < new_cols; ++col)
+        {
+            if (row < old_rows && col < old_cols)
+            {
+                new_firsts[row * new_cols + col] = old_firsts[row * old_cols + col];
+            }
+            else
+            {
+                new_firsts[row * new_cols + col] = added[next_added];
+                next_added += TILE_SIZE;
+            }
+        }
+    }
+
+    const QVector<uchar> after = cellRecords(network);
+    for (int row = 0; row < qMin(old_rows, new_rows); ++row)
+    {
+        for (int col = 0; col < qMin(old_cols, new_cols); ++col)
+        {
+            const NeuroCell::Index first = old_firsts[row * old_cols + col];
+            for (int i = 0; i < TILE_SIZE; ++i)
+            {
+                if (!sameRecord(before, first + i, after, first + i))
+                    ++result.kept_changed;
+            }
+        }
+    }
+    foreach (const NeuroCell::Index & index, oscillators)
+    {
+        if (!sameRecord(before, index, after, index))
+            ++result.kept_changed;
+    }
+
+    // a grid built at the new size, in the same state
+    NeuroNet fresh;
+    QVector<NeuroCell::Index> fresh_oscillators;
+    const QVector<NeuroCell::Index> fresh_firsts = buildTiles(fresh, new_cols, new_rows, oscillator_rows, options, fresh_oscillators);
+
+    QVector<NeuroCell::Index> from, to;
+    for (int tile = 0; tile < new_firsts.size(); ++tile)
+    {
+        for (int i = 0; i < TILE_SIZE; ++i)
+        {
+            from.append(new_firsts[tile] + i);
+            to.append(fresh_firsts[tile] + i);
+        }
+    }
+    from += oscillators;
+    to += fresh_oscillators;
+
+    setModes(fresh, options);
+    stepPass(fresh);
+
+    QVector<uchar> seeded = cellRecords(fresh);
+    for (int i = 0; i < from.size(); ++i)
+        ::memcpy(seeded.data() + to[i] * NeuroNet::CELL_RECORD_SIZE, after.constData() + from[i] * NeuroNet::CELL_RECORD_SIZE, NeuroNet::CELL_RECORD_SIZE);
+    fresh.readCellRecords(seeded.constData(), 0, fresh.size());
+
+    for (int s = 0; s < options.steps; ++s)
+    {
+        stepNetwork(network, 1);
+        stepNetwork(fresh, 1);
+
+        const QVector<uchar> a = cellRecords(network);
+        const QVector<uchar> b = cellRecords(fresh);
+        for (int i = 0; i < from.size(); ++i)
+        {
+            if (!sameRecord(a, from[i], b, to[i]))
+                ++result.step_mismatches;
+        }
+    }
+
+    return result;
+}
+
+static void writeResizeResults(const QList<ResizeResult> & results, const QString & format, QTextStream & ts)
+{
+    if (format == "json")
+        ts << "[\n";
+    else
+        ts << "resize,reloaded,cells,steps,kept_changed,step_mismatches\n";
+
+    for (int i = 0; i < results.size(); ++i)
+    {
+        const ResizeResult & r = results[i];
+
+        if (format == "json")
+        {
+            ts << "  { \"resize\": \"" << r.resize << "\", \"reloaded\": " << (r.reloaded ? "true" : "false")
+               << ", \"cells\": " << r.cells << ", \"steps\": " << r.steps
+               << ", \"kept_changed\": " << r.kept_changed << ", \"step_mismatches\": " << r.step_mismatches
+               << " }" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        else
+        {
+            ts << r.resize << "," << (r.reloaded ? 1 : 0) << "," << r.cells << "," << r.steps << ","
+               << r.kept_changed << "," << r.step_mismatches << "\n";
+        }
+    }
+
+    if (format == "json")
+        ts << "]\n";
+}
+
+static void writeResults(const QList<BenchResult> & results, const QString & format, QTextStream & ts)
+{
+    if (format == "json")
+        ts << "[\n";
+    else
+        ts << "workload,mode,cells,edges,threads,steps,seconds,steps_per_sec,ns_per_cell,memory_bytes\n";
+
+    for (int i = 0; i < results.size(); ++i)
+    {
+        const BenchResult & r = results[i];
+        const double steps_per_sec = r.secs > 0 ? r.steps / r.secs : 0.0;
+        const double ns_per_cell = r.steps > 0 && r.cells > 0 ? r.secs * 1e9 / (static_cast<double>(r.steps) * r.cells) : 0.0;
+
+        if (format == "json")
+        {
+            ts << "  { \"workload\": \"" << r.workload << "\", \"mode\": \"" << r.mode << "\""
+               << ", \"cells\": " << r.cells << ", \"edges\": " << r.edges
+               << ", \"threads\": " << r.threads << ", \"steps\": " << r.steps
+               << ", \"seconds\": " << r.secs << ", \"steps_per_sec\": " << steps_per_sec
+               << ", \"ns_per_cell\": " << ns_per_cell << ", \"memory_bytes\": " << r.memory
+               << " }" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        else
+        {
+            ts << r.workload << "," << r.mode << "," << r.cells << "," << r.edges << "," << r.threads << "," << r.steps << ","
+               << r.secs << "," << steps_per_sec << "," << ns_per_cell << "," << r.memory << "\n";
+        }
+    }
+
+    if (format == "json")
+        ts << "]\n";
+}
+
+static int run(const BenchOptions & options)
+{
+    QList<BenchResult> results;
+    QList<CheckResult> checks;
+    QList<ResizeResult> resizes;
+
+    if (options.check_resize)
+    {
+        // grow in both directions, shrink in both, and trade a row for a column, which drops and adds tiles at once
+        const int side = qMax(static_cast<int>(::sqrt(static_cast<double>(options.size) / TILE_SIZE)), 3);
+        for (int reloaded = 0; reloaded < 2; ++reloaded)
+        {
+            resizes.append(checkResize("grow", side, side, side + 2, side + 1, reloaded != 0, options));
+            resizes.append(checkResize("shrink", side, side, side - 1, side - 2, reloaded != 0, options));
+            resizes.append(checkResize("reshape", side, side, side + 1, side - 1, reloaded != 0, options));
+        }
+    }
+
+    foreach (const QString & workload, options.check_resize ? QStringList() : options.workloads)
+    {
+        if (options.check_vector)
+        {
+            // the Life board has no kernels to compare
+            if (workload == "life")
+                continue;
+
+            NeuroNet scalar, vector;
+            if (workload == "random")
+            {
+                buildRandom(scalar, options);
+                buildRandom(vector, options);
+            }
+            else
+            {
+                buildGrid(scalar, options);
+                buildGrid(vector, options);
+            }
+
+            checks.append(checkVector(workload, scalar, vector, options));
+        }
+        else if (workload == "life")
+        {
+            const int side = qMax(static_cast<int>(::sqrt(static_cast<double>(options.size))), 3);
+            LifeBoard board(side, side);
+
+            // the board seeds itself from the clock
+            qsrand(options.seed);
+            board.reset();
+
+            runBoard(board, options, results);
+        }
+        else
+        {
+            NeuroNet network;
+            const int edges = workload == "random" ? buildRandom(network, options) : buildGrid(network, options);
+            runNetwork(workload, network, edges, options, results);
+        }
+    }
+
+    QFile file;
+    if (options.output_fname.isEmpty())
+    {
+        file.open(stdout, QIODevice::WriteOnly | QIODevice::Text);
+    }
+    else
+    {
+        file.setFileName(options.output_fname);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+            throw Common::IOError(QObject::tr("Unable to write results file %1.").arg(options.output_fname));
+    }
+
+    QTextStream ts(&file);
+
+    if (options.check_resize)
+    {
+        writeResizeResults(resizes, options.format, ts);
+
+        foreach (const ResizeResult & check, resizes)
+        {
+            if (check.kept_changed > 0 || check.step_mismatches > 0)
+                return 1;
+        }
+        return 0;
+    }
+
+    if (options.check_vector)
+    {
+        writeCheckResults(checks, options.format, ts);
+
+        foreach (const CheckResult & check, checks)
+        {
+            if (check.violations > 0)
+                return 1;
+        }
+        return 0;
+    }
+
+    writeResults(results, options.format, ts);
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication application(argc, argv);
+
+    try
+    {
+        BenchOptions options;
+        if (!parseArguments(application.arguments(), options))
+        {
+            fputs(USAGE, stderr);
+            return 2;
+        }
+
+        return run(options);
+    }
+    catch (Common::Exception & e)
+    {
+        fprintf(stderr, "neurolab-bench: %s\n", qPrintable(e.message()));
+    }
+    catch (std::exception & se)
+    {
+        fprintf(stderr, "neurolab-bench: %s\n", se.what());
+    }
+    catch (...)
+    {
+        fprintf(stderr, "neurolab-bench: unknown error\n");
+    }
+
+    return 1;
+}
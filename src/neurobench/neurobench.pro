@@ -0,0 +1,48 @@
+CONFIG += debug_and_release
+CONFIG += console
+CONFIG -= app_bundle
+QT -= gui
+
+TARGET = neurolab-bench
+TEMPLATE = app
+
+include(../version.txt)
+
+SOURCES += main.cpp \
+    ../asyncLife/lifecell.cpp \
+    ../asyncLife/lifeboard.cpp
+
+HEADERS += ../asyncLife/lifecell.h \
+    ../asyncLife/lifeboard.h
+
+CONFIG(release, debug|release) { BUILDDIR=release }
+CONFIG(debug, debug|release) {
+    BUILDDIR=debug
+    DEFINES += DEBUG
+}
+
+DESTDIR = $$OUT_PWD/../$$BUILDDIR
+TEMPDIR = $$OUT_PWD/$$BUILDDIR
+
+OBJECTS_DIR = $$TEMPDIR
+MOC_DIR = $$TEMPDIR
+UI_DIR = $$TEMPDIR
+RCC_DIR = $$TEMPDIR
+
+win32 {
+    LIBS += -L$$DESTDIR \
+        -lcommon1 \
+        -lneurolib1 \
+        -lautomata1
+} else:macx {
+    QMAKE_LFLAGS += -F$$DESTDIR/neurolab.app/Contents/Frameworks
+    LIBS += \
+        -framework common \
+        -framework neurolib \
+        -framework automata
+} else {
+    LIBS += -L$$DESTDIR \
+        -lcommon \
+        -lneurolib \
+        -lautomata
+}
@@ -180,10 +180,9 @@ namespace NeuroGui
 
     NeuroCell::Value CompactLinkItem::weight() const
     {
-        const NeuroNet::ASYNC_STATE *fcell = getCell(_frontward_cells.last());
-        const NeuroNet::ASYNC_STATE *bcell = getCell(_backward_cells.last());
+        NeuroNet::ASYNC_STATE fcell, bcell;
 
-        return (fcell != 0 && bcell != 0) ? qMax(fcell->current().weight(), bcell->current().weight()) : 0;
+        return (getCell(_frontward_cells.last(), fcell) && getCell(_backward_cells.last(), bcell)) ? qMax(fcell.current().weight(), bcell.current().weight()) : 0;
     }
 
     void CompactLinkItem::setWeight(const NeuroLib::NeuroCell::Value &value)
@@ -214,8 +213,8 @@ namespace NeuroGui
 
     NeuroCell::Value CompactLinkItem::outputValueAux(const QList<NeuroCell::Index> & cells) const
     {
-        const NeuroNet::ASYNC_STATE *cell = getCell(cells.last());
-        return cell ? cell->current().outputValue() : 0;
+        NeuroNet::ASYNC_STATE cell;
+        return getCell(cells.last(), cell) ? cell.current().outputValue() : 0;
     }
 
     void CompactLinkItem::setOutputValueAux(QList<NeuroLib::NeuroCell::Index> &cells, const NeuroLib::NeuroCell::Value &value)
@@ -423,20 +422,19 @@ namespace NeuroGui
 
         // get output values
         QList<qreal> steps;
+        NeuroNet::ASYNC_STATE cell;
 
         for (int i = 0; i < _frontward_cells.size(); ++i)
         {
             qreal up = 0, down = 0;
 
             // get upward value
-            const NeuroNet::ASYNC_STATE *cell = getCell(_frontward_cells[i]);
-            if (cell)
-                up = qAbs(cell->current().outputValue());
+            if (getCell(_frontward_cells[i], cell))
+                up = qAbs(cell.current().outputValue());
 
             // get downward value
-            cell = getCell(_backward_cells[(_backward_cells.size()-1) - i]);
-            if (cell)
-                down = qAbs(cell->current().outputValue());
+            if (getCell(_backward_cells[(_backward_cells.size()-1) - i], cell))
+                down = qAbs(cell.current().outputValue());
 
             steps.append(qBound(0.0, qMax(up, down), 1.0));
         }
@@ -452,8 +450,7 @@ namespace NeuroGui
         }
 
         // get gradient
-        const NeuroNet::ASYNC_STATE *cell = getCell(_frontward_cells.last());
-        bool frozen = cell && cell->current().frozen();
+        bool frozen = getCell(_frontward_cells.last(), cell) && cell.current().frozen();
 
         QLinearGradient gradient(line.p1(), line.p2());
 
@@ -74,11 +74,10 @@ namespace NeuroGui
 
     NeuroCell::Value CompactNodeItem::outputValue() const
     {
-        const NeuroNet::ASYNC_STATE *frontwardCell = getCell(_frontwardTipCell);
-        const NeuroNet::ASYNC_STATE *backwardCell = getCell(_backwardTipCell);
+        NeuroNet::ASYNC_STATE frontwardCell, backwardCell;
 
-        if (frontwardCell && backwardCell)
-            return qMax(frontwardCell->current().outputValue(), backwardCell->current().outputValue());
+        if (getCell(_frontwardTipCell, frontwardCell) && getCell(_backwardTipCell, backwardCell))
+            return qMax(frontwardCell.current().outputValue(), backwardCell.current().outputValue());
 
         return 0;
     }
@@ -105,6 +105,8 @@ namespace NeuroGui
         Q_ASSERT(network());
         Q_ASSERT(network()->neuronet());
 
+        LabNetwork::HandlerTimer timer(network(), "CompactOrItem::postStep");
+
         // check the output of all our shortcut links
         foreach (NeuroItem *ni, _shortcutItems)
         {
@@ -153,8 +155,8 @@ namespace NeuroGui
 
             NeuroCell::Index targetCellCopyIndex = _futureNetwork.addNode(targetCell->current());
 
-            int num_neighbors;
-            const NeuroCell::Index *neighbors = network()->neuronet()->neighbors(targetCellIndex, num_neighbors);
+            const QVector<NeuroCell::Index> neighbors = network()->neuronet()->neighbors(targetCellIndex);
+            const int num_neighbors = neighbors.size();
             for (int i = 0; i < num_neighbors; ++i)
             {
                 NeuroNet::ASYNC_STATE *inputCell = getCell(neighbors[i]);
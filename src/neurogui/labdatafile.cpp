@@ -39,7 +39,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "neuronetworkitem.h"
 #include "subnetwork/subnetworkitem.h"
 
-#include <QTableWidget>
+#include <QTableView>
 #include <QFileDialog>
 #include <QFile>
 #include <QTextStream>
@@ -50,9 +50,78 @@ POSSIBILITY OF SUCH DAMAGE.
 namespace NeuroGui
 {
 
-    LabDataFile::LabDataFile(LabNetwork *network, QTableWidget *table, QObject *parent)
-        : QObject(parent), _changed(false), _network(network), _table(table)
+    /// How often the view is updated while the network is stepping.
+    static const int UPDATE_MSECS = 100;
+
+    LabDataModel::LabDataModel(const LabDataRecorder & recorder, QObject *parent)
+        : QAbstractTableModel(parent), _recorder(recorder), _num_rows(0), _num_columns(0)
+    {
+    }
+
+    int LabDataModel::rowCount(const QModelIndex & parent) const
+    {
+        return parent.isValid() ? 0 : _num_rows;
+    }
+
+    int LabDataModel::columnCount(const QModelIndex & parent) const
+    {
+        return parent.isValid() ? 0 : _num_columns;
+    }
+
+    QVariant LabDataModel::data(const QModelIndex & index, int role) const
+    {
+        if (role != Qt::DisplayRole || !index.isValid() || index.row() >= _num_rows || index.column() >= _num_columns)
+            return QVariant();
+
+        return _recorder.text(index.row(), index.column());
+    }
+
+    QVariant LabDataModel::headerData(int section, Qt::Orientation orientation, int role) const
+    {
+        if (role == Qt::DisplayRole && orientation == Qt::Horizontal && section < _num_columns)
+            return _recorder.columnLabel(section);
+
+        return QAbstractTableModel::headerData(section, orientation, role);
+    }
+
+    void LabDataModel::updateRows()
     {
+        const int first_changed = qMax(_num_rows - 1, 0);
+        const int num_rows = _recorder.numRows();
+
+        if (num_rows > _num_rows)
+        {
+            beginInsertRows(QModelIndex(), _num_rows, num_rows - 1);
+            _num_rows = num_rows;
+            endInsertRows();
+        }
+
+        if (_num_rows > 0 && _num_columns > 0)
+            emit dataChanged(index(first_changed, 0), index(_num_rows - 1, _num_columns - 1));
+    }
+
+    void LabDataModel::updateAll()
+    {
+        beginResetModel();
+        _num_rows = _recorder.numRows();
+        _num_columns = _recorder.numColumns();
+        endResetModel();
+    }
+
+    //////////////////////////////////////////////////////////////////
+
+    LabDataFile::LabDataFile(LabNetwork *network, QTableView *view, QObject *parent)
+        : QObject(parent), _changed(false), _network(network), _view(view), _model(0)
+    {
+        _model = new LabDataModel(_recorder, this);
+
+        if (_view)
+            _view->setModel(_model);
+
+        _update_timer.setSingleShot(true);
+        _update_timer.setInterval(UPDATE_MSECS);
+        connect(&_update_timer, SIGNAL(timeout()), this, SLOT(updateView()));
+
         if (_network)
         {
             reset();
@@ -65,13 +134,14 @@ namespace NeuroGui
 
     LabDataFile::~LabDataFile()
     {
+        if (_view && _view->model() == _model)
+            _view->setModel(0);
     }
 
     void LabDataFile::changeItemLabel(NeuroItem *item, const QString & label)
     {
         Q_ASSERT(item != 0);
         Q_ASSERT(_network != 0);
-        Q_ASSERT(_table != 0);
 
         // only record network items
         if (dynamic_cast<NeuroNetworkItem *>(item) == 0)
@@ -80,72 +150,63 @@ namespace NeuroGui
         if (dynamic_cast<SubNetworkItem *>(item) != 0)
             return;
 
-        // get column index
-        int columnIndex = -1;
-
         if (_itemColumnIndices.contains(item))
         {
-            columnIndex = _itemColumnIndices[item];
-
             // remove column if the label is now empty
             if (label.isNull() || label.isEmpty())
             {
-                setChanged();
-                _table->removeColumn(columnIndex);
-                columnIndex = -1;
+                deleteItem(item);
+                return;
             }
+
+            _recorder.setColumnLabel(_itemColumnIndices[item], label);
         }
         else if (!label.isNull() && !label.isEmpty())
         {
-            columnIndex = _table->columnCount();
-            _itemColumnIndices[item] = columnIndex;
+            float value;
+            _itemColumnIndices[item] = _recorder.addColumn(label, item->dataSample(value));
         }
-
-        if (columnIndex == -1)
-            return; // don't bother with empty labels
-
-        // insert column if not present
-        if (columnIndex >= _table->columnCount())
+        else
         {
-            _table->setColumnCount(columnIndex + 1);
-        }
-
-        // create new header item if necessary
-        QTableWidgetItem *header = _table->horizontalHeaderItem(columnIndex);
-
-        if (!header)
-        {
-            header = new QTableWidgetItem();
-            _table->setHorizontalHeaderItem(columnIndex, header);
+            return; // don't bother with empty labels
         }
 
-        // set label
-        header->setText(label);
+        _model->updateAll();
         valuesChanged();
     }
 
     void LabDataFile::deleteItem(NeuroItem *item)
     {
         Q_ASSERT(item != 0);
-        Q_ASSERT(_table != 0);
 
         if (_itemColumnIndices.contains(item))
         {
             setChanged();
-            _table->removeColumn(_itemColumnIndices[item]);
-            _itemColumnIndices.remove(item);
+
+            const int columnIndex = _itemColumnIndices.take(item);
+            _recorder.removeColumn(columnIndex);
+
+            QMutableMapIterator<NeuroItem *, int> i(_itemColumnIndices);
+            while (i.hasNext())
+            {
+                i.next();
+                if (i.value() > columnIndex)
+                    i.setValue(i.value() - 1);
+            }
+
+            _model->updateAll();
         }
     }
 
     void LabDataFile::reset()
     {
         Q_ASSERT(_network);
-        Q_ASSERT(_table);
 
-        _table->clear();
-        _table->setSortingEnabled(false);
+        _update_timer.stop();
 
+        _recorder.clear();
         _itemColumnIndices.clear();
+        _model->updateAll();
 
         foreach (QGraphicsItem *gi, _network->items())
         {
@@ -158,39 +219,35 @@ namespace NeuroGui
         }
 
         incrementStep();
+        updateView();
         setChanged(false);
     }
 
-    static void disableEdit(QTableWidgetItem *wi)
+    /// Records the items' current values in the last row.
+    void LabDataFile::recordValues()
     {
-        Qt::ItemFlags f = wi->flags();
-        f &= !Qt::ItemIsEditable;
-        wi->setFlags(f);
+        QMapIterator<NeuroItem *, int> i(_itemColumnIndices);
+        while (i.hasNext())
+        {
+            i.next();
+
+            float value;
+            if (_recorder.columnIsNumeric(i.value()) && i.key()->dataSample(value))
+                _recorder.setValue(i.value(), value);
+            else if (!_recorder.columnIsNumeric(i.value()))
+                _recorder.setText(i.value(), i.key()->dataValue());
+        }
     }
 
     void LabDataFile::valuesChanged()
     {
-        int row = _table->rowCount() - 1;
-        if (row >= 0)
+        if (_recorder.numRows() > 0)
         {
-            foreach (NeuroItem *item, _itemColumnIndices.keys())
-            {
-                int columnIndex = _itemColumnIndices[item];
-
-                QTableWidgetItem *wi = _table->item(row, columnIndex);
-                if (wi)
-                {
-                    wi->setText(item->dataValue());
-                }
-                else
-                {
-                    wi = new QTableWidgetItem(item->dataValue());
-                    _table->setItem(row, columnIndex, wi);
-                    disableEdit(wi);
-                }
-            }
-
+            recordValues();
             setChanged();
+
+            if (!_update_timer.isActive())
+                _update_timer.start();
         }
     }
 
@@ -199,15 +256,26 @@ namespace NeuroGui
         if (_itemColumnIndices.size() == 0)
             return;
 
-        int newRow = _table->rowCount();
-        _table->setRowCount(newRow + 1);
-
+        _recorder.appendRow();
         valuesChanged();
+    }
+
+    /// Shows new rows in the view; if the view was scrolled to the bottom, it follows them.
+    void LabDataFile::updateView()
+    {
+        if (!_view)
+        {
+            _model->updateRows();
+            return;
+        }
 
-        if (_table->verticalHeaderItem(newRow))
-            _table->verticalHeaderItem(newRow)->setText(QString::number(newRow));
+        QScrollBar *scroll = _view->verticalScrollBar();
+        const bool follow = !scroll || scroll->value() == scroll->maximum();
 
-        _table->verticalScrollBar()->setValue(_table->verticalScrollBar()->maximum());
+        _model->updateRows();
+
+        if (follow)
+            _view->scrollToBottom();
     }
 
     static QString csv(const QString & s)
@@ -245,25 +313,28 @@ namespace NeuroGui
                 ts << '\n';
 
                 // write column names
-                for (int col = 0; col < _table->columnCount(); ++col)
+                const int num_columns = _recorder.numColumns();
+                for (int col = 0; col < num_columns; ++col)
                 {
                     if (col > 0)
                         ts << ", ";
-                    if (_table->horizontalHeaderItem(col))
-                        ts << csv(_table->horizontalHeaderItem(col)->text());
+                    ts << csv(_recorder.columnLabel(col));
                 }
-                if (_table->columnCount() > 0)
+                if (num_columns > 0)
                     ts << '\n';
 
                 // write data
-                for (int row = 0; row < _table->rowCount(); ++row)
+                const int num_rows = _recorder.numRows();
+                for (int row = 0; row < num_rows; ++row)
                 {
-                    for (int col = 0; col < _table->columnCount(); ++col)
+                    for (int col = 0; col < num_columns; ++col)
                     {
                         if (col > 0)
                             ts << ", ";
-                        if (_table->item(row, col))
-                            ts << csv(_table->item(row, col)->text());
+
+                        const QString text = _recorder.text(row, col);
+                        if (!text.isNull())
+                            ts << csv(text);
                     }
                     ts << '\n';
                 }
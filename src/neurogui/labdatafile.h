@@ -38,11 +38,14 @@ POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include "neurogui_global.h"
+#include "labdatarecorder.h"
 
 #include <QObject>
 #include <QMap>
+#include <QTimer>
+#include <QAbstractTableModel>
 
-class QTableWidget;
+class QTableView;
 
 namespace NeuroGui
 {
@@ -50,6 +53,32 @@ namespace NeuroGui
     class NeuroItem;
     class LabNetwork;
 
+    /// Presents the values in a data recorder to a table view.
+    /// The view only asks for the cells it shows, so the model's size doesn't affect drawing.
+    class NEUROGUISHARED_EXPORT LabDataModel
+        : public QAbstractTableModel
+    {
+        Q_OBJECT
+
+        const LabDataRecorder & _recorder;
+        int _num_rows;
+        int _num_columns;
+
+    public:
+        explicit LabDataModel(const LabDataRecorder & recorder, QObject *parent = 0);
+
+        virtual int rowCount(const QModelIndex & parent = QModelIndex()) const;
+        virtual int columnCount(const QModelIndex & parent = QModelIndex()) const;
+        virtual QVariant data(const QModelIndex & index, int role = Qt::DisplayRole) const;
+        virtual QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+
+        /// Tells the view about rows appended to the recorder, and changes to the last row.
+        void updateRows();
+
+        /// Tells the view that the recorder's columns have changed.
+        void updateAll();
+    };
+
     class NEUROGUISHARED_EXPORT LabDataFile
         : public QObject
     {
@@ -58,18 +87,23 @@ namespace NeuroGui
         bool _changed;
 
         LabNetwork *_network;
-        QTableWidget *_table;
+        QTableView *_view;
+
+        LabDataRecorder _recorder;
+        LabDataModel *_model;
+        QTimer _update_timer;
 
         QMap<NeuroItem *, int> _itemColumnIndices;
 
     public:
-        explicit LabDataFile(LabNetwork *network, QTableWidget *table, QObject *parent = 0);
+        explicit LabDataFile(LabNetwork *network, QTableView *view, QObject *parent = 0);
         virtual ~LabDataFile();
 
         bool changed() const { return _changed; }
         void setChanged(bool changed = true) { _changed = changed; }
 
-        QTableWidget *table() { return _table; }
+        QTableView *view() { return _view; }
+        const LabDataRecorder & recorder() const { return _recorder; }
 
     public slots:
         void changeItemLabel(NeuroItem *item, const QString & label);
@@ -80,6 +114,12 @@ namespace NeuroGui
         void incrementStep();
 
         void saveAs();
+
+    private slots:
+        void updateView();
+
+    private:
+        void recordValues();
     };
 
 }
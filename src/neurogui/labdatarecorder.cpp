@@ -0,0 +1,253 @@
+/*
+Neurocognitive Linguistics Lab
+Copyright (c) 2010,2011 Gordon Tisher
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+ - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+ - Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in
+   the documentation and/or other materials provided with the
+   distribution.
+
+ - Neither the name of the Neurocognitive Linguistics Lab nor the
+   names of its contributors may be used to endorse or promote
+   products derived from this software without specific prior
+   written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "labdatarecorder.h"
+
+#include <QTemporaryFile>
+#include <QDir>
+#include <QtNumeric>
+
+namespace NeuroGui
+{
+
+    const int LabDataRecorder::CHUNK_ROWS;
+    const qint64 LabDataRecorder::DEFAULT_MEMORY_LIMIT;
+
+    /// The number of spilled chunks to keep after reading them back.
+    static const int SPILL_CACHE_CHUNKS = 1024;
+
+    LabDataRecorder::LabDataRecorder(const qint64 & memoryLimit)
+        : _num_rows(0), _memory_limit(memoryLimit), _resident_chunks(0), _spill_file(0), _spill_failed(false)
+    {
+    }
+
+    LabDataRecorder::~LabDataRecorder()
+    {
+        clear();
+    }
+
+    int LabDataRecorder::addColumn(const QString & label, bool numeric)
+    {
+        Column col;
+        col.label = label;
+        col.numeric = numeric;
+        col.first_row = qMax(_num_rows - 1, 0);
+        col.num_spilled = 0;
+
+        _columns.append(col);
+        extend(_columns.last());
+        return _columns.size() - 1;
+    }
+
+    void LabDataRecorder::removeColumn(const int & column)
+    {
+        const Column & col = _columns[column];
+        if (col.numeric)
+            _resident_chunks -= col.chunks.size() - col.num_spilled;
+
+        // the column's spilled chunks stay in the spill file until it is cleared
+        _columns.removeAt(column);
+    }
+
+    void LabDataRecorder::appendRow()
+    {
+        ++_num_rows;
+
+        for (int i = 0; i < _columns.size(); ++i)
+            extend(_columns[i]);
+
+        if (_resident_chunks * CHUNK_ROWS * static_cast<qint64>(sizeof(float)) > _memory_limit)
+            spill();
+    }
+
+    void LabDataRecorder::setValue(const int & column, const float & value)
+    {
+        Column & col = _columns[column];
+        Q_ASSERT(col.numeric);
+
+        if (_num_rows > col.first_row)
+            lastChunk(col).values[(_num_rows - 1 - col.first_row) % CHUNK_ROWS] = value;
+    }
+
+    void LabDataRecorder::setText(const int & column, const QString & text)
+    {
+        Column & col = _columns[column];
+        Q_ASSERT(!col.numeric);
+
+        if (_num_rows > col.first_row)
+            lastChunk(col).texts[(_num_rows - 1 - col.first_row) % CHUNK_ROWS] = text;
+    }
+
+    QString LabDataRecorder::text(const int & row, const int & column) const
+    {
+        const Column & col = _columns[column];
+        if (row < col.first_row || row >= _num_rows)
+            return QString();
+
+        const int chunk_index = (row - col.first_row) / CHUNK_ROWS;
+        const int offset = (row - col.first_row) % CHUNK_ROWS;
+
+        if (!col.numeric)
+            return col.chunks[chunk_index].texts[offset];
+
+        const float *values = chunkValues(col.chunks[chunk_index]);
+        if (!values || qIsNaN(values[offset]))
+            return QString();
+
+        return QString::number(values[offset]);
+    }
+
+    void LabDataRecorder::clear()
+    {
+        _columns.clear();
+        _num_rows = 0;
+        _resident_chunks = 0;
+
+        _spill_cache.clear();
+        delete _spill_file;
+        _spill_file = 0;
+        _spill_failed = false;
+    }
+
+    LabDataRecorder::Chunk & LabDataRecorder::lastChunk(Column & col)
+    {
+        Q_ASSERT(!col.chunks.isEmpty());
+        return col.chunks.last();
+    }
+
+    /// Adds chunks to a column until it covers all the rows.  New values are empty.
+    void LabDataRecorder::extend(Column & col)
+    {
+        const int rows = _num_rows - col.first_row;
+
+        while (col.chunks.size() * CHUNK_ROWS < rows)
+        {
+            Chunk chunk;
+
+            if (col.numeric)
+            {
+                chunk.values.fill(qQNaN(), CHUNK_ROWS);
+                ++_resident_chunks;
+            }
+            else
+            {
+                chunk.texts.resize(CHUNK_ROWS);
+            }
+
+            col.chunks.append(chunk);
+        }
+    }
+
+    /// Writes the oldest complete numeric chunks to the spill file until the resident chunks fit in the memory limit.
+    /// If the spill file can't be created, all the chunks stay in memory.
+    void LabDataRecorder::spill()
+    {
+        if (_spill_failed)
+            return;
+
+        if (!_spill_file)
+        {
+            _spill_file = new QTemporaryFile(QDir::tempPath() + "/neurolab_data_XXXXXX");
+            if (!_spill_file->open())
+            {
+                delete _spill_file;
+                _spill_file = 0;
+                _spill_failed = true;
+                return;
+            }
+        }
+
+        const qint64 chunk_bytes = CHUNK_ROWS * static_cast<qint64>(sizeof(float));
+        const qint64 max_resident = qMax(_memory_limit / chunk_bytes, static_cast<qint64>(1));
+
+        bool spilled = true;
+        while (_resident_chunks > max_resident && spilled)
+        {
+            spilled = false;
+
+            // take one chunk from each column in turn, so that the columns' resident rows stay in step
+            for (int i = 0; i < _columns.size() && _resident_chunks > max_resident; ++i)
+            {
+                Column & col = _columns[i];
+
+                // the last chunk is still being written
+                if (!col.numeric || col.num_spilled >= col.chunks.size() - 1)
+                    continue;
+
+                Chunk & chunk = col.chunks[col.num_spilled];
+                const qint64 offset = _spill_file->size();
+
+                if (!_spill_file->seek(offset)
+                    || _spill_file->write(reinterpret_cast<const char *>(chunk.values.constData()), chunk_bytes) != chunk_bytes)
+                {
+                    _spill_failed = true;
+                    return;
+                }
+
+                chunk.spill_offset = offset;
+                chunk.values = QVector<float>();
+
+                ++col.num_spilled;
+                --_resident_chunks;
+                spilled = true;
+            }
+        }
+    }
+
+    /// \return The chunk's values, reading them back from the spill file if necessary; 0 if they can't be read.
+    const float *LabDataRecorder::chunkValues(const Chunk & chunk) const
+    {
+        if (chunk.spill_offset < 0)
+            return chunk.values.constData();
+
+        if (_spill_cache.contains(chunk.spill_offset))
+            return _spill_cache[chunk.spill_offset].constData();
+
+        if (_spill_cache.size() >= SPILL_CACHE_CHUNKS)
+            _spill_cache.clear();
+
+        const qint64 chunk_bytes = CHUNK_ROWS * static_cast<qint64>(sizeof(float));
+        QVector<float> values(CHUNK_ROWS);
+
+        if (!_spill_file || !_spill_file->seek(chunk.spill_offset)
+            || _spill_file->read(reinterpret_cast<char *>(values.data()), chunk_bytes) != chunk_bytes)
+            return 0;
+
+        _spill_cache.insert(chunk.spill_offset, values);
+        return _spill_cache[chunk.spill_offset].constData();
+    }
+
+} // namespace NeuroGui
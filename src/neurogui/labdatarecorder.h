@@ -0,0 +1,140 @@
+#ifndef LABDATARECORDER_H
+#define LABDATARECORDER_H
+
+/*
+Neurocognitive Linguistics Lab
+Copyright (c) 2010,2011 Gordon Tisher
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+ - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+ - Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in
+   the documentation and/or other materials provided with the
+   distribution.
+
+ - Neither the name of the Neurocognitive Linguistics Lab nor the
+   names of its contributors may be used to endorse or promote
+   products derived from this software without specific prior
+   written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "neurogui_global.h"
+
+#include <QString>
+#include <QVector>
+#include <QList>
+#include <QHash>
+
+class QTemporaryFile;
+
+namespace NeuroGui
+{
+
+    /// Stores the values recorded from a network's labelled items, one column per item and one row per step.
+    /// Numeric columns hold raw float samples in fixed-size chunks; once the resident chunks exceed the recorder's
+    /// memory limit, the oldest complete chunks are spilled to a temporary file and read back on demand.
+    /// Text columns (see NeuroItem::dataSample()) are always kept in memory.
+    class NEUROGUISHARED_EXPORT LabDataRecorder
+    {
+    public:
+        /// The number of rows in a column chunk.
+        static const int CHUNK_ROWS = 4096;
+
+        /// The default number of bytes of numeric samples to keep in memory before spilling to disk.
+        static const qint64 DEFAULT_MEMORY_LIMIT = 64 * 1024 * 1024;
+
+    private:
+        /// \internal A run of CHUNK_ROWS values in a column.
+        struct Chunk
+        {
+            QVector<float> values;    ///< Numeric samples; empty if the chunk has been spilled.
+            QVector<QString> texts;   ///< Text values, for text columns.
+            qint64 spill_offset;      ///< Offset of the chunk in the spill file, or -1.
+
+            Chunk() : spill_offset(-1) {}
+        };
+
+        /// \internal A recorded item.
+        struct Column
+        {
+            QString label;
+            bool numeric;
+            int first_row;            ///< The row at which the column's values start.
+            int num_spilled;          ///< The number of leading chunks that have been spilled.
+            QList<Chunk> chunks;
+        };
+
+        QList<Column> _columns;
+        int _num_rows;
+
+        qint64 _memory_limit;
+        int _resident_chunks;
+
+        QTemporaryFile *_spill_file;
+        bool _spill_failed;
+        mutable QHash<qint64, QVector<float> > _spill_cache;
+
+    public:
+        explicit LabDataRecorder(const qint64 & memoryLimit = DEFAULT_MEMORY_LIMIT);
+        ~LabDataRecorder();
+
+        /// \return The number of bytes of numeric samples kept in memory before spilling to disk.
+        qint64 memoryLimit() const { return _memory_limit; }
+
+        int numRows() const { return _num_rows; }
+        int numColumns() const { return _columns.size(); }
+
+        /// Adds a column.  The column's values start at the current (last) row; earlier rows are empty.
+        /// \return The index of the new column.
+        int addColumn(const QString & label, bool numeric);
+        void removeColumn(const int & column);
+
+        QString columnLabel(const int & column) const { return _columns[column].label; }
+        void setColumnLabel(const int & column, const QString & label) { _columns[column].label = label; }
+
+        bool columnIsNumeric(const int & column) const { return _columns[column].numeric; }
+
+        /// Appends an empty row; subsequent values are set in it.
+        void appendRow();
+
+        /// Sets a numeric column's value in the last row.
+        void setValue(const int & column, const float & value);
+
+        /// Sets a text column's value in the last row.
+        void setText(const int & column, const QString & text);
+
+        /// \return The value at the given row and column, formatted for display; empty if there is none.
+        QString text(const int & row, const int & column) const;
+
+        /// Removes all rows and columns, and the spill file.
+        void clear();
+
+    private:
+        Chunk & lastChunk(Column & col);
+        void extend(Column & col);
+        void spill();
+        const float *chunkValues(const Chunk & chunk) const;
+    }; // class LabDataRecorder
+
+} // namespace NeuroGui
+
+#endif // LABDATARECORDER_H
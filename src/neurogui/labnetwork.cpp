@@ -51,6 +51,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include <QPrinter>
 #include <QFileDialog>
 #include <QSvgGenerator>
+#include <QtConcurrentRun>
 
 #include <QtVariantPropertyManager>
 #include <QtVariantProperty>
@@ -60,6 +61,12 @@ using namespace NeuroLib;
 namespace NeuroGui
 {
 
+    /// How often the display is updated while stepping, in milliseconds.
+    static const int FRAME_MSECS = 500;
+
+    /// How often a checkpoint of the network is taken while stepping, in milliseconds.
+    static const int CHECKPOINT_MSECS = 5 * 60 * 1000;
+
     /// Constructor.
     /// \param parent The QObject that should own this network object.
     LabNetwork::LabNetwork(QWidget *parent)
@@ -76,16 +83,34 @@ namespace NeuroGui
                               tr("Node Forget Rate"), tr("Controls the rate of node threshold lowering.")),
         _learn_time_property(this, &LabNetwork::learnTime, &LabNetwork::setLearnTime,
                              tr("Learn Window"), tr("Window of time used to calculate running average for link and node learning.")),
-        _current_step(0), _max_steps(0), _cancel_step(false)
+        _current_step(0), _max_steps(0), _passes_per_step(3), _cancel_step(false),
+        _frame_pending(false), _run_ahead_steps(0),
+        _checkpoint(0), _timestep(0), _profiling(false)
     {
+        _checkpoint_time.start();
+
         _neuronet = new NeuroLib::NeuroNet();
+        _neuronet->setStorageMode(NeuroLib::NeuroNet::ARRAY_STORAGE);
         _tree = new LabTree(parent, this);
 
         connect(&_future_watcher, SIGNAL(finished()), this, SLOT(futureFinished()), Qt::UniqueConnection);
+        connect(&_run_ahead_watcher, SIGNAL(finished()), this, SLOT(runAheadFinished()), Qt::UniqueConnection);
     }
 
     LabNetwork::~LabNetwork()
     {
+        if (_run_ahead_watcher.isRunning())
+        {
+            {
+                QMutexLocker lock(&_frame_mutex);
+                _cancel_step = true;
+                _frame_shown.wakeAll();
+            }
+
+            _run_ahead_watcher.waitForFinished();
+        }
+
+        delete _checkpoint; _checkpoint = 0;
         delete _tree; _tree = 0;
         delete _neuronet; _neuronet = 0;
     }
@@ -270,6 +295,16 @@ namespace NeuroGui
     /// Should be changed whenever anything in the the network file format changes.
     static const QString LAB_SCENE_COOKIE_NEW("Neurolab SCENE");
 
+    /// Reads a network's automaton; runs in the background while LabNetwork::open() reads the scene.
+    static void readAutomaton(NeuroLib::NeuroNet *neuronet, QFile *file)
+    {
+        QDataStream ds(file);
+        ds.setVersion(QDataStream::Qt_4_6);
+
+        Automata::AutomataFileVersion fv;
+        neuronet->readBinary(ds, fv);
+    }
+
     /// Loads a LabNetwork object and its corresponding NeuroNet from a file.
     /// LabNetwork files have the extension .nln; their corresponding NeuroNet files have the extension .nnn.
     /// \param fname The name of the file from which to load the network.
@@ -309,33 +344,22 @@ namespace NeuroGui
         ln->_loading = true;
         ln->_fname = nln_fname;
 
+        QFile nnn_file(nnn_fname);
+        if (!nnn_file.open(QIODevice::ReadOnly))
         {
-            QFile file(nnn_fname);
-            if (file.open(QIODevice::ReadOnly))
-            {
-                try
-                {
-                    QDataStream ds(&file);
-                    ds.setVersion(QDataStream::Qt_4_6);
-
-                    Automata::AutomataFileVersion fv;
-                    ln->_neuronet->readBinary(ds, fv);
-                    ln->updateProperties();
-                }
-                catch (...)
-                {
-                    delete ln;
-                    throw Common::IOError(tr("Network file %1 is not compatible with this version of NeuroLab.").arg(nnn_fname));
-                }
-            }
-            else
-            {
-                delete ln;
-                throw Common::IOError(tr("Unable to open network file."));
-            }
+            delete ln;
+            throw Common::IOError(tr("Unable to open network file."));
         }
 
+        // decode the automaton in the background while the scene is read
+        QFuture<void> automaton_future = QtConcurrent::run(&readAutomaton, ln->_neuronet, &nnn_file);
+
         // read scene data
+        QString scene_error;
+        bool scene_format_error = false;
+        bool clear_ids = false;
+
+        try
         {
             QFile file(nln_fname);
 
@@ -356,7 +380,7 @@ namespace NeuroGui
                     fv.neurolab_version = ver;
 
                     ln->_tree->readBinary(ds, fv);
-                    ln->_idMap.clear();
+                    clear_ids = true;
                 }
                 else if (cookie == LAB_SCENE_COOKIE_OLD)
                 {
@@ -367,16 +391,81 @@ namespace NeuroGui
                 }
                 else
                 {
-                    delete ln;
-                    throw Common::FileFormatError(tr("Network scene file %1 is not compatible with this version of NeuroLab.").arg(nln_fname));
+                    scene_error = tr("Network scene file %1 is not compatible with this version of NeuroLab.").arg(nln_fname);
+                    scene_format_error = true;
                 }
-
-                ln->setChanged(false);
             }
             else
             {
-                delete ln;
-                throw Common::IOError(tr("Unable to open network scene file."));
+                scene_error = tr("Unable to open network scene file.");
+            }
+        }
+        catch (Common::Exception & e)
+        {
+            scene_error = e.message();
+        }
+        catch (...)
+        {
+            // nothing may leave before the automaton is done with the file and the network
+            scene_error = tr("Unable to read network scene file %1.").arg(nln_fname);
+        }
+
+        // the items can only be connected to the automaton once it is loaded
+        bool automaton_ok = true;
+        try
+        {
+            automaton_future.waitForFinished();
+        }
+        catch (...)
+        {
+            automaton_ok = false;
+        }
+
+        if (!automaton_ok)
+        {
+            delete ln;
+            throw Common::IOError(tr("Network file %1 is not compatible with this version of NeuroLab.").arg(nnn_fname));
+        }
+
+        if (!scene_error.isEmpty())
+        {
+            delete ln;
+            if (scene_format_error)
+                throw Common::FileFormatError(scene_error);
+            else
+                throw Common::IOError(scene_error);
+        }
+
+        ln->updateProperties();
+        ln->_tree->postLoad();
+        if (clear_ids)
+            ln->_idMap.clear();
+        ln->setChanged(false);
+
+        // offer to restore a checkpoint left by a run that didn't finish
+        {
+            QString nnc_fname = base_fname + ".nnc";
+            QFileInfo nnc_info(QFile::exists(nnc_fname) ? nnc_fname : nnc_fname + ".new");
+
+            if (nnc_info.exists() && nnc_info.lastModified() > QFileInfo(nnn_fname).lastModified())
+            {
+                if (QMessageBox::question(MainWindow::instance(), tr("Restore Checkpoint"),
+                                          tr("There is a checkpoint of this network from %1, which is newer than the saved network.  Do you want to restore it?")
+                                          .arg(nnc_info.lastModified().toString()),
+                                          QMessageBox::Yes | QMessageBox::No) == QMessageBox::Yes)
+                {
+                    try
+                    {
+                        ln->_timestep = NeuroCheckpoint::restore(nnc_fname, *ln->_neuronet);
+                        ln->updateProperties();
+                        ln->_tree->updateItemProperties();
+                        ln->setChanged(true);
+                    }
+                    catch (Common::Exception & e)
+                    {
+                        QMessageBox::warning(MainWindow::instance(), tr("Unable to restore checkpoint."), e.message());
+                    }
+                }
             }
         }
 
@@ -462,6 +551,9 @@ namespace NeuroGui
             }
         }
 
+        // the saved network is newer than any checkpoint
+        removeCheckpoint();
+
         setChanged(false);
         emit actionsEnabled(true);
 
@@ -549,6 +641,29 @@ namespace NeuroGui
             _tree->removeWidgetsFrom(w);
     }
 
+    void LabNetwork::setProfiling(const bool & profiling)
+    {
+        _profiling = profiling;
+
+        if (_neuronet)
+            _neuronet->setProfiling(profiling);
+    }
+
+    void LabNetwork::addHandlerTime(const QString & name, const qint64 & nsecs)
+    {
+        HandlerTime & time = _handler_times[name];
+        ++time.calls;
+        time.nsecs += nsecs;
+    }
+
+    void LabNetwork::clearProfile()
+    {
+        _handler_times.clear();
+
+        if (_neuronet)
+            _neuronet->clearProfile();
+    }
+
     /// \return True if there is something to paste.
     bool LabNetwork::canPaste() const
     {
@@ -788,7 +903,8 @@ namespace NeuroGui
 
         _running = true;
         _current_step = 0;
-        _max_steps = numSteps * 3; // takes 3 steps of the automaton to fully process
+        _passes_per_step = _neuronet->passesPerStep(); // the asynchronous automaton takes 3 steps to fully process
+        _max_steps = numSteps * _passes_per_step;
         _step_time.start();
 
 
@@ -800,12 +916,125 @@ namespace NeuroGui
             emit stepProgressValueChanged(0);
         }
 
+        // if nothing needs to see every timestep, run them all in the background
+        if (numSteps > 1 && !needsStepSignals())
+        {
+            _frame_pending = false;
+            _run_ahead_steps = 0;
+
+            emit stepClicked();
+            emitPreStep();
+            _run_ahead_watcher.setFuture(QtConcurrent::run(this, &LabNetwork::runAhead, numSteps));
+            return;
+        }
+
         _neuronet->preUpdate();
         emit stepClicked();
-        emit preStep();
+        emitPreStep();
         _future_watcher.setFuture(_neuronet->stepAsync());
     }
 
+    /// Emits preStep(), timing all its handlers together if profiling.
+    void LabNetwork::emitPreStep()
+    {
+        HandlerTimer timer(this, "preStep (all handlers)");
+        emit preStep();
+    }
+
+    /// Emits postStep(), timing all its handlers together if profiling.
+    void LabNetwork::emitPostStep()
+    {
+        HandlerTimer timer(this, "postStep (all handlers)");
+        emit postStep();
+    }
+
+    /// \return Whether anything other than the main window is connected to the signals emitted for each timestep.
+    /// If not, a run of several timesteps does not need to come back to the GUI thread between them.
+    bool LabNetwork::needsStepSignals() const
+    {
+        // the main window passes preStep() and postStep() along, but only for display
+        int relays = (MainWindow::instance() && MainWindow::instance()->currentNetwork() == this) ? 1 : 0;
+
+        return receivers(SIGNAL(preStep())) > relays
+                || receivers(SIGNAL(postStep())) > relays
+                || receivers(SIGNAL(stepIncremented())) > 0;
+    }
+
+    /// Runs timesteps back-to-back in a background thread.  Every so often it has the GUI thread show
+    /// the state of the network, and waits for it to be done, so that the display sees a consistent snapshot.
+    void LabNetwork::runAhead(int num_steps)
+    {
+        QTime frame_time;
+        frame_time.start();
+
+        for (int s = 0; s < num_steps; ++s)
+        {
+            for (quint32 p = 0; p < _passes_per_step; ++p)
+            {
+                _neuronet->preUpdate();
+                _neuronet->step();
+                _neuronet->postUpdate();
+            }
+
+            ++_timestep;
+            checkpoint();
+
+            QMutexLocker lock(&_frame_mutex);
+            _run_ahead_steps = s + 1;
+
+            if (_cancel_step)
+                break;
+
+            if (frame_time.elapsed() >= FRAME_MSECS && s + 1 < num_steps)
+            {
+                _frame_pending = true;
+                QMetaObject::invokeMethod(this, "showFrame", Qt::QueuedConnection);
+
+                while (_frame_pending && !_cancel_step)
+                    _frame_shown.wait(&_frame_mutex);
+
+                frame_time.start();
+            }
+        }
+
+        QMutexLocker lock(&_frame_mutex);
+        _frame_pending = false;
+    }
+
+    /// Shows the state of the network while the run-ahead thread waits.
+    void LabNetwork::showFrame()
+    {
+        {
+            QMutexLocker lock(&_frame_mutex);
+            if (!_frame_pending)
+                return;
+
+            _current_step = _run_ahead_steps * _passes_per_step;
+        }
+
+        emitPostStep();
+
+        if (_max_steps > _passes_per_step)
+            emit stepProgressValueChanged(_current_step);
+
+        _tree->updateItemProperties();
+
+        QMutexLocker lock(&_frame_mutex);
+        _frame_pending = false;
+        _frame_shown.wakeAll();
+    }
+
+    /// Called when the run-ahead thread is done.
+    void LabNetwork::runAheadFinished()
+    {
+        _run_ahead_watcher.waitForFinished();
+
+        _current_step = _run_ahead_steps * _passes_per_step;
+        emitPostStep();
+
+        finishStepping();
+    }
+
     /// Called when a timestep is complete.
     void LabNetwork::futureFinished()
     {
@@ -814,46 +1043,36 @@ namespace NeuroGui
         // at the end of each step, do post updates
         _neuronet->postUpdate();
 
-        // at the end of three steps, do post steps
+        // at the end of a full timestep, do post steps
         ++_current_step;
-        bool every_three = (_current_step % 3) == 0;
-        if (every_three)
+        bool end_of_step = (_current_step % _passes_per_step) == 0;
+        if (end_of_step)
         {
-            emit postStep();
+            ++_timestep;
+            checkpoint();
+
+            emitPostStep();
             emit stepIncremented();
         }
 
         // are we done?
         if (_current_step == _max_steps || _cancel_step)
         {
-            if (_max_steps > 3)
-                emit stepProgressValueChanged(_max_steps);
-
-            emit actionsEnabled(true);
-
-            if (_max_steps == 3)
-                emit statusChanged(tr("Done stepping 1 time."));
-            else
-                emit statusChanged(tr("Done stepping %1 times.").arg(_current_step / 3));
-
-            _running = false;
-            setChanged(true);
-            _tree->updateItemProperties();
-            emit stepFinished();
+            finishStepping();
         }
         else
         {
             _neuronet->preUpdate();
-            if (every_three)
-                emit preStep();
+            if (end_of_step)
+                emitPreStep();
             _future_watcher.setFuture(_neuronet->stepAsync());
 
             // only change the display 2 times a second
-            if (_step_time.elapsed() >= 500)
+            if (_step_time.elapsed() >= FRAME_MSECS)
             {
                 _step_time.start();
 
-                if (_max_steps > 3)
+                if (_max_steps > _passes_per_step)
                     emit stepProgressValueChanged(_current_step);
 
                 _tree->updateItemProperties();
@@ -861,8 +1080,90 @@ namespace NeuroGui
         }
     }
 
+    /// Updates the display and re-enables the actions once a run of timesteps is done.
+    void LabNetwork::finishStepping()
+    {
+        if (_max_steps > _passes_per_step)
+            emit stepProgressValueChanged(_max_steps);
+
+        emit actionsEnabled(true);
+
+        if (_max_steps == _passes_per_step)
+            emit statusChanged(tr("Done stepping 1 time."));
+        else
+            emit statusChanged(tr("Done stepping %1 times.").arg(_current_step / _passes_per_step));
+
+        _running = false;
+        setChanged(true);
+        _tree->updateItemProperties();
+        emit stepFinished();
+    }
+
+    /// \return The name of the file to which checkpoints of the network are written, or an empty string if it has not been saved.
+    QString LabNetwork::checkpointFileName() const
+    {
+        if (_fname.isEmpty())
+            return QString();
+
+        QString base_name = _fname.endsWith(".nln", Qt::CaseInsensitive) ? _fname.left(_fname.length() - 4) : _fname;
+        return base_name + ".nnc";
+    }
+
+    /// Takes a checkpoint of the network, if one is due.  The cells are copied in the calling thread, which must be
+    /// the one stepping the network, and written to disk in the background.
+    void LabNetwork::checkpoint()
+    {
+        if (_checkpoint_time.elapsed() < CHECKPOINT_MSECS)
+            return;
+
+        _checkpoint_time.start();
+
+        QString fname = checkpointFileName();
+        if (fname.isEmpty())
+            return;
+
+        try
+        {
+            if (!_checkpoint)
+                _checkpoint = new NeuroCheckpoint(fname);
+
+            _checkpoint->take(*_neuronet, _timestep);
+        }
+        catch (Common::Exception & e)
+        {
+            // try again with a new file next time
+            delete _checkpoint; _checkpoint = 0;
+            emit statusChanged(tr("Unable to write checkpoint: %1").arg(e.message()));
+        }
+    }
+
+    /// Stops taking checkpoints and removes the checkpoint file.
+    void LabNetwork::removeCheckpoint()
+    {
+        QStringList fnames;
+        fnames.append(checkpointFileName());
+
+        if (_checkpoint)
+        {
+            fnames.append(_checkpoint->fileName());
+            delete _checkpoint; _checkpoint = 0;
+        }
+
+        foreach (const QString & fname, fnames)
+        {
+            if (!fname.isEmpty())
+            {
+                QFile::remove(fname);
+                QFile::remove(fname + ".new");
+            }
+        }
+
+        _checkpoint_time.start();
+    }
+
     void LabNetwork::cancel()
     {
+        QMutexLocker lock(&_frame_mutex);
         _cancel_step = true;
     }
 
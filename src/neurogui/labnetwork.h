@@ -40,13 +40,17 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "neurogui_global.h"
 #include "neuroitem.h"
 #include "../neurolib/neuronet.h"
+#include "../neurolib/neurocheckpoint.h"
 
 #include <QObject>
 #include <QVariant>
 #include <QFutureWatcher>
 #include <QTime>
+#include <QElapsedTimer>
 #include <QList>
 #include <QMap>
+#include <QMutex>
+#include <QWaitCondition>
 
 class QGraphicsItem;
 class QtVariantProperty;
@@ -81,12 +85,59 @@ namespace NeuroGui
         Property<LabNetwork, QVariant::Double, double, NeuroLib::NeuroCell::Value> _node_forget_property;
         Property<LabNetwork, QVariant::Double, double, NeuroLib::NeuroCell::Value> _learn_time_property;
 
-        quint32 _current_step, _max_steps;
+        quint32 _current_step, _max_steps, _passes_per_step;
         QFutureWatcher<void> _future_watcher;
         QTime _step_time;
 
         bool _cancel_step;
 
+        QFutureWatcher<void> _run_ahead_watcher;
+        QMutex _frame_mutex;          ///< Protects \c _cancel_step and the members below while running ahead.
+        QWaitCondition _frame_shown;  ///< Signals the run-ahead thread that the GUI is done showing a frame.
+        bool _frame_pending;          ///< Whether the run-ahead thread is waiting for the GUI to show a frame.
+        quint32 _run_ahead_steps;     ///< The number of timesteps the run-ahead thread has finished.
+
+        NeuroLib::NeuroCheckpoint *_checkpoint; ///< Writes checkpoints of the network while it steps, for recovery after a crash.
+        QTime _checkpoint_time;                 ///< The time since the last checkpoint.
+        quint64 _timestep;                      ///< The number of timesteps the network has been run since it was loaded.
+
+    public:
+        /// The time spent in a step handler while profiling.
+        struct HandlerTime
+        {
+            qint64 calls;  ///< The number of times the handler was called.
+            qint64 nsecs;  ///< The total wall time spent in the handler.
+
+            HandlerTime() : calls(0), nsecs(0) {}
+        };
+
+        /// Times a step handler from construction to destruction, if the network is profiling.
+        /// Put one at the top of a handler connected to one of the network's step signals.
+        class HandlerTimer
+        {
+            LabNetwork *_network;
+            const char *_name;
+            QElapsedTimer _timer;
+
+        public:
+            HandlerTimer(LabNetwork *network, const char *name)
+                : _network(network && network->profiling() ? network : 0), _name(name)
+            {
+                if (_network)
+                    _timer.start();
+            }
+
+            ~HandlerTimer()
+            {
+                if (_network)
+                    _network->addHandlerTime(QLatin1String(_name), _timer.nsecsElapsed());
+            }
+        };
+
+    private:
+        bool _profiling;
+        QMap<QString, HandlerTime> _handler_times;
+
     public:
         explicit LabNetwork(QWidget *parent = 0);
         virtual ~LabNetwork();
@@ -160,6 +211,24 @@ namespace NeuroGui
 
         void removeWidgetsFrom(QLayout *w);
 
+        /// \return Whether the network times its steps and step handlers.
+        /// \see LabNetwork::setProfiling()
+        bool profiling() const { return _profiling; }
+
+        /// Sets whether the network times its steps (see NeuroLib::NeuroNet::profile()) and the handlers of its step signals
+        /// (see LabNetwork::handlerTimes()).
+        /// \see LabNetwork::profiling()
+        void setProfiling(const bool & profiling);
+
+        /// \return The time spent in each step handler while profiling, by name.
+        const QMap<QString, HandlerTime> & handlerTimes() const { return _handler_times; }
+
+        /// Adds a call of a step handler to its time.  Call only from the GUI thread.
+        void addHandlerTime(const QString & name, const qint64 & nsecs);
+
+        /// Resets the network's step profile and handler times.
+        void clearProfile();
+
     public slots:
         bool save(bool saveAs = false);
         bool close();
@@ -185,6 +254,8 @@ namespace NeuroGui
         void setZoom(int new_zoom);
 
         void futureFinished();
+        void showFrame();
+        void runAheadFinished();
 
         void exportPrint();
         void exportSVG();
@@ -211,6 +282,18 @@ namespace NeuroGui
         void stepIncremented();
         void stepProgressRangeChanged(int minimum, int maximum);
         void stepProgressValueChanged(int value);
+
+    private:
+        void emitPreStep();
+        void emitPostStep();
+
+        bool needsStepSignals() const;
+        void runAhead(int num_steps);
+        void finishStepping();
+
+        QString checkpointFileName() const;
+        void checkpoint();
+        void removeCheckpoint();
     };
 
 } // namespace NeuroGui
@@ -452,7 +452,6 @@ namespace NeuroGui
             _root = _current = n;
 
             n->readBinary(ds, file_version);
-            n->postLoad();
 
             // find current node
             LabTreeNode *cur = find_current(_root, current_id);
@@ -461,4 +460,10 @@ namespace NeuroGui
         }
     }
 
+    void LabTree::postLoad()
+    {
+        if (_root)
+            _root->postLoad();
+    }
+
 } // namespace NeuroGui
@@ -208,7 +208,13 @@ namespace NeuroGui
         void removeWidgetsFrom(QLayout *w);
 
         void writeBinary(QDataStream & ds, const NeuroLabFileVersion & file_version) const;
+
+        /// Reads the scenes and their items.  The items don't refer to the network's automaton until LabTree::postLoad().
         void readBinary(QDataStream & ds, const NeuroLabFileVersion & file_version);
+
+        /// Connects the items read by LabTree::readBinary() to each other and to the network's automaton,
+        /// which must be loaded by then.
+        void postLoad();
     };
 
 } // namespace NeuroGui
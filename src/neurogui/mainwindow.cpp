@@ -48,6 +48,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "labtree.h"
 #include "propertyobj.h"
 #include "labdatafile.h"
+#include "stepprofilewidget.h"
 
 #include <QDir>
 #include <QLibrary>
@@ -56,6 +57,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include <QMessageBox>
 #include <QSpinBox>
 #include <QProgressBar>
+#include <QDockWidget>
 #include <QDesktopServices>
 #include <QUrl>
 
@@ -94,6 +96,8 @@ namespace NeuroGui
           _numStepsSpinBoxAction(0),
           _stepProgressBar(0),
           _breadCrumbBar(0),
+          _stepProfileDockWidget(0),
+          _stepProfileWidget(0),
           _currentNetwork(0),
           _currentDataFile(0),
           _propertyEditor(0),
@@ -182,6 +186,14 @@ namespace NeuroGui
         _ui->menu_Toolbars->addAction(_ui->propertiesDockWidget->toggleViewAction());
         _ui->menu_Toolbars->addAction(_ui->itemsDockWidget->toggleViewAction());
 
+        // step profile
+        _stepProfileDockWidget = new QDockWidget(tr("Step Profile"), this);
+        _stepProfileDockWidget->setObjectName("stepProfileDockWidget");
+        _stepProfileDockWidget->setWidget(_stepProfileWidget = new StepProfileWidget(_stepProfileDockWidget));
+        addDockWidget(Qt::BottomDockWidgetArea, _stepProfileDockWidget);
+        _stepProfileDockWidget->setVisible(false);
+        _ui->menu_Toolbars->addAction(_stepProfileDockWidget->toggleViewAction());
+
         // zoom spinbox
         _zoomSpinBox = new QSpinBox(this);
         _zoomSpinBox->setRange(10, 1000);
@@ -621,8 +633,8 @@ namespace NeuroGui
             return false;
 
         _ui->tabWidget->setTabText(1, tr("Collecting Data"));
-        _ui->dataTableWidget->setToolTip(tr("Nodes with labels will be recorded here."));
-        _currentDataFile = new NeuroGui::LabDataFile(_currentNetwork, _ui->dataTableWidget, this);
+        _ui->dataTableView->setToolTip(tr("Nodes with labels will be recorded here."));
+        _currentDataFile = new NeuroGui::LabDataFile(_currentNetwork, _ui->dataTableView, this);
         emit newDataFileOpened(_currentDataFile);
         return true;
     }
@@ -651,7 +663,6 @@ namespace NeuroGui
             delete _currentDataFile;
             _currentDataFile = 0;
 
-            _ui->dataTableWidget->clearContents();
             _ui->tabWidget->setTabText(1, "");
         }
 
@@ -730,6 +741,7 @@ namespace NeuroGui
             disconnect(_currentNetwork, SIGNAL(stepProgressValueChanged(int)), this, SLOT(setProgressValue(int)));
 
             _currentNetwork->removeWidgetsFrom(_networkLayout);
+            _stepProfileWidget->setNetwork(0);
 
             delete _currentNetwork;
             _currentNetwork = 0;
@@ -760,6 +772,8 @@ namespace NeuroGui
             connect(_currentNetwork, SIGNAL(stepProgressRangeChanged(int,int)), this, SLOT(setProgressRange(int, int)), Qt::UniqueConnection);
             connect(_currentNetwork, SIGNAL(stepProgressValueChanged(int)), this, SLOT(setProgressValue(int)), Qt::UniqueConnection);
 
+            _stepProfileWidget->setNetwork(_currentNetwork);
+
             //
             buildItemList();
         }
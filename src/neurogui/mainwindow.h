@@ -48,6 +48,7 @@ POSSIBILITY OF SUCH DAMAGE.
 
 class QSpinBox;
 class QProgressBar;
+class QDockWidget;
 
 class QtTreePropertyBrowser;
 class QtVariantEditorFactory;
@@ -68,6 +69,7 @@ namespace NeuroGui
     class LabNetwork;
     class LabDataFile;
     class NeuroItem;
+    class StepProfileWidget;
 
     /// The main window class for the NeuroLab application.
     class NEUROGUISHARED_EXPORT MainWindow
@@ -92,6 +94,9 @@ namespace NeuroGui
         QToolBar *_breadCrumbBar;
         QList<LabTreeNode *> _breadCrumbs;
 
+        QDockWidget *_stepProfileDockWidget;
+        StepProfileWidget *_stepProfileWidget; ///< Shows the step profile of the current network.
+
         LabNetwork *_currentNetwork; ///< The current network being viewed/edited.
         LabDataFile *_currentDataFile; ///< The current data file.
 
@@ -77,8 +77,8 @@ namespace NeuroGui
 
     NeuroCell::Value NeuroLinkItem::weight() const
     {
-        const NeuroNet::ASYNC_STATE *cell = getCell(_cellIndices.last());
-        return cell ? cell->current().weight() : 0;
+        NeuroNet::ASYNC_STATE cell;
+        return getCell(_cellIndices.last(), cell) ? cell.current().weight() : 0;
     }
 
     void NeuroLinkItem::setWeight(const NeuroLib::NeuroCell::Value & value)
@@ -193,12 +193,12 @@ namespace NeuroGui
 
         // get output values
         QList<qreal> steps;
+        NeuroNet::ASYNC_STATE cell;
 
         for (int i = 0; i < _cellIndices.size(); ++i)
         {
-            const NeuroNet::ASYNC_STATE *cell = getCell(_cellIndices[i]);
-            if (cell)
-                steps.append(qBound(0.0f, qAbs(cell->current().outputValue()), 1.0f));
+            if (getCell(_cellIndices[i], cell))
+                steps.append(qBound(0.0f, qAbs(cell.current().outputValue()), 1.0f));
         }
 
         if (steps.size() == 1)
@@ -212,8 +212,7 @@ namespace NeuroGui
         }
 
         // get gradient
-        const NeuroNet::ASYNC_STATE *cell = getCell(_cellIndices.last());
-        bool frozen = cell && cell->current().frozen();
+        bool frozen = getCell(_cellIndices.last(), cell) && cell.current().frozen();
 
         QLinearGradient gradient(line.p1(), line.p2());
 
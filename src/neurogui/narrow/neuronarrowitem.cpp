@@ -71,9 +71,9 @@ namespace NeuroGui
     {
         if (_cellIndices.size() > 0)
         {
-            const NeuroNet::ASYNC_STATE *cell = getCell(_cellIndices.last());
-            if (cell)
-                return cell->current().outputValue();
+            NeuroNet::ASYNC_STATE cell;
+            if (getCell(_cellIndices.last(), cell))
+                return cell.current().outputValue();
         }
 
         return 0;
@@ -183,8 +183,8 @@ namespace NeuroGui
 
     NeuroCell::Value NeuroNodeItem::inputs() const
     {
-        const NeuroNet::ASYNC_STATE *cell = _cellIndices.size() > 0 ? getCell(_cellIndices.first()) : 0;
-        return cell ? cell->current().weight() : 0;
+        NeuroNet::ASYNC_STATE cell;
+        return _cellIndices.size() > 0 && getCell(_cellIndices.first(), cell) ? cell.current().weight() : 0;
     }
 
     void NeuroNodeItem::setInputs(const NeuroLib::NeuroCell::Value & inputs)
@@ -198,8 +198,8 @@ namespace NeuroGui
 
     NeuroCell::Value NeuroNodeItem::run() const
     {
-        const NeuroNet::ASYNC_STATE *cell = _cellIndices.size() > 0 ? getCell(_cellIndices.first()) : 0;
-        return cell ? cell->current().run() : 0;
+        NeuroNet::ASYNC_STATE cell;
+        return _cellIndices.size() > 0 && getCell(_cellIndices.first(), cell) ? cell.current().run() : 0;
     }
 
     void NeuroNodeItem::setRun(const NeuroLib::NeuroCell::Value & run)
@@ -264,8 +264,8 @@ namespace NeuroGui
 
     NeuroCell::Step NeuroOscillatorItem::phase() const
     {
-        const NeuroNet::ASYNC_STATE *cell = _cellIndices.size() > 0 ? getCell(_cellIndices.first()) : 0;
-        return cell ? cell->current().phase() : 0;
+        NeuroNet::ASYNC_STATE cell;
+        return _cellIndices.size() > 0 && getCell(_cellIndices.first(), cell) ? cell.current().phase() : 0;
     }
 
     void NeuroOscillatorItem::setPhase(const NeuroLib::NeuroCell::Step & phase)
@@ -280,8 +280,8 @@ namespace NeuroGui
 
     NeuroCell::Step NeuroOscillatorItem::peak() const
     {
-        const NeuroNet::ASYNC_STATE *cell = _cellIndices.size() > 0 ? getCell(_cellIndices.first()) : 0;
-        return cell ? cell->current().peak() : 0;
+        NeuroNet::ASYNC_STATE cell;
+        return _cellIndices.size() > 0 && getCell(_cellIndices.first(), cell) ? cell.current().peak() : 0;
     }
 
     void NeuroOscillatorItem::setPeak(const NeuroLib::NeuroCell::Step & peak)
@@ -296,8 +296,8 @@ namespace NeuroGui
 
     NeuroCell::Step NeuroOscillatorItem::gap() const
     {
-        const NeuroNet::ASYNC_STATE *cell = _cellIndices.size() > 0 ? getCell(_cellIndices.first()) : 0;
-        return cell ? cell->current().gap() : 0;
+        NeuroNet::ASYNC_STATE cell;
+        return _cellIndices.size() > 0 && getCell(_cellIndices.first(), cell) ? cell.current().gap() : 0;
     }
 
     void NeuroOscillatorItem::setGap(const NeuroLib::NeuroCell::Step & gap)
@@ -331,10 +331,10 @@ namespace NeuroGui
         NeuroNarrowItem::addToShape(drawPath, texts);
         drawPath.addEllipse(rect());
 
-        const NeuroNet::ASYNC_STATE *cell = _cellIndices.size() > 0 ? getCell(_cellIndices.first()) : 0;
-        if (cell)
+        NeuroNet::ASYNC_STATE cell;
+        if (_cellIndices.size() > 0 && getCell(_cellIndices.first(), cell))
         {
-            texts.append(TextPathRec(QPointF(-8, 4), QString("%1/%2").arg(cell->current().peak()).arg(cell->current().gap())));
+            texts.append(TextPathRec(QPointF(-8, 4), QString("%1/%2").arg(cell.current().peak()).arg(cell.current().gap())));
         }
     }
 
@@ -19,8 +19,10 @@ SOURCES += mainwindow.cpp \
     filedirtydialog.cpp \
     aboutdialog.cpp \
     labdatafile.cpp \
+    labdatarecorder.cpp \
     labnetwork.cpp \
     labscene.cpp \
+    stepprofilewidget.cpp \
     labview.cpp \
     labtree.cpp \
     propertyobj.cpp \
@@ -46,8 +48,10 @@ HEADERS += neurogui_global.h \
     filedirtydialog.h \
     aboutdialog.h \
     labdatafile.h \
+    labdatarecorder.h \
     labnetwork.h \
     labscene.h \
+    stepprofilewidget.h \
     labview.h \
     labtree.h \
     propertyobj.h \
@@ -165,6 +165,10 @@ namespace NeuroGui
         /// Used to write data values to the data file.
         virtual QString dataValue() const { return QString(); }
 
+        /// Used to record numeric data values to the data file without formatting them.
+        /// \return False if the item's data value is not a number; use NeuroItem::dataValue() instead.
+        virtual bool dataSample(float & value) const { Q_UNUSED(value); return false; }
+
         /// Whether or not the item is bidirectional.
         virtual bool isBidirectional() const { return false; }
 
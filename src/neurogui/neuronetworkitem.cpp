@@ -66,8 +66,8 @@ namespace NeuroGui
     int NeuroNetworkItem::persist() const
     {
         QList<Index> cells = allCells();
-        const NeuroNet::ASYNC_STATE *cell = cells.size() > 0 ? getCell(cells.first()) : 0;
-        return cell ? cell->current().persist() : 1;
+        NeuroNet::ASYNC_STATE cell;
+        return cells.size() > 0 && getCell(cells.first(), cell) ? cell.current().persist() : 1;
     }
 
     void NeuroNetworkItem::setPersist(const int & _p)
@@ -92,8 +92,8 @@ namespace NeuroGui
     bool NeuroNetworkItem::frozen() const
     {
         QList<Index> cells = allCells();
-        const NeuroNet::ASYNC_STATE *cell = cells.size() > 0 ? getCell(cells.first()) : 0;
-        return cell ? cell->current().frozen() : false;
+        NeuroNet::ASYNC_STATE cell;
+        return cells.size() > 0 && getCell(cells.first(), cell) && cell.current().frozen();
     }
 
     void NeuroNetworkItem::setFrozen(const bool & frozen)
@@ -186,6 +186,16 @@ namespace NeuroGui
         return QString::number(val);
     }
 
+    bool NeuroNetworkItem::dataSample(float & value) const
+    {
+        NeuroCell::Value val = outputValue();
+        if (val < NeuroCell::EPSILON)
+            val = 0;
+
+        value = val;
+        return true;
+    }
+
     void NeuroNetworkItem::onDetach(NeuroItem *item)
     {
         removeEdges(item);
@@ -275,12 +285,16 @@ namespace NeuroGui
         }
     }
 
-    const NeuroLib::NeuroNet::ASYNC_STATE *NeuroNetworkItem::getCell(const NeuroLib::NeuroCell::Index & index) const
+    bool NeuroNetworkItem::getCell(const NeuroLib::NeuroCell::Index & index, NeuroLib::NeuroNet::ASYNC_STATE & cell) const
     {
         Q_ASSERT(network());
         Q_ASSERT(network()->neuronet());
 
-        return index != -1 ? &((*network()->neuronet())[index]) : 0;
+        if (index == -1)
+            return false;
+
+        cell = (*network()->neuronet())[index];
+        return true;
     }
 
     NeuroLib::NeuroNet::ASYNC_STATE *NeuroNetworkItem::getCell(const NeuroLib::NeuroCell::Index & index)
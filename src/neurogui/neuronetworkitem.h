@@ -64,6 +64,7 @@ namespace NeuroGui
         virtual ~NeuroNetworkItem();
 
         virtual QString dataValue() const;
+        virtual bool dataSample(float & value) const;
 
         virtual Value outputValue() const = 0;
         virtual void setOutputValue(const Value &) = 0;
@@ -99,8 +100,9 @@ namespace NeuroGui
 
         virtual void setPenProperties(QPen &pen) const;
 
-        /// \return A pointer to the neural network cell's previous and current state.
-        const NeuroLib::NeuroNet::ASYNC_STATE *getCell(const Index & index) const;
+        /// Copies the neural network cell's previous and current state, without changing the network.
+        /// \return Whether the index refers to a cell.
+        bool getCell(const Index & index, NeuroLib::NeuroNet::ASYNC_STATE & cell) const;
 
         /// \return A pointer to the neural network cell's previous and current state.
         NeuroLib::NeuroNet::ASYNC_STATE *getCell(const Index & index);
@@ -0,0 +1,208 @@
+/*
+Neurocognitive Linguistics Lab
+Copyright (c) 2010,2011 Gordon Tisher
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+ - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+ - Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in
+   the documentation and/or other materials provided with the
+   distribution.
+
+ - Neither the name of the Neurocognitive Linguistics Lab nor the
+   names of its contributors may be used to endorse or promote
+   products derived from this software without specific prior
+   written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "stepprofilewidget.h"
+#include "labnetwork.h"
+#include "../neurolib/neuronet.h"
+
+#include <QCheckBox>
+#include <QPushButton>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QFile>
+#include <QTextStream>
+
+namespace NeuroGui
+{
+
+    /// How often the panel updates its display while it is visible.
+    static const int REFRESH_MSECS = 500;
+
+    StepProfileWidget::StepProfileWidget(QWidget *parent)
+        : QWidget(parent),
+          _network(0)
+    {
+        _profileCheckBox = new QCheckBox(tr("Profile Steps"), this);
+        _profileCheckBox->setToolTip(tr("Time the steps of the network and the handlers of its step signals."));
+        _resetButton = new QPushButton(tr("Reset"), this);
+        _exportButton = new QPushButton(tr("Export..."), this);
+
+        _tree = new QTreeWidget(this);
+        _tree->setColumnCount(4);
+        _tree->setHeaderLabels(QStringList() << tr("Name") << tr("Count") << tr("Total (ms)") << tr("Mean (us)"));
+        _tree->setRootIsDecorated(false);
+
+        QHBoxLayout *buttons = new QHBoxLayout();
+        buttons->addWidget(_profileCheckBox);
+        buttons->addStretch();
+        buttons->addWidget(_resetButton);
+        buttons->addWidget(_exportButton);
+
+        QVBoxLayout *layout = new QVBoxLayout(this);
+        layout->addLayout(buttons);
+        layout->addWidget(_tree);
+
+        connect(_profileCheckBox, SIGNAL(toggled(bool)), this, SLOT(profileToggled(bool)));
+        connect(_resetButton, SIGNAL(clicked()), this, SLOT(resetClicked()));
+        connect(_exportButton, SIGNAL(clicked()), this, SLOT(exportClicked()));
+        connect(&_refresh_timer, SIGNAL(timeout()), this, SLOT(refresh()));
+
+        _refresh_timer.start(REFRESH_MSECS);
+    }
+
+    void StepProfileWidget::setNetwork(LabNetwork *network)
+    {
+        _network = network;
+
+        if (_network)
+            _network->setProfiling(_profileCheckBox->isChecked());
+
+        refresh();
+    }
+
+    void StepProfileWidget::profileToggled(bool on)
+    {
+        if (_network)
+            _network->setProfiling(on);
+    }
+
+    void StepProfileWidget::resetClicked()
+    {
+        if (_network)
+            _network->clearProfile();
+
+        refresh();
+    }
+
+    QList<StepProfileWidget::Entry> StepProfileWidget::entries() const
+    {
+        QList<Entry> result;
+        if (!_network || !_network->neuronet())
+            return result;
+
+        const Automata::StepProfile profile = _network->neuronet()->profile();
+
+        const QString steps = tr("Steps");
+        for (int i = 0; i < Automata::StepProfile::NUM_PHASES; ++i)
+        {
+            if (profile.phase_steps[i] > 0)
+                result.append(Entry(steps, tr("Phase %1").arg(i + 1), profile.phase_steps[i], profile.phase_nsecs[i]));
+        }
+        result.append(Entry(steps, tr("Post-update"), profile.post_updates, profile.post_update_nsecs));
+
+        const QString cells = tr("Cells");
+        result.append(Entry(cells, tr("Updated"), profile.cells_updated));
+        result.append(Entry(cells, tr("Stalled (neighbors not ready)"), profile.cells_stalled));
+
+        const QString handlers = tr("Handlers");
+        QMapIterator<QString, LabNetwork::HandlerTime> i(_network->handlerTimes());
+        while (i.hasNext())
+        {
+            i.next();
+            result.append(Entry(handlers, i.key(), i.value().calls, i.value().nsecs));
+        }
+
+        return result;
+    }
+
+    void StepProfileWidget::refresh()
+    {
+        if (!isVisible())
+            return;
+
+        _tree->clear();
+
+        QTreeWidgetItem *section = 0;
+        foreach (const Entry & entry, entries())
+        {
+            if (!section || section->text(0) != entry.section)
+            {
+                section = new QTreeWidgetItem(_tree, QStringList() << entry.section);
+                section->setFirstColumnSpanned(true);
+            }
+
+            QStringList columns;
+            columns << entry.name << QString::number(entry.count);
+            if (entry.nsecs >= 0)
+            {
+                columns << QString::number(entry.nsecs / 1.0e6, 'f', 3);
+                columns << (entry.count > 0 ? QString::number(entry.nsecs / 1.0e3 / entry.count, 'f', 3) : QString());
+            }
+
+            QTreeWidgetItem *item = new QTreeWidgetItem(section, columns);
+            for (int col = 1; col < 4; ++col)
+                item->setTextAlignment(col, Qt::AlignRight);
+        }
+
+        _tree->expandAll();
+    }
+
+    void StepProfileWidget::writeCsv(QTextStream & ts) const
+    {
+        ts << "section,name,count,total_ns,mean_ns\n";
+
+        foreach (const Entry & entry, entries())
+        {
+            ts << entry.section << ",\"" << entry.name << "\"," << entry.count << ',';
+            if (entry.nsecs >= 0)
+                ts << entry.nsecs << ',' << (entry.count > 0 ? entry.nsecs / entry.count : 0);
+            else
+                ts << ',';
+            ts << '\n';
+        }
+    }
+
+    void StepProfileWidget::exportClicked()
+    {
+        QString fname = QFileDialog::getSaveFileName(this, tr("Export Step Profile"), ".", tr("Comma-Separated Value Files (*.csv);;All Files(*)"));
+        if (fname.isNull() || fname.isEmpty())
+            return;
+
+        QFile file(fname);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+        {
+            QMessageBox::critical(this, tr("Unable to export step profile."), tr("Unable to open %1 for writing.").arg(fname));
+            return;
+        }
+
+        QTextStream ts(&file);
+        writeCsv(ts);
+    }
+
+} // namespace NeuroGui
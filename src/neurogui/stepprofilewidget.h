@@ -0,0 +1,109 @@
+#ifndef STEPPROFILEWIDGET_H
+#define STEPPROFILEWIDGET_H
+
+/*
+Neurocognitive Linguistics Lab
+Copyright (c) 2010,2011 Gordon Tisher
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+ - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+ - Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in
+   the documentation and/or other materials provided with the
+   distribution.
+
+ - Neither the name of the Neurocognitive Linguistics Lab nor the
+   names of its contributors may be used to endorse or promote
+   products derived from this software without specific prior
+   written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "neurogui_global.h"
+
+#include <QWidget>
+#include <QList>
+#include <QTimer>
+
+class QCheckBox;
+class QPushButton;
+class QTreeWidget;
+class QTextStream;
+
+namespace NeuroGui
+{
+
+    class LabNetwork;
+
+    /// Shows the step profile of a network: the time spent in each phase of a step and in the post-updates,
+    /// the time spent in the GUI's step handlers, and the cell update and stall counts.
+    /// Lives in a dock widget of the main window.
+    class NEUROGUISHARED_EXPORT StepProfileWidget
+        : public QWidget
+    {
+        Q_OBJECT
+
+        LabNetwork *_network;
+
+        QCheckBox *_profileCheckBox;
+        QPushButton *_resetButton;
+        QPushButton *_exportButton;
+        QTreeWidget *_tree;
+
+        QTimer _refresh_timer;
+
+    public:
+        explicit StepProfileWidget(QWidget *parent = 0);
+
+        /// Sets the network whose profile is shown.  Turns the network's profiling on if the panel's check box is checked.
+        void setNetwork(LabNetwork *network);
+
+        /// Writes the profile as comma-separated values.
+        void writeCsv(QTextStream & ts) const;
+
+    public slots:
+        /// Updates the display from the network's profile.
+        void refresh();
+
+    private slots:
+        void profileToggled(bool on);
+        void resetClicked();
+        void exportClicked();
+
+    private:
+        /// A line of the profile.
+        struct Entry
+        {
+            QString section;
+            QString name;
+            qint64 count;
+            qint64 nsecs;   ///< Negative for plain counters.
+
+            Entry(const QString & section, const QString & name, const qint64 & count, const qint64 & nsecs = -1)
+                : section(section), name(name), count(count), nsecs(nsecs) {}
+        };
+
+        QList<Entry> entries() const;
+    };
+
+} // namespace NeuroGui
+
+#endif // STEPPROFILEWIDGET_H
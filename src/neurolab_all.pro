@@ -1,8 +1,10 @@
 TEMPLATE = subdirs
-SUBDIRS = common automata neurolib thirdparty neurogui neurolab griditems
+SUBDIRS = common automata neurolib thirdparty neurogui neurolab griditems neurorun neurobench
 
 automata.depends = common
 neurolib.depends = common automata
 neurogui.depends = common neurolib thirdparty
 neurolab.depends = common neurogui
 griditems.depends = common neurogui
+neurorun.depends = common automata neurolib
+neurobench.depends = common automata neurolib
@@ -0,0 +1,836 @@
+/*
+Neurocognitive Linguistics Lab
+Copyright (c) 2010,2011 Gordon Tisher
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+ - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+ - Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in
+   the documentation and/or other materials provided with the
+   distribution.
+
+ - Neither the name of the Neurocognitive Linguistics Lab nor the
+   names of its contributors may be used to endorse or promote
+   products derived from this software without specific prior
+   written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "neuroarrays.h"
+#include "neuronet.h"
+
+#include <QtAlgorithms>
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NEUROLIB_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace NeuroLib
+{
+
+    static const quint8 PERSIST_MASK = 0x0f;
+    static const quint8 FROZEN_FLAG = 0x10;
+
+#ifdef NEUROLIB_SSE2
+
+    // The vector kernels do the same operations in the same order as NeuroCell::updateKind(), so the link kernels
+    // give identical results.  The node kernel uses a polynomial approximation of exp() (after Cephes' expf(),
+    // accurate to a few ulps) and computes the slope of the sigmoid in single precision, so its outputs differ
+    // from the scalar ones by up to about 1e-6; the bound documented in neuroarrays.h leaves a margin over that.
+
+    /// qMin(a, b), with the same result as qMin() when either is NaN.
+    static inline __m128 qMinPs(const __m128 & a, const __m128 & b) { return _mm_min_ps(a, b); }
+
+    /// qMax(a, b), with the same result as qMax() when either is NaN.
+    static inline __m128 qMaxPs(const __m128 & a, const __m128 & b) { return _mm_max_ps(b, a); }
+
+    /// qBound(min, val, max).
+    static inline __m128 qBoundPs(const __m128 & min, const __m128 & val, const __m128 & max) { return qMaxPs(min, qMinPs(max, val)); }
+
+    static inline __m128 expPs(__m128 x)
+    {
+        const __m128 one = _mm_set1_ps(1.0f);
+
+        // exp() over- or underflows outside this range; NaNs pass through
+        x = _mm_min_ps(_mm_set1_ps(88.0f), x);
+        x = _mm_max_ps(_mm_set1_ps(-87.0f), x);
+
+        // exp(x) = 2^n * exp(g), with n = round(x / ln(2)) and |g| <= ln(2)/2
+        __m128 fx = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(1.44269504088896341f)), _mm_set1_ps(0.5f));
+        __m128i n = _mm_cvttps_epi32(fx);
+        __m128 tmp = _mm_cvtepi32_ps(n);
+        __m128 mask = _mm_and_ps(_mm_cmpgt_ps(tmp, fx), one);
+        fx = _mm_sub_ps(tmp, mask);
+        n = _mm_cvttps_epi32(fx);
+
+        x = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(0.693359375f)));
+        x = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(-2.12194440e-4f)));
+
+        __m128 z = _mm_mul_ps(x, x);
+        __m128 y = _mm_set1_ps(1.9875691500e-4f);
+        y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.3981999507e-3f));
+        y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(8.3334519073e-3f));
+        y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(4.1665795894e-2f));
+        y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.6666665459e-1f));
+        y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(5.0000001201e-1f));
+        y = _mm_add_ps(_mm_mul_ps(y, z), _mm_add_ps(x, one));
+
+        // 2^n
+        n = _mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(0x7f)), 23);
+        return _mm_mul_ps(y, _mm_castsi128_ps(n));
+    }
+
+    /// The sigmoid of NeuroCell::sigmoid(), with the slope constant hoisted out.
+    static inline __m128 sigmoidPs(const __m128 & threshold, const __m128 & run, const __m128 & input)
+    {
+        static const float SLOPE_BASE = static_cast<float>(6.0 - ::log(1.0 / 0.99 - 1.0));
+
+        const __m128 one = _mm_set1_ps(1.0f);
+        __m128 slope = _mm_div_ps(_mm_set1_ps(SLOPE_BASE), run);
+        __m128 arg = _mm_sub_ps(_mm_set1_ps(6.0f), _mm_mul_ps(slope, _mm_sub_ps(input, _mm_sub_ps(threshold, run))));
+        return _mm_div_ps(one, _mm_add_ps(one, expPs(arg)));
+    }
+
+    /// Runs a vector kernel over a batch, padding the last few cells out to a whole vector.
+    template <typename KERNEL>
+    static void runVectorKernel(const KERNEL & kernel, const NeuroCell::StepParams & params, NeuroCell::Value * const *arrays, const int & num_arrays, const int & num)
+    {
+        const int whole = num & ~3;
+
+        for (int j = 0; j < whole; j += 4)
+            kernel(params, arrays, j);
+
+        if (whole < num)
+        {
+            NeuroCell::Value tail[7][4];
+            NeuroCell::Value *tail_arrays[7];
+
+            for (int a = 0; a < num_arrays; ++a)
+            {
+                tail_arrays[a] = tail[a];
+                for (int j = 0; j < 4; ++j)
+                    tail[a][j] = whole + j < num ? arrays[a][whole + j] : arrays[a][whole];
+            }
+
+            kernel(params, tail_arrays, 0);
+
+            for (int a = 0; a < num_arrays; ++a)
+            {
+                for (int j = whole; j < num; ++j)
+                    arrays[a][j] = tail[a][j - whole];
+            }
+        }
+    }
+
+    /// The vector kernel for nodes; the arrays are those of NeuroArrays::Batch, in order.
+    struct NodeKernel
+    {
+        void operator() (const NeuroCell::StepParams & params, NeuroCell::Value * const *arrays, const int & j) const
+        {
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 one = _mm_set1_ps(1.0f);
+            const __m128 learn_time = _mm_set1_ps(params.learn_time);
+
+            const __m128 input = _mm_loadu_ps(arrays[0] + j);
+            const __m128 inhibit = _mm_loadu_ps(arrays[1] + j);
+            const __m128 prev_output = _mm_loadu_ps(arrays[2] + j);
+            const __m128 prev_average = _mm_loadu_ps(arrays[3] + j);
+            __m128 weight = _mm_loadu_ps(arrays[4] + j);
+            const __m128 run = _mm_loadu_ps(arrays[5] + j);
+            const __m128 persist = _mm_loadu_ps(arrays[6] + j);
+
+            const __m128 inhibit_factor = _mm_sub_ps(one, qBoundPs(zero, inhibit, one));
+            const __m128 avg_threshold = qMinPs(persist, learn_time);
+
+            __m128 next_value = sigmoidPs(weight, run, input);
+
+            __m128 decay_factor = sigmoidPs(_mm_div_ps(avg_threshold, learn_time), next_value, prev_average);
+            const __m128 persists = _mm_cmpgt_ps(persist, one);
+            decay_factor = _mm_or_ps(_mm_and_ps(persists, decay_factor), _mm_andnot_ps(persists, one));
+
+            next_value = qMaxPs(next_value, _mm_mul_ps(prev_output, _mm_sub_ps(one, _mm_mul_ps(decay_factor, _mm_set1_ps(params.decay)))));
+            next_value = _mm_mul_ps(next_value, inhibit_factor);
+
+            // node raising/lowering
+            if (params.node_learn_rate > 0 || params.node_forget_rate > 0)
+            {
+                const __m128 diff = qBoundPs(zero, _mm_sub_ps(next_value, prev_average), one);
+                const __m128 delta = _mm_mul_ps(_mm_set1_ps(params.node_learn_rate),
+                                                _mm_sub_ps(_mm_mul_ps(_mm_mul_ps(diff, diff), diff), _mm_set1_ps(params.node_forget_rate)));
+                const __m128 raised = _mm_add_ps(weight, delta);
+                weight = qBoundPs(zero, raised, raised);
+            }
+
+            const __m128 next_average = _mm_div_ps(_mm_add_ps(next_value, _mm_mul_ps(_mm_sub_ps(learn_time, one), prev_average)), learn_time);
+
+            _mm_storeu_ps(arrays[2] + j, next_value);
+            _mm_storeu_ps(arrays[3] + j, next_average);
+            _mm_storeu_ps(arrays[4] + j, weight);
+        }
+    };
+
+    /// The vector kernel for excitory links.
+    struct ExcitoryLinkKernel
+    {
+        void operator() (const NeuroCell::StepParams & params, NeuroCell::Value * const *arrays, const int & j) const
+        {
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 one = _mm_set1_ps(1.0f);
+            const __m128 learn_time = _mm_set1_ps(params.learn_time);
+
+            const __m128 input = _mm_loadu_ps(arrays[0] + j);
+            const __m128 inhibit = _mm_loadu_ps(arrays[1] + j);
+            const __m128 prev_average = _mm_loadu_ps(arrays[3] + j);
+            const __m128 weight = _mm_loadu_ps(arrays[4] + j);
+
+            const __m128 inhibit_factor = _mm_sub_ps(one, qBoundPs(zero, inhibit, one));
+
+            __m128 next_value = qBoundPs(zero, _mm_mul_ps(input, weight), _mm_set1_ps(1.1f));
+            next_value = _mm_mul_ps(next_value, inhibit_factor);
+
+            const __m128 next_average = _mm_div_ps(_mm_add_ps(next_value, _mm_mul_ps(_mm_sub_ps(learn_time, one), prev_average)), learn_time);
+
+            _mm_storeu_ps(arrays[2] + j, next_value);
+            _mm_storeu_ps(arrays[3] + j, next_average);
+        }
+    };
+
+    /// The vector kernel for inhibitory links.
+    struct InhibitoryLinkKernel
+    {
+        void operator() (const NeuroCell::StepParams & params, NeuroCell::Value * const *arrays, const int & j) const
+        {
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 one = _mm_set1_ps(1.0f);
+            const __m128 learn_time = _mm_set1_ps(params.learn_time);
+
+            const __m128 input = _mm_loadu_ps(arrays[0] + j);
+            const __m128 inhibit = _mm_loadu_ps(arrays[1] + j);
+            const __m128 prev_average = _mm_loadu_ps(arrays[3] + j);
+            const __m128 weight = _mm_loadu_ps(arrays[4] + j);
+
+            const __m128 inhibit_factor = _mm_sub_ps(one, qBoundPs(zero, inhibit, one));
+
+            __m128 next_value = _mm_mul_ps(qBoundPs(zero, input, one), inhibit_factor);
+            next_value = _mm_mul_ps(next_value, weight);
+
+            const __m128 next_average = _mm_div_ps(_mm_add_ps(next_value, _mm_mul_ps(_mm_sub_ps(learn_time, one), prev_average)), learn_time);
+
+            _mm_storeu_ps(arrays[2] + j, next_value);
+            _mm_storeu_ps(arrays[3] + j, next_average);
+        }
+    };
+
+    template <>
+    void NeuroArrays::updateBatch<NeuroCell::NODE>(const NeuroCell::StepParams & params, const Batch & batch, const int & num)
+    {
+        Value * const arrays[7] = { batch.input, batch.inhibit, batch.output, batch.average, batch.weight, batch.run, batch.persist };
+        runVectorKernel(NodeKernel(), params, arrays, 7, num);
+    }
+
+    template <>
+    void NeuroArrays::updateBatch<NeuroCell::EXCITORY_LINK>(const NeuroCell::StepParams & params, const Batch & batch, const int & num)
+    {
+        Value * const arrays[5] = { batch.input, batch.inhibit, batch.output, batch.average, batch.weight };
+        runVectorKernel(ExcitoryLinkKernel(), params, arrays, 5, num);
+    }
+
+    template <>
+    void NeuroArrays::updateBatch<NeuroCell::INHIBITORY_LINK>(const NeuroCell::StepParams & params, const Batch & batch, const int & num)
+    {
+        Value * const arrays[5] = { batch.input, batch.inhibit, batch.output, batch.average, batch.weight };
+        runVectorKernel(InhibitoryLinkKernel(), params, arrays, 5, num);
+    }
+
+#endif // NEUROLIB_SSE2
+
+    NeuroArrays::NeuroArrays()
+        : _order_valid(false), _all_active(true)
+    {
+    }
+
+    void NeuroArrays::resize(const int & num)
+    {
+        for (int b = 0; b < 2; ++b)
+        {
+            _output[b].resize(num);
+            _average[b].resize(num);
+            _weight[b].resize(num);
+        }
+
+        _run.resize(num);
+        _kind.resize(num);
+        _flags.resize(num);
+        _ready.resize(num);
+
+        _order_valid = false;
+        _all_active = true;
+    }
+
+    void NeuroArrays::clear()
+    {
+        resize(0);
+    }
+
+    qint64 NeuroArrays::memoryUsed() const
+    {
+        qint64 bytes = 0;
+
+        for (int b = 0; b < 2; ++b)
+            bytes += static_cast<qint64>(_output[b].capacity() + _average[b].capacity() + _weight[b].capacity()) * sizeof(Value);
+
+        bytes += static_cast<qint64>(_run.capacity()) * sizeof(Value);
+        bytes += static_cast<qint64>(_kind.capacity() + _flags.capacity()) * sizeof(quint8);
+        bytes += static_cast<qint64>(_ready.capacity()) * sizeof(Automata::ReadyState);
+        bytes += static_cast<qint64>(_order.capacity() + _active.capacity() + _pending.capacity() + _woken.capacity()) * sizeof(Index);
+        bytes += static_cast<qint64>(_active_mark.capacity()) * sizeof(quint8);
+
+        return bytes;
+    }
+
+    void NeuroArrays::loadCell(const Index & index, const ASYNC_STATE & state)
+    {
+        // the buffers are laid out like the copies in the state, so they can be copied as they are
+        const NeuroCell & current = state.current();
+
+        _output[0][index] = state.q0._output_value;
+        _output[1][index] = state.q1._output_value;
+        _average[0][index] = state.q0._running_average;
+        _average[1][index] = state.q1._running_average;
+
+        // the unions may hold oscillator steps, so copy the bits rather than the values
+        ::memcpy(&_weight[0][index], &state.q0._weight, sizeof(Value));
+        ::memcpy(&_weight[1][index], &state.q1._weight, sizeof(Value));
+        ::memcpy(&_run[index], &current._run, sizeof(Value));
+
+        if (_kind[index] != static_cast<quint8>(current._kind))
+            _order_valid = false;
+
+        _kind[index] = static_cast<quint8>(current._kind);
+        _flags[index] = static_cast<quint8>((current._persist & PERSIST_MASK) | (current._frozen ? FROZEN_FLAG : 0));
+        _ready[index] = state.r;
+    }
+
+    void NeuroArrays::storeCell(const Index & index, ASYNC_STATE & state) const
+    {
+        state.q0 = cell(index, 0);
+        state.q1 = cell(index, 1);
+        state.r = _ready[index];
+    }
+
+    NeuroCell NeuroArrays::cell(const Index & index, const int & buffer) const
+    {
+        NeuroCell result(static_cast<NeuroCell::KindOfCell>(_kind[index]));
+
+        ::memcpy(&result._weight, &_weight[buffer][index], sizeof(Value));
+        ::memcpy(&result._run, &_run[index], sizeof(Value));
+
+        result._output_value = _output[buffer][index];
+        result._running_average = _average[buffer][index];
+        result._persist = _flags[index] & PERSIST_MASK;
+        result._frozen = (_flags[index] & FROZEN_FLAG) != 0;
+
+        return result;
+    }
+
+    bool NeuroArrays::update(NeuroNet *network, const Index & index)
+    {
+        const int r = _ready[index];
+
+        int num;
+        const Index *neighbor_indices = network->frozenNeighbors(index, num);
+
+        // in the second and third phases, a cell only waits for its neighbors to catch up
+        if (r != 0)
+        {
+            const int waiting = (r + 2) % 3;
+            for (int i = 0; i < num; ++i)
+            {
+                if (_ready[neighbor_indices[i]] == waiting)
+                    return false;
+            }
+
+            // no neighbor reads the cell's values while it is in the third phase
+            if (r == 2)
+            {
+                qSwap(_output[0][index], _output[1][index]);
+                qSwap(_average[0][index], _average[1][index]);
+
+                // the unions may hold oscillator steps, so copy the bits rather than the values
+                Value weight;
+                ::memcpy(&weight, &_weight[0][index], sizeof(Value));
+                ::memcpy(&_weight[0][index], &_weight[1][index], sizeof(Value));
+                ::memcpy(&_weight[1][index], &weight, sizeof(Value));
+
+                _ready[index] = 0;
+            }
+            else
+            {
+                _ready[index] = 2;
+            }
+
+            return true;
+        }
+
+        // get the neighbors' published output values, running averages and weights
+        Value *neighbor_outputs = _temp_values.data(num * 3);
+        Value *neighbor_averages = neighbor_outputs + num;
+        Value *neighbor_weights = neighbor_averages + num;
+
+        Value input_sum = 0, inhibit_sum = 0;
+        for (int i = 0; i < num; ++i)
+        {
+            const Index & n = neighbor_indices[i];
+            if (_ready[n] == 2)
+                return false;
+
+            neighbor_outputs[i] = _output[0][n];
+            neighbor_averages[i] = _average[0][n];
+            neighbor_weights[i] = _weight[0][n];
+
+            if (neighbor_outputs[i] < 0)
+                inhibit_sum += -neighbor_outputs[i];
+            else
+                input_sum += neighbor_outputs[i];
+        }
+
+        // update
+        const NeuroCell prev = cell(index, 0);
+        NeuroCell next = prev;
+
+        Value next_value = prev._output_value;
+        Value next_average = prev._running_average;
+
+        if (!prev._frozen)
+        {
+            next_value = prev.updateValue(network, next, input_sum, inhibit_sum);
+            next_average = next._running_average;
+
+            // hebbian learning (link learning)
+            if (prev._kind == NeuroCell::NODE && network->linkLearnRate() > 0)
+            {
+                for (int i = 0; i < num; ++i)
+                {
+                    const Index & n = neighbor_indices[i];
+
+                    Value new_weight;
+                    if (_kind[n] == NeuroCell::EXCITORY_LINK
+                        && NeuroCell::learnLink(network, neighbor_outputs[i], neighbor_averages[i], neighbor_weights[i], next_value, prev._running_average, new_weight))
+                    {
+                        network->addPostUpdate(NeuroNet::PostUpdateRec(n, new_weight));
+                    }
+                }
+            }
+
+            ::memcpy(&_run[index], &next._run, sizeof(Value));
+        }
+
+        // the next values go in the unpublished buffer; the neighbors keep reading the current ones until the third phase
+        _output[1][index] = next_value;
+        _average[1][index] = next_average;
+        ::memcpy(&_weight[1][index], &next._weight, sizeof(Value));
+        _ready[index] = 1;
+        return true;
+    }
+
+    void NeuroArrays::orderByKind()
+    {
+        if (_order_valid)
+            return;
+
+        const int num = size();
+        const int num_groups = NeuroCell::NUM_KINDS + 1;
+
+        // counting sort; the cells of each kind stay in index order
+        for (int k = 0; k <= num_groups; ++k)
+            _kind_begin[k] = 0;
+        for (int i = 0; i < num; ++i)
+            ++_kind_begin[qMin(static_cast<int>(_kind[i]), num_groups - 1) + 1];
+        for (int k = 0; k < num_groups; ++k)
+            _kind_begin[k + 1] += _kind_begin[k];
+
+        int next[NeuroCell::NUM_KINDS + 1];
+        for (int k = 0; k < num_groups; ++k)
+            next[k] = _kind_begin[k];
+
+        _order.resize(num);
+        for (int i = 0; i < num; ++i)
+            _order[next[qMin(static_cast<int>(_kind[i]), num_groups - 1)]++] = i;
+
+        _order_valid = true;
+    }
+
+    /// \return Whether two values have the same bits; the weights of oscillators hold integers.
+    static inline bool sameBits(const NeuroCell::Value & a, const NeuroCell::Value & b)
+    {
+        return ::memcmp(&a, &b, sizeof(NeuroCell::Value)) == 0;
+    }
+
+    void NeuroArrays::beginActiveStep(NeuroNet *network)
+    {
+        const int num = size();
+
+        if (_all_active)
+        {
+            scheduleAll();
+            return;
+        }
+
+        // after the last step, the current buffers hold the new states of the cells it updated, and the former buffers their old ones;
+        // a cell whose state changed, or that was changed since, must be updated again, along with the cells that read it
+        const int num_active = _active.size();
+        for (int j = 0; j < num_active; ++j)
+        {
+            const Index index = _active[j];
+
+            bool changed = !sameBits(_output[0][index], _output[1][index])
+                    || !sameBits(_average[0][index], _average[1][index])
+                    || !sameBits(_weight[0][index], _weight[1][index]);
+
+            // an oscillator counts its steps
+            if (!changed && _kind[index] == NeuroCell::OSCILLATOR && !(_flags[index] & FROZEN_FLAG))
+                changed = true;
+
+            if (changed)
+                _pending.append(index);
+        }
+
+        // once a good part of the network is busy, working out which cells are not is slower than updating them all
+        if (_pending.size() > num / FULL_STEP_DIVISOR)
+        {
+            scheduleAll();
+            return;
+        }
+
+        if (_active_mark.size() != num)
+            _active_mark.fill(0, num);
+
+        _woken.resize(0);
+
+        foreach (const Index & index, _pending)
+        {
+            wake(index);
+
+            int num_readers;
+            const Index *readers = network->frozenReverseNeighbors(index, num_readers);
+            for (int i = 0; i < num_readers; ++i)
+                wake(readers[i]);
+        }
+
+        _pending.clear();
+
+        // group the cells by kind, keeping them in index order within each kind
+        if (_woken.size() > num / SCAN_DIVISOR)
+        {
+            _woken.resize(0);
+            for (int i = 0; i < num; ++i)
+            {
+                if (_active_mark[i])
+                    _woken.append(i);
+            }
+        }
+        else
+        {
+            qSort(_woken.begin(), _woken.end());
+        }
+
+        const int num_groups = NeuroCell::NUM_KINDS + 1;
+        const int num_woken = _woken.size();
+
+        for (int k = 0; k <= num_groups; ++k)
+            _active_kind_begin[k] = 0;
+        for (int j = 0; j < num_woken; ++j)
+            ++_active_kind_begin[qMin(static_cast<int>(_kind[_woken[j]]), num_groups - 1) + 1];
+        for (int k = 0; k < num_groups; ++k)
+            _active_kind_begin[k + 1] += _active_kind_begin[k];
+
+        int next[NeuroCell::NUM_KINDS + 1];
+        for (int k = 0; k < num_groups; ++k)
+            next[k] = _active_kind_begin[k];
+
+        _active.resize(num_woken);
+        for (int j = 0; j < num_woken; ++j)
+        {
+            const Index index = _woken[j];
+            _active[next[qMin(static_cast<int>(_kind[index]), num_groups - 1)]++] = index;
+            _active_mark[index] = 0;
+        }
+    }
+
+    void NeuroArrays::scheduleAll()
+    {
+        orderByKind();
+        _active = _order;
+        ::memcpy(_active_kind_begin, _kind_begin, sizeof(_kind_begin));
+
+        _pending.clear();
+        _all_active = false;
+    }
+
+    void NeuroArrays::updateSync(NeuroNet *network, const int & begin, const int & end)
+    {
+        updateSyncOrder(network, _order.constData(), _kind_begin, begin, end);
+    }
+
+    void NeuroArrays::updateSyncActive(NeuroNet *network, const int & begin, const int & end)
+    {
+        updateSyncOrder(network, _active.constData(), _active_kind_begin, begin, end);
+    }
+
+    void NeuroArrays::updateSyncOrder(NeuroNet *network, const Index *order, const int *kind_begin, const int & begin, const int & end)
+    {
+        const NeuroCell::StepParams params(network);
+
+        for (int k = 0; k <= NeuroCell::NUM_KINDS; ++k)
+        {
+            const int first = qMax(begin, kind_begin[k]);
+            const int last = qMin(end, kind_begin[k + 1]);
+
+            if (first >= last)
+                continue;
+
+            switch (k)
+            {
+            case NeuroCell::NODE:
+                updateSyncRun<NeuroCell::NODE>(network, params, order + first, order + last);
+                break;
+            case NeuroCell::EXCITORY_LINK:
+                updateSyncRun<NeuroCell::EXCITORY_LINK>(network, params, order + first, order + last);
+                break;
+            case NeuroCell::INHIBITORY_LINK:
+                updateSyncRun<NeuroCell::INHIBITORY_LINK>(network, params, order + first, order + last);
+                break;
+            case NeuroCell::OSCILLATOR:
+                updateSyncRun<NeuroCell::OSCILLATOR>(network, params, order + first, order + last);
+                break;
+            default:
+                updateSyncRun<NeuroCell::NUM_KINDS>(network, params, order + first, order + last);
+                break;
+            }
+        }
+    }
+
+    template <NeuroCell::KindOfCell KIND>
+    void NeuroArrays::updateSyncRun(NeuroNet *network, const NeuroCell::StepParams & params, const Index *first, const Index *last)
+    {
+        if (network->vectorKernels())
+        {
+            updateSyncBatches<KIND>(network, params, first, last);
+            return;
+        }
+
+        // nobody writes the current buffers during a synchronous step, so the neighbors can be read directly
+        const Value *outputs = _output[0].constData();
+        const Value *averages = _average[0].constData();
+        const Value *weights = _weight[0].constData();
+        const quint8 *flags = _flags.constData();
+
+        Value *next_outputs = _output[1].data();
+        Value *next_averages = _average[1].data();
+        Value *next_weights = _weight[1].data();
+        Value *runs = _run.data();
+
+        const bool learn_links = KIND == NeuroCell::NODE && params.link_learn_rate > 0;
+
+        for (const Index *p = first; p != last; ++p)
+        {
+            const Index index = *p;
+
+            // the unions may hold oscillator steps, so copy the bits rather than the values
+            Value weight, run;
+            ::memcpy(&weight, &weights[index], sizeof(Value));
+            ::memcpy(&run, &runs[index], sizeof(Value));
+
+            if (flags[index] & FROZEN_FLAG)
+            {
+                next_outputs[index] = outputs[index];
+                next_averages[index] = averages[index];
+                ::memcpy(&next_weights[index], &weight, sizeof(Value));
+                continue;
+            }
+
+            int num;
+            const Index *neighbor_indices = network->frozenNeighbors(index, num);
+
+            Value input_sum = 0, inhibit_sum = 0;
+            for (int i = 0; i < num; ++i)
+            {
+                const Value & output = outputs[neighbor_indices[i]];
+
+                if (output < 0)
+                    inhibit_sum += -output;
+                else
+                    input_sum += output;
+            }
+
+            Value next_average;
+            const Value next_value = NeuroCell::updateKind<KIND>(params, input_sum, inhibit_sum, outputs[index], averages[index],
+                                                                 flags[index] & PERSIST_MASK, weight, run, next_average);
+
+            // hebbian learning (link learning)
+            if (learn_links)
+            {
+                for (int i = 0; i < num; ++i)
+                {
+                    const Index & n = neighbor_indices[i];
+
+                    Value new_weight;
+                    if (_kind[n] == NeuroCell::EXCITORY_LINK
+                        && NeuroCell::learnLink(network, outputs[n], averages[n], weights[n], next_value, averages[index], new_weight))
+                    {
+                        network->addPostUpdate(NeuroNet::PostUpdateRec(n, new_weight));
+                    }
+                }
+            }
+
+            next_outputs[index] = next_value;
+            next_averages[index] = next_average;
+            ::memcpy(&next_weights[index], &weight, sizeof(Value));
+            ::memcpy(&runs[index], &run, sizeof(Value));
+        }
+    }
+
+    template <NeuroCell::KindOfCell KIND>
+    void NeuroArrays::updateSyncBatches(NeuroNet *network, const NeuroCell::StepParams & params, const Index *first, const Index *last)
+    {
+        const Value *outputs = _output[0].constData();
+        const Value *averages = _average[0].constData();
+        const Value *weights = _weight[0].constData();
+        const quint8 *flags = _flags.constData();
+
+        Value *next_outputs = _output[1].data();
+        Value *next_averages = _average[1].data();
+        Value *next_weights = _weight[1].data();
+        Value *runs = _run.data();
+
+        const bool learn_links = KIND == NeuroCell::NODE && params.link_learn_rate > 0;
+
+        Value *scratch = _temp_values.data(BATCH_SIZE * 7);
+
+        Batch batch;
+        batch.input = scratch;
+        batch.inhibit = batch.input + BATCH_SIZE;
+        batch.output = batch.inhibit + BATCH_SIZE;
+        batch.average = batch.output + BATCH_SIZE;
+        batch.weight = batch.average + BATCH_SIZE;
+        batch.run = batch.weight + BATCH_SIZE;
+        batch.persist = batch.run + BATCH_SIZE;
+
+        for (const Index *begin = first; begin < last; begin += BATCH_SIZE)
+        {
+            int num = static_cast<int>(last - begin);
+            if (num > BATCH_SIZE)
+                num = BATCH_SIZE;
+
+            // gather
+            for (int j = 0; j < num; ++j)
+            {
+                const Index index = begin[j];
+
+                int num_neighbors;
+                const Index *neighbor_indices = network->frozenNeighbors(index, num_neighbors);
+
+                Value input_sum = 0, inhibit_sum = 0;
+                for (int i = 0; i < num_neighbors; ++i)
+                {
+                    const Value & output = outputs[neighbor_indices[i]];
+
+                    if (output < 0)
+                        inhibit_sum += -output;
+                    else
+                        input_sum += output;
+                }
+
+                batch.input[j] = input_sum;
+                batch.inhibit[j] = inhibit_sum;
+                batch.output[j] = outputs[index];
+                batch.average[j] = averages[index];
+                ::memcpy(&batch.weight[j], &weights[index], sizeof(Value));
+                ::memcpy(&batch.run[j], &runs[index], sizeof(Value));
+                batch.persist[j] = static_cast<Value>(flags[index] & PERSIST_MASK);
+            }
+
+            updateBatch<KIND>(params, batch, num);
+
+            // scatter
+            for (int j = 0; j < num; ++j)
+            {
+                const Index index = begin[j];
+
+                if (flags[index] & FROZEN_FLAG)
+                {
+                    next_outputs[index] = outputs[index];
+                    next_averages[index] = averages[index];
+                    ::memcpy(&next_weights[index], &weights[index], sizeof(Value));
+                    continue;
+                }
+
+                // hebbian learning (link learning)
+                if (learn_links)
+                {
+                    int num_neighbors;
+                    const Index *neighbor_indices = network->frozenNeighbors(index, num_neighbors);
+
+                    for (int i = 0; i < num_neighbors; ++i)
+                    {
+                        const Index & n = neighbor_indices[i];
+
+                        Value new_weight;
+                        if (_kind[n] == NeuroCell::EXCITORY_LINK
+                            && NeuroCell::learnLink(network, outputs[n], averages[n], weights[n], batch.output[j], averages[index], new_weight))
+                        {
+                            network->addPostUpdate(NeuroNet::PostUpdateRec(n, new_weight));
+                        }
+                    }
+                }
+
+                next_outputs[index] = batch.output[j];
+                next_averages[index] = batch.average[j];
+                ::memcpy(&next_weights[index], &batch.weight[j], sizeof(Value));
+                ::memcpy(&runs[index], &batch.run[j], sizeof(Value));
+            }
+        }
+    }
+
+    template <NeuroCell::KindOfCell KIND>
+    void NeuroArrays::updateBatch(const NeuroCell::StepParams & params, const Batch & batch, const int & num)
+    {
+        for (int j = 0; j < num; ++j)
+        {
+            const Value output = batch.output[j];
+            const Value average = batch.average[j];
+
+            batch.output[j] = NeuroCell::updateKind<KIND>(params, batch.input[j], batch.inhibit[j], output, average,
+                                                          static_cast<int>(batch.persist[j]), batch.weight[j], batch.run[j], batch.average[j]);
+        }
+    }
+
+    void NeuroArrays::swapBuffers()
+    {
+        qSwap(_output[0], _output[1]);
+        qSwap(_average[0], _average[1]);
+        qSwap(_weight[0], _weight[1]);
+    }
+
+} // namespace NeuroLib
@@ -0,0 +1,229 @@
+#ifndef NEUROARRAYS_H
+#define NEUROARRAYS_H
+
+/*
+Neurocognitive Linguistics Lab
+Copyright (c) 2010,2011 Gordon Tisher
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+ - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+ - Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in
+   the documentation and/or other materials provided with the
+   distribution.
+
+ - Neither the name of the Neurocognitive Linguistics Lab nor the
+   names of its contributors may be used to endorse or promote
+   products derived from this software without specific prior
+   written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "neurolib_global.h"
+#include "neurocell.h"
+
+#include "../automata/pool.h"
+
+#include <QVector>
+
+namespace NeuroLib
+{
+
+    class NeuroNet;
+
+    /// Structure-of-arrays storage for the cells of a NeuroNet.
+    /// Keeps the output values, running averages, weights, kinds and ready states of the cells in separate
+    /// dense arrays, so that the neighbor loop of an update only touches the values it actually reads,
+    /// instead of whole Automata::AsyncState records.
+    /// \see NeuroNet::ARRAY_STORAGE
+    class NEUROLIBSHARED_EXPORT NeuroArrays
+    {
+    public:
+        typedef NeuroCell::Index Index;
+        typedef NeuroCell::Value Value;
+        typedef NeuroCell::NEURONET_BASE::ASYNC_STATE ASYNC_STATE;
+
+        /// Constructor.
+        NeuroArrays();
+
+        /// \return The number of cells in the arrays.
+        int size() const { return _ready.size(); }
+
+        /// Resizes the arrays.  Existing cells keep their values.
+        void resize(const int & num);
+
+        /// Removes all cells.
+        void clear();
+
+        /// \return The number of bytes taken by the arrays.
+        qint64 memoryUsed() const;
+
+        /// Copies the state of a cell into the arrays.
+        void loadCell(const Index & index, const ASYNC_STATE & state);
+
+        /// Copies the state of a cell out of the arrays.  Does not change the cell's index.
+        void storeCell(const Index & index, ASYNC_STATE & state) const;
+
+        /// \return The current output value of a cell.
+        const Value & outputValue(const Index & index) const { return _output[currentBuffer(index)][index]; }
+
+        /// \return The current running average of a cell.
+        const Value & runningAverage(const Index & index) const { return _average[currentBuffer(index)][index]; }
+
+        /// \return The ready state of a cell.
+        /// \see Automata::Automaton::readyState()
+        int readyState(const Index & index) const { return _ready[index]; }
+
+        /// \return The current weight of a cell.
+        const Value & weight(const Index & index) const { return _weight[currentBuffer(index)][index]; }
+
+        /// Sets the current weight of a cell.  Used for the post-updates of Hebbian learning.
+        void setWeight(const Index & index, const Value & weight) { _weight[currentBuffer(index)][index] = weight; }
+
+        /// Implements the asynchronous three-phase update of a cell, as Automata::Automaton::update() does for cells in an Automata::AsyncState.
+        /// Neighbors only read a cell's values in buffer 0, which the cell does not write until its third phase.
+        /// \return Whether the cell advanced; if not, one of its neighbors was not ready.
+        /// \note The edges of the network must be frozen.
+        bool update(NeuroNet *network, const Index & index);
+
+        /// Groups the cells by kind, for NeuroArrays::updateSync().  Does nothing unless cells have been
+        /// added or have changed kind since the last call.  Must not be called while a step is in progress.
+        void orderByKind();
+
+        /// Implements the synchronous update of a range of cells: reads the current values of the cells and their neighbors,
+        /// and writes the cells' next values into the former buffers, which become current after NeuroArrays::swapBuffers().
+        /// The range is of positions in the order set up by NeuroArrays::orderByKind(), so that it is made of runs of cells
+        /// of the same kind, each of which is updated by a kernel specialised for that kind.
+        /// Does not use or change the cells' ready states.
+        /// \note The edges of the network must be frozen.
+        void updateSync(NeuroNet *network, const int & begin, const int & end);
+
+        /// Exchanges the current and former buffers, at the end of a synchronous step.
+        void swapBuffers();
+
+        /// Schedules every cell for the next active-set step, e.g. because the network's parameters or edges have changed.
+        void activateAll() { _all_active = true; }
+
+        /// Notes that a cell was changed between steps, so that the next active-set step updates it and the cells that read it.
+        void activate(const Index & index) { if (!_all_active) _pending.append(index); }
+
+        /// Works out which cells the next active-set step must update: those that changed in the last step or since,
+        /// and those that read them (found through NeuroNet::frozenReverseNeighbors()).  A cell whose state and inputs
+        /// did not change would only compute the same state again, so skipping the others gives exactly the same results
+        /// as NeuroArrays::updateSync() over all the cells.  The cells are grouped by kind, as by NeuroArrays::orderByKind().
+        /// \note The network's reverse edges must be frozen, unless NeuroArrays::activateAll() has been called.
+        void beginActiveStep(NeuroNet *network);
+
+        /// \return The number of cells scheduled by the last call to NeuroArrays::beginActiveStep().
+        int numActive() const { return _active.size(); }
+
+        /// Like NeuroArrays::updateSync(), but the range is of positions in the list of cells scheduled by NeuroArrays::beginActiveStep().
+        void updateSyncActive(NeuroNet *network, const int & begin, const int & end);
+
+    private:
+        /// Builds a cell from the arrays.
+        /// \param buffer 0 for the current state, 1 for the former state.
+        NeuroCell cell(const Index & index, const int & buffer) const;
+
+        /// Updates the cells at a range of positions in a list grouped by kind.
+        /// \param kind_begin The position in \c order of the first cell of each kind.
+        void updateSyncOrder(NeuroNet *network, const Index *order, const int *kind_begin, const int & begin, const int & end);
+
+        /// If more than this fraction of the cells changed in a step, the next active-set step updates all the cells.
+        static const int FULL_STEP_DIVISOR = 2;
+
+        /// If more than this fraction of the cells are to be updated, they are put in order by scanning all the cells rather than by sorting.
+        static const int SCAN_DIVISOR = 16;
+
+        /// Schedules all the cells for the next active-set step.
+        void scheduleAll();
+
+        /// Adds a cell to the list of cells that will be updated by the next active-set step, if it is not there already.
+        void wake(const Index & index)
+        {
+            if (!_active_mark[index])
+            {
+                _active_mark[index] = 1;
+                _woken.append(index);
+            }
+        }
+
+        /// Updates a run of cells of the same kind synchronously.
+        template <NeuroCell::KindOfCell KIND>
+        void updateSyncRun(NeuroNet *network, const NeuroCell::StepParams & params, const Index *first, const Index *last);
+
+        /// The number of cells gathered into a NeuroArrays::Batch at a time.
+        static const int BATCH_SIZE = 256;
+
+        /// A batch of cells of the same kind, gathered into contiguous arrays for NeuroArrays::updateBatch().
+        struct Batch
+        {
+            Value *input;   ///< The sums of the cells' excitatory inputs.
+            Value *inhibit; ///< The sums of the cells' inhibitory inputs.
+            Value *output;  ///< The cells' output values; set to their next output values.
+            Value *average; ///< The cells' running averages; set to their next running averages.
+            Value *weight;  ///< The cells' weights; set to their next weights.
+            Value *run;     ///< The cells' runs; set to their next runs.
+            Value *persist; ///< The cells' persistence.
+        };
+
+        /// Updates a run of cells of the same kind synchronously, a batch at a time, using NeuroArrays::updateBatch().
+        template <NeuroCell::KindOfCell KIND>
+        void updateSyncBatches(NeuroNet *network, const NeuroCell::StepParams & params, const Index *first, const Index *last);
+
+        /// The batch update kernel for one kind of cell.  Where SSE2 is available the kernels for nodes and links
+        /// are vectorised; they give the same results as NeuroCell::updateKind(), except that in each step node outputs
+        /// (and the running averages and thresholds that depend on them) may differ by up to 2e-6.
+        /// <tt>neurolab-bench --check-vector</tt> checks this bound, and fails if it is exceeded.
+        /// SSE2 is the deliberate baseline: every x86-64 CPU has it, so it needs neither runtime dispatch nor
+        /// per-file compiler flags in the qmake projects, and batches are too short for wider vectors to pay off.
+        template <NeuroCell::KindOfCell KIND>
+        static void updateBatch(const NeuroCell::StepParams & params, const Batch & batch, const int & num);
+
+        /// \return The buffer that holds a cell's current values: 1 in the middle of the cell's timestep, when its next values are there, and 0 otherwise.
+        /// \see Automata::AsyncState
+        int currentBuffer(const Index & index) const { return _ready[index] == 0 ? 0 : 1; }
+
+        QVector<Value> _output[2];  ///< Output values; laid out like Automata::AsyncState::q0 and Automata::AsyncState::q1.
+        QVector<Value> _average[2]; ///< Running averages; laid out like the output values.
+        QVector<Value> _weight[2];  ///< Weights of links and thresholds of nodes; gap and peak for oscillators.  Laid out like the output values.
+        QVector<Value> _run;        ///< Sigmoid runs of nodes; phase and step for oscillators.
+        QVector<quint8> _kind;      ///< Kinds of cell.
+        QVector<quint8> _flags;     ///< Persistence in the low four bits; frozen flag above.
+        QVector<Automata::ReadyState> _ready; ///< Ready states for the asynchronous update.
+
+        QVector<Index> _order;                         ///< The indices of the cells, grouped by kind; unknown kinds come last.
+        int _kind_begin[NeuroCell::NUM_KINDS + 2];     ///< The position in \c _order of the first cell of each kind.
+        bool _order_valid;
+
+        QVector<Index> _active;                        ///< The cells to update in an active-set step, grouped by kind.
+        int _active_kind_begin[NeuroCell::NUM_KINDS + 2]; ///< The position in \c _active of the first cell of each kind.
+        bool _all_active;                              ///< Whether the next active-set step must update every cell.
+        QVector<Index> _pending;                       ///< Cells changed since the last step.
+        QVector<Index> _woken;                         ///< Scratch list for NeuroArrays::beginActiveStep().
+        QVector<quint8> _active_mark;                  ///< Set for the cells in \c _woken.
+
+        Automata::ThreadScratch<Value> _temp_values;
+    }; // class NeuroArrays
+
+} // namespace NeuroLib
+
+#endif // NEUROARRAYS_H
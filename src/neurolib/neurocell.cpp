@@ -36,7 +36,8 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #include "neurocell.h"
 #include "neuronet.h"
-#include <cmath>
+
+#include <QtEndian>
 
 namespace NeuroLib
 {
@@ -67,23 +68,15 @@ namespace NeuroLib
 
     static const NeuroCell::Value ZERO = static_cast<NeuroCell::Value>(0);
     static const NeuroCell::Value ONE = static_cast<NeuroCell::Value>(1.0f);
-    static const NeuroCell::Value SLOPE_Y = static_cast<NeuroCell::Value>(0.99f);
-    static const NeuroCell::Value SLOPE_OFFSET = static_cast<NeuroCell::Value>(6.0f);
     static const NeuroCell::Value MAX_LINK = static_cast<NeuroCell::Value>(1.1f);
 
-    static NeuroCell::Value sigmoid(const NeuroCell::Value & threshold, const NeuroCell::Value & run, const NeuroCell::Value & input)
-    {
-        NeuroCell::Value slope = (SLOPE_OFFSET - ::log(ONE/SLOPE_Y - ONE)) / run;
-        NeuroCell::Value output = ONE / (ONE + ::exp(SLOPE_OFFSET - slope * (input - (threshold - run))));
-        return output;
-    }
-
 
     void NeuroCell::update(NEURONET_BASE *neuronet, const Index &, NeuroCell & next,
-                           const QVector<int> & neighbor_indices, const NeuroCell *const neighbors) const
+                           const Index *neighbor_indices, const int & num_neighbors, const NeuroCell *const neighbors) const
     {
         const NeuroCell & prev = *this;
-        NeuroNet *network = dynamic_cast<NeuroNet *>(neuronet);
+        // the only automaton of cells is a network
+        NeuroNet *network = static_cast<NeuroNet *>(neuronet);
 
         next._frozen = prev._frozen;
 
@@ -94,7 +87,7 @@ namespace NeuroLib
         }
 
         Value input_sum = 0, inhibit_sum = 0;
-        for (int i = 0; i < neighbor_indices.size(); ++i)
+        for (int i = 0; i < num_neighbors; ++i)
         {
             if (neighbors[i]._output_value < ZERO)
             {
@@ -106,107 +99,79 @@ namespace NeuroLib
             }
         }
 
-        Value inhibit_factor = ONE - qBound(ZERO, inhibit_sum, ONE);
+        Value next_value = prev.updateValue(network, next, input_sum, inhibit_sum);
 
-        Value next_value = 0;
-        Value diff, delta;
-        int num_neighbors;
-
-        Value avg_threshold = qMin((Value)prev._persist, network->learnTime());
-
-        switch (prev._kind)
+        // hebbian learning (link learning)
+        if (prev._kind == NODE && network->linkLearnRate() > 0)
         {
-        case NODE:
+            for (int i = 0; i < num_neighbors; ++i)
             {
-                // node output
-                next_value = sigmoid(prev._weight, prev._run, input_sum);
-                Value decay_factor = prev._persist > 1 ? sigmoid(avg_threshold / network->learnTime(), next_value, prev._running_average) : 1;
+                const NeuroCell *incoming = &neighbors[i];
 
-                next_value = qMax(next_value, prev._output_value * (ONE - decay_factor * network->decay()));
-                next_value *= inhibit_factor;
-
-                // hebbian learning (link learning)
-                if (network->linkLearnRate() > 0)
-                {
-                    num_neighbors = neighbor_indices.size();
-                    for (int i = 0; i < num_neighbors; ++i)
-                    {
-                        const NeuroCell *incoming = &neighbors[i];
-
-                        if (incoming->_kind == EXCITORY_LINK)
-                        {
-                            Value delta_weight = network->linkLearnRate()
-                                                 * (incoming->_output_value - incoming->_running_average) * (next_value - prev._running_average);
-
-                            if (qAbs(delta_weight) > EPSILON)
-                            {
-                                Value new_weight = qBound(ZERO, incoming->_weight + delta_weight, MAX_LINK);
-                                network->addPostUpdate(NeuroNet::PostUpdateRec(neighbor_indices[i], new_weight));
-                            }
-                        }
-                    }
-                }
-
-                // node raising/lowering
-                if (network->nodeLearnRate() > 0 || network->nodeForgetRate() > 0)
+                Value new_weight;
+                if (incoming->_kind == EXCITORY_LINK
+                    && learnLink(network, incoming->_output_value, incoming->_running_average, incoming->_weight, next_value, prev._running_average, new_weight))
                 {
-                    diff = qBound(ZERO, next_value - prev._running_average, ONE);
-                    delta = network->nodeLearnRate() * (diff * diff * diff - network->nodeForgetRate());
-                    next._weight = qBound(ZERO, next._weight + delta, next._weight + delta);
+                    network->addPostUpdate(NeuroNet::PostUpdateRec(neighbor_indices[i], new_weight));
                 }
             }
+        }
+    }
 
-            break;
-        case OSCILLATOR:
-            {
-                Step phase = prev._phase_step[0];
-                Step step = prev._phase_step[1];
+    bool NeuroCell::learnLink(const NeuroNet *network, const Value & link_output, const Value & link_average, const Value & link_weight,
+                              const Value & next_value, const Value & prev_average, Value & new_weight)
+    {
+        Value delta_weight = network->linkLearnRate() * (link_output - link_average) * (next_value - prev_average);
 
-                Step gap = prev._gap_peak[0];
-                Step peak = prev._gap_peak[1];
+        if (qAbs(delta_weight) > EPSILON)
+        {
+            new_weight = qBound(ZERO, link_weight + delta_weight, MAX_LINK);
+            return true;
+        }
 
-                // increment step
-                Step max = static_cast<Step>(-1);
-                while ((max - (step+1)) < phase)
-                    step += gap + peak; // make step overflow, and inc it beyond phase, so it doesn't pause
-                step += 1;
+        return false;
+    }
 
-                if (step >= phase)
-                {
-                    // calculate next output
-                    if ((gap+peak > 0) && ((phase+step) % (gap+peak)) < peak)
-                        next_value = ONE;
-                    else
-                        next_value = ZERO;
-                }
-                else
-                {
-                    next_value = ZERO;
-                }
+    NeuroCell::StepParams::StepParams(const NeuroNet *network)
+        : decay(network->decay()),
+        link_learn_rate(network->linkLearnRate()),
+        node_learn_rate(network->nodeLearnRate()),
+        node_forget_rate(network->nodeForgetRate()),
+        learn_time(network->learnTime())
+    {
+    }
 
-                next_value *= inhibit_factor;
+    NeuroCell::Value NeuroCell::updateValue(const NeuroNet *network, NeuroCell & next, const Value & input_sum, const Value & inhibit_sum) const
+    {
+        const NeuroCell & prev = *this;
+        const StepParams params(network);
 
-                // save new step value
-                next._phase_step[1] = step;
-            }
+        Value next_value = 0;
+        next._weight = prev._weight;
+        next._run = prev._run;
 
+        switch (prev._kind)
+        {
+        case NODE:
+            next_value = updateKind<NODE>(params, input_sum, inhibit_sum, prev._output_value, prev._running_average, prev._persist, next._weight, next._run, next._running_average);
             break;
         case EXCITORY_LINK:
-            // we allow the weight to be 1.1 so as to maintain activation
-            next_value = qBound(ZERO, input_sum * prev._weight, MAX_LINK);
-            next_value *= inhibit_factor;
+            next_value = updateKind<EXCITORY_LINK>(params, input_sum, inhibit_sum, prev._output_value, prev._running_average, prev._persist, next._weight, next._run, next._running_average);
             break;
         case INHIBITORY_LINK:
-            // the weight should be negative, so only clip the inputs
-            next_value = qBound(ZERO, input_sum, ONE) * inhibit_factor;
-            next_value *= prev._weight;
+            next_value = updateKind<INHIBITORY_LINK>(params, input_sum, inhibit_sum, prev._output_value, prev._running_average, prev._persist, next._weight, next._run, next._running_average);
+            break;
+        case OSCILLATOR:
+            next_value = updateKind<OSCILLATOR>(params, input_sum, inhibit_sum, prev._output_value, prev._running_average, prev._persist, next._weight, next._run, next._running_average);
             break;
         default:
+            next._running_average = (next_value + (params.learn_time - ONE)*prev._running_average) / params.learn_time;
             break;
         }
 
         next._output_value = next_value;
-        next._running_average = (next._output_value + (network->learnTime() - ONE)*prev._running_average) / network->learnTime();
+
+        return next_value;
     }
 
     void NeuroCell::writeBinary(QDataStream & ds, const Automata::AutomataFileVersion &) const
@@ -237,6 +202,71 @@ namespace NeuroLib
         ds << static_cast<float>(_running_average);
     }
 
+    static inline void writeFloat(uchar *dst, const NeuroCell::Value & value)
+    {
+        float f = static_cast<float>(value);
+        quint32 bits;
+        ::memcpy(&bits, &f, sizeof(bits));
+        qToLittleEndian<quint32>(bits, dst);
+    }
+
+    static inline NeuroCell::Value readFloat(const uchar *src)
+    {
+        quint32 bits = qFromLittleEndian<quint32>(src);
+        float f;
+        ::memcpy(&f, &bits, sizeof(f));
+        return static_cast<NeuroCell::Value>(f);
+    }
+
+    void NeuroCell::writeRecord(uchar *record) const
+    {
+        record[0] = static_cast<uchar>(_kind);
+        record[1] = _frozen ? 1 : 0;
+        record[2] = static_cast<uchar>(_persist);
+        record[3] = 0;
+
+        switch (_kind)
+        {
+        case NeuroCell::OSCILLATOR:
+            qToLittleEndian<quint16>(_gap_peak[0], record + 4);
+            qToLittleEndian<quint16>(_gap_peak[1], record + 6);
+            qToLittleEndian<quint16>(_phase_step[0], record + 8);
+            qToLittleEndian<quint16>(_phase_step[1], record + 10);
+            break;
+        default:
+            writeFloat(record + 4, _weight);
+            writeFloat(record + 8, _run);
+            break;
+        }
+
+        writeFloat(record + 12, _output_value);
+        writeFloat(record + 16, _running_average);
+    }
+
+    void NeuroCell::readRecord(const uchar *record)
+    {
+        _kind = static_cast<NeuroCell::KindOfCell>(record[0]);
+        _frozen = record[1] != 0;
+        _persist = record[2];
+
+        switch (_kind)
+        {
+        case NeuroCell::OSCILLATOR:
+            _gap_peak[0] = qFromLittleEndian<quint16>(record + 4);
+            _gap_peak[1] = qFromLittleEndian<quint16>(record + 6);
+            _phase_step[0] = qFromLittleEndian<quint16>(record + 8);
+            _phase_step[1] = qFromLittleEndian<quint16>(record + 10);
+            break;
+        default:
+            _weight = readFloat(record + 4);
+            _run = readFloat(record + 8);
+            break;
+        }
+
+        _output_value = readFloat(record + 12);
+        _running_average = readFloat(record + 16);
+    }
+
     void NeuroCell::readBinary(QDataStream & ds, const Automata::AutomataFileVersion & file_version)
     {
         // if (file_version.client_version >= NeuroLib::NEUROLIB_FILE_VERSION_OLD)
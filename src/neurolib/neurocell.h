@@ -43,10 +43,14 @@ POSSIBILITY OF SUCH DAMAGE.
 #include <QSet>
 #include <QDataStream>
 
+#include <cmath>
+#include <cstring>
+
 namespace NeuroLib
 {
 
     class NeuroNet;
+    class NeuroArrays;
 
     /// Base class for elements of the neurocognitive network (nodes or links).
     /// CANNOT be polymorphic, since the map algo takes an array of these...
@@ -161,17 +165,64 @@ namespace NeuroLib
         /// Removes an input from the cell.
         void removeInput(NeuroNet *network, const Index & my_index, const Index & input_index);
 
+        /// The parameters of the network that the update kernels use, read once per run of cells instead of once per cell.
+        struct StepParams
+        {
+            Value decay;
+            Value link_learn_rate;
+            Value node_learn_rate;
+            Value node_forget_rate;
+            Value learn_time;
+
+            explicit StepParams(const NeuroNet *network);
+        };
+
         /// Update function.
         void update(NEURONET_BASE *neuronet, const Index & index, NeuroCell & next,
-                    const QVector<int> & neighbor_indices, const NeuroCell * const neighbors) const;
+                    const Index *neighbor_indices, const int & num_neighbors, const NeuroCell * const neighbors) const;
 
         /// Write to a data stream.
         void writeBinary(QDataStream & ds, const Automata::AutomataFileVersion & file_version) const;
 
+        /// The size in bytes of the record written by NeuroCell::writeRecord().
+        static const int RECORD_SIZE = 20;
+
+        /// Writes the cell as a fixed-width, little-endian record, for Automata::AUTOMATA_FILE_VERSION_4.
+        void writeRecord(uchar *record) const;
+
+        /// Reads the cell from a record written by NeuroCell::writeRecord().
+        void readRecord(const uchar *record);
+
         /// Read from a data stream.
         void readBinary(QDataStream & ds, const Automata::AutomataFileVersion & file_version);
 
     private:
+        friend class NeuroArrays;
+
+        /// Computes the next output value, running average and kind-specific state of a cell that is not frozen,
+        /// given the sums of its excitatory and inhibitory inputs.  Shared by all the storage modes of NeuroNet.
+        /// \return The next output value of the cell.
+        Value updateValue(const NeuroNet *network, NeuroCell & next, const Value & input_sum, const Value & inhibit_sum) const;
+
+        /// The update kernel for one kind of cell.  Computes the same values as NeuroCell::updateValue(),
+        /// but from and into plain values, so that NeuroArrays can run it over a run of cells of the same kind
+        /// without branching on the kind of each one.
+        /// \param weight The cell's weight (or gap and peak); set to its next value.
+        /// \param run The cell's run (or phase and step); set to its next value.
+        /// \param average Set to the cell's next running average.
+        /// \return The next output value of the cell.
+        template <KindOfCell KIND>
+        static Value updateKind(const StepParams & params, const Value & input_sum, const Value & inhibit_sum,
+                                const Value & prev_output, const Value & prev_average, const int & persist,
+                                Value & weight, Value & run, Value & average);
+
+        static Value sigmoid(const Value & threshold, const Value & run, const Value & input);
+
+        /// Computes the Hebbian learning for an excitory link that is an input to a node.
+        /// \return True if the link's weight should change, in which case \c new_weight is set.
+        static bool learnLink(const NeuroNet *network, const Value & link_output, const Value & link_average, const Value & link_weight,
+                              const Value & next_value, const Value & prev_average, Value & new_weight);
+
         union
         {
             Value _weight; ///< Used in links for their weight; in nodes for their input thresholds.
@@ -193,6 +244,105 @@ namespace NeuroLib
         bool       _frozen  : 1; ///< Whether or not the cell is frozen.
     }; // class NeuroCell
 
+    inline NeuroCell::Value NeuroCell::sigmoid(const Value & threshold, const Value & run, const Value & input)
+    {
+        const Value ONE = static_cast<Value>(1.0f);
+        const Value SLOPE_Y = static_cast<Value>(0.99f);
+        const Value SLOPE_OFFSET = static_cast<Value>(6.0f);
+
+        Value slope = (SLOPE_OFFSET - ::log(ONE/SLOPE_Y - ONE)) / run;
+        Value output = ONE / (ONE + ::exp(SLOPE_OFFSET - slope * (input - (threshold - run))));
+        return output;
+    }
+
+    template <NeuroCell::KindOfCell KIND>
+    inline NeuroCell::Value NeuroCell::updateKind(const StepParams & params, const Value & input_sum, const Value & inhibit_sum,
+                                                  const Value & prev_output, const Value & prev_average, const int & persist,
+                                                  Value & weight, Value & run, Value & average)
+    {
+        const Value ZERO = static_cast<Value>(0);
+        const Value ONE = static_cast<Value>(1.0f);
+        const Value MAX_LINK = static_cast<Value>(1.1f);
+
+        Value inhibit_factor = ONE - qBound(ZERO, inhibit_sum, ONE);
+        Value next_value = 0;
+
+        // KIND is a constant, so the compiler drops all but one of these branches
+        if (KIND == NODE)
+        {
+            // node output
+            Value avg_threshold = qMin((Value)persist, params.learn_time);
+
+            next_value = sigmoid(weight, run, input_sum);
+            Value decay_factor = persist > 1 ? sigmoid(avg_threshold / params.learn_time, next_value, prev_average) : 1;
+
+            next_value = qMax(next_value, prev_output * (ONE - decay_factor * params.decay));
+            next_value *= inhibit_factor;
+
+            // node raising/lowering
+            if (params.node_learn_rate > 0 || params.node_forget_rate > 0)
+            {
+                Value diff = qBound(ZERO, next_value - prev_average, ONE);
+                Value delta = params.node_learn_rate * (diff * diff * diff - params.node_forget_rate);
+                weight = qBound(ZERO, weight + delta, weight + delta);
+            }
+        }
+        else if (KIND == OSCILLATOR)
+        {
+            // the weight holds the gap and peak, the run the phase and step
+            Step gap_peak[2], phase_step[2];
+            ::memcpy(gap_peak, &weight, sizeof(Value));
+            ::memcpy(phase_step, &run, sizeof(Value));
+
+            Step phase = phase_step[0];
+            Step step = phase_step[1];
+
+            Step gap = gap_peak[0];
+            Step peak = gap_peak[1];
+
+            // increment step
+            Step max = static_cast<Step>(-1);
+            while ((max - (step+1)) < phase)
+                step += gap + peak; // make step overflow, and inc it beyond phase, so it doesn't pause
+            step += 1;
+
+            if (step >= phase)
+            {
+                // calculate next output
+                if ((gap+peak > 0) && ((phase+step) % (gap+peak)) < peak)
+                    next_value = ONE;
+                else
+                    next_value = ZERO;
+            }
+            else
+            {
+                next_value = ZERO;
+            }
+
+            next_value *= inhibit_factor;
+
+            // save new step value
+            phase_step[1] = step;
+            ::memcpy(&run, phase_step, sizeof(Value));
+        }
+        else if (KIND == EXCITORY_LINK)
+        {
+            // we allow the weight to be 1.1 so as to maintain activation
+            next_value = qBound(ZERO, input_sum * weight, MAX_LINK);
+            next_value *= inhibit_factor;
+        }
+        else if (KIND == INHIBITORY_LINK)
+        {
+            // the weight should be negative, so only clip the inputs
+            next_value = qBound(ZERO, input_sum, ONE) * inhibit_factor;
+            next_value *= weight;
+        }
+
+        average = (next_value + (params.learn_time - ONE)*prev_average) / params.learn_time;
+
+        return next_value;
+    }
+
 } // namespace NeuroLib
 
 #endif // NEURONODE_H
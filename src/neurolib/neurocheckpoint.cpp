@@ -0,0 +1,348 @@
+/*
+Neurocognitive Linguistics Lab
+Copyright (c) 2010,2011 Gordon Tisher
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+ - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+ - Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in
+   the documentation and/or other materials provided with the
+   distribution.
+
+ - Neither the name of the Neurocognitive Linguistics Lab nor the
+   names of its contributors may be used to endorse or promote
+   products derived from this software without specific prior
+   written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "neurocheckpoint.h"
+#include "neuronet.h"
+
+#include <QDataStream>
+#include <QtConcurrentRun>
+
+#include <cstring>
+
+namespace NeuroLib
+{
+
+    /// Magic cookie for checkpoint files.
+    static const QString CHECKPOINT_COOKIE("NeuroLib CHECKPOINT");
+
+    static const quint16 CHECKPOINT_FILE_VERSION = 1;
+
+    static const quint8 FULL_FRAME = 0;   ///< A checkpoint holding every cell.
+    static const quint8 DELTA_FRAME = 1;  ///< A checkpoint holding the cells changed since the one before.
+
+    static const int NUM_PARAMS = 5;
+
+    NeuroCheckpoint::NeuroCheckpoint(const QString & fname)
+        : _fname(fname), _num_since_full(0), _timestep(0)
+    {
+        for (int i = 0; i < NUM_PARAMS; ++i)
+            _params[i] = 0;
+    }
+
+    NeuroCheckpoint::~NeuroCheckpoint()
+    {
+        try
+        {
+            waitForFinished();
+        }
+        catch (...)
+        {
+        }
+    }
+
+    void NeuroCheckpoint::take(const NeuroNet & network, const quint64 & timestep)
+    {
+        waitForFinished();
+
+        const int num = network.size();
+        _records.resize(num * NeuroNet::CELL_RECORD_SIZE);
+        network.writeCellRecords(reinterpret_cast<uchar *>(_records.data()), 0, num);
+
+        _timestep = timestep;
+        _params[0] = network.decay();
+        _params[1] = network.linkLearnRate();
+        _params[2] = network.nodeLearnRate();
+        _params[3] = network.nodeForgetRate();
+        _params[4] = network.learnTime();
+
+        _future = QtConcurrent::run(this, &NeuroCheckpoint::write);
+    }
+
+    void NeuroCheckpoint::waitForFinished()
+    {
+        // rethrows any exception thrown while writing
+        _future.waitForFinished();
+    }
+
+    /// Writes a checkpoint to a file, preceded by its size and followed by its checksum.
+    static void writeFrame(QFile & file, const QByteArray & frame)
+    {
+        QDataStream ds(&file);
+        ds.setVersion(QDataStream::Qt_4_6);
+
+        ds << frame;
+        ds << qChecksum(frame.constData(), frame.size());
+
+        if (!file.flush())
+            throw Common::IOError(QObject::tr("Unable to write checkpoint file %1.").arg(file.fileName()));
+    }
+
+    void NeuroCheckpoint::write()
+    {
+        try
+        {
+            const bool full = !_file.isOpen() || _prev_records.size() != _records.size() || _num_since_full >= FULL_INTERVAL;
+
+            QByteArray frame;
+            encodeFrame(frame, full);
+
+            if (full)
+            {
+                writeFull(frame);
+                _num_since_full = 0;
+            }
+            else
+            {
+                writeDelta(frame);
+                ++_num_since_full;
+            }
+
+            qSwap(_prev_records, _records);
+        }
+        catch (...)
+        {
+            // start again with a full checkpoint
+            _file.close();
+            _prev_records.clear();
+            throw;
+        }
+    }
+
+    void NeuroCheckpoint::writeFull(const QByteArray & frame)
+    {
+        // write the new file beside the old one, so that there is always a complete checkpoint on disk
+        QFile next(_fname + ".new");
+        if (!next.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            throw Common::IOError(QObject::tr("Unable to write checkpoint file %1.").arg(next.fileName()));
+
+        {
+            QDataStream ds(&next);
+            ds.setVersion(QDataStream::Qt_4_6);
+
+            ds << CHECKPOINT_COOKIE;
+            ds << CHECKPOINT_FILE_VERSION;
+            ds << static_cast<quint16>(NeuroNet::CELL_RECORD_SIZE);
+        }
+
+        writeFrame(next, frame);
+        next.close();
+
+        _file.close();
+        QFile::remove(_fname);
+
+        if (!QFile::rename(next.fileName(), _fname))
+            throw Common::IOError(QObject::tr("Unable to write checkpoint file %1.").arg(_fname));
+
+        _file.setFileName(_fname);
+        if (!_file.open(QIODevice::WriteOnly | QIODevice::Append))
+            throw Common::IOError(QObject::tr("Unable to write checkpoint file %1.").arg(_fname));
+    }
+
+    void NeuroCheckpoint::writeDelta(const QByteArray & frame)
+    {
+        writeFrame(_file, frame);
+    }
+
+    void NeuroCheckpoint::encodeFrame(QByteArray & frame, const bool & full) const
+    {
+        QDataStream ds(&frame, QIODevice::WriteOnly);
+        ds.setVersion(QDataStream::Qt_4_6);
+
+        const int RECORD_SIZE = NeuroNet::CELL_RECORD_SIZE;
+        const int num = _records.size() / RECORD_SIZE;
+
+        ds << (full ? FULL_FRAME : DELTA_FRAME);
+        ds << _timestep;
+        for (int i = 0; i < NUM_PARAMS; ++i)
+            ds << static_cast<float>(_params[i]);
+        ds << static_cast<quint32>(num);
+
+        if (full)
+        {
+            ds.writeRawData(_records.constData(), _records.size());
+            return;
+        }
+
+        // runs of changed cells
+        const char *cur = _records.constData();
+        const char *prev = _prev_records.constData();
+
+        int i = 0;
+        while (i < num)
+        {
+            if (::memcmp(cur + i * RECORD_SIZE, prev + i * RECORD_SIZE, RECORD_SIZE) == 0)
+            {
+                ++i;
+                continue;
+            }
+
+            const int begin = i;
+            while (i < num && ::memcmp(cur + i * RECORD_SIZE, prev + i * RECORD_SIZE, RECORD_SIZE) != 0)
+                ++i;
+
+            ds << static_cast<quint32>(begin);
+            ds << static_cast<quint32>(i - begin);
+            ds.writeRawData(cur + begin * RECORD_SIZE, (i - begin) * RECORD_SIZE);
+        }
+    }
+
+    /// The state of a network read from a checkpoint file.
+    struct CheckpointState
+    {
+        quint64 timestep;
+        float params[NUM_PARAMS];
+        QByteArray records;
+
+        CheckpointState() : timestep(0) {}
+    };
+
+    /// Reads the last complete checkpoint in a file.
+    /// \return False if the file can't be read or holds no complete checkpoint.
+    static bool readCheckpoint(const QString & fname, CheckpointState & state)
+    {
+        QFile file(fname);
+        if (!file.open(QIODevice::ReadOnly))
+            return false;
+
+        QDataStream ds(&file);
+        ds.setVersion(QDataStream::Qt_4_6);
+
+        QString cookie;
+        quint16 version, record_size;
+        ds >> cookie >> version >> record_size;
+
+        if (ds.status() != QDataStream::Ok)
+            return false;
+
+        if (cookie != CHECKPOINT_COOKIE || version != CHECKPOINT_FILE_VERSION || record_size != NeuroNet::CELL_RECORD_SIZE)
+            throw Common::FileFormatError(QObject::tr("Checkpoint file %1 is not compatible with this version of NeuroLab.").arg(fname));
+
+        const int RECORD_SIZE = NeuroNet::CELL_RECORD_SIZE;
+        bool found = false;
+        QByteArray records;
+
+        while (!ds.atEnd())
+        {
+            QByteArray frame;
+            quint16 checksum;
+            ds >> frame >> checksum;
+
+            // stop at a checkpoint that was cut off
+            if (ds.status() != QDataStream::Ok || checksum != qChecksum(frame.constData(), frame.size()))
+                break;
+
+            QDataStream fs(frame);
+            fs.setVersion(QDataStream::Qt_4_6);
+
+            quint8 type;
+            quint64 timestep;
+            float params[NUM_PARAMS];
+            quint32 num;
+
+            fs >> type >> timestep;
+            for (int i = 0; i < NUM_PARAMS; ++i)
+                fs >> params[i];
+            fs >> num;
+
+            if (type == FULL_FRAME)
+            {
+                records.resize(num * RECORD_SIZE);
+                if (fs.readRawData(records.data(), records.size()) != records.size())
+                    throw Common::FileFormatError();
+            }
+            else if (type == DELTA_FRAME && found && static_cast<int>(num) * RECORD_SIZE == records.size())
+            {
+                while (!fs.atEnd())
+                {
+                    quint32 begin, count;
+                    fs >> begin >> count;
+
+                    if (fs.status() != QDataStream::Ok || begin > num || count > num - begin)
+                        throw Common::FileFormatError();
+
+                    if (fs.readRawData(records.data() + begin * RECORD_SIZE, count * RECORD_SIZE) != static_cast<int>(count * RECORD_SIZE))
+                        throw Common::FileFormatError();
+                }
+            }
+            else
+            {
+                throw Common::FileFormatError();
+            }
+
+            found = true;
+            state.timestep = timestep;
+            for (int i = 0; i < NUM_PARAMS; ++i)
+                state.params[i] = params[i];
+        }
+
+        if (found)
+            state.records = records;
+
+        return found;
+    }
+
+    quint64 NeuroCheckpoint::restore(const QString & fname, NeuroNet & network)
+    {
+        // if the program stopped while starting a new file, either file may hold the latest checkpoint
+        CheckpointState state, next_state;
+        bool found = readCheckpoint(fname, state);
+
+        if (readCheckpoint(fname + ".new", next_state) && (!found || next_state.timestep >= state.timestep))
+        {
+            state = next_state;
+            found = true;
+        }
+
+        if (!found)
+            throw Common::FileFormatError(QObject::tr("Checkpoint file %1 holds no complete checkpoint.").arg(fname));
+
+        const int num = state.records.size() / NeuroNet::CELL_RECORD_SIZE;
+        if (num != network.size())
+            throw Common::FileFormatError(QObject::tr("Checkpoint file %1 does not match the network.").arg(fname));
+
+        network.readCellRecords(reinterpret_cast<const uchar *>(state.records.constData()), 0, num);
+
+        network.setDecay(state.params[0]);
+        network.setLinkLearnRate(state.params[1]);
+        network.setNodeLearnRate(state.params[2]);
+        network.setNodeForgetRate(state.params[3]);
+        network.setLearnTime(state.params[4]);
+        network.setTimestep(state.timestep);
+
+        return state.timestep;
+    }
+
+} // namespace NeuroLib
@@ -0,0 +1,118 @@
+#ifndef NEUROCHECKPOINT_H
+#define NEUROCHECKPOINT_H
+
+/*
+Neurocognitive Linguistics Lab
+Copyright (c) 2010,2011 Gordon Tisher
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+ - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+ - Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in
+   the documentation and/or other materials provided with the
+   distribution.
+
+ - Neither the name of the Neurocognitive Linguistics Lab nor the
+   names of its contributors may be used to endorse or promote
+   products derived from this software without specific prior
+   written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "neurolib_global.h"
+#include "neurocell.h"
+
+#include <QString>
+#include <QByteArray>
+#include <QFile>
+#include <QFuture>
+
+namespace NeuroLib
+{
+
+    class NeuroNet;
+
+    /// Writes checkpoints of a running network to a file (.nnc), from which the network can be restored after a crash.
+    /// A checkpoint holds the network's parameters and the complete state of each of its cells at the end of a timestep;
+    /// stepping on from a restored checkpoint gives the same results as stepping on from the network it was taken of.
+    /// The first checkpoint in a file holds every cell; most of the following ones hold only the runs of cells
+    /// whose state has changed since the one before.  Each checkpoint is written by a background thread,
+    /// so the stepping thread is held up only while the cells are copied.
+    /// \note Checkpoints record the states of the cells, not the network's structure, which is saved in the .nnn file.
+    class NEUROLIBSHARED_EXPORT NeuroCheckpoint
+    {
+    public:
+        /// Constructor.
+        /// \param fname The name of the checkpoint file.  It is replaced when the first checkpoint is written.
+        explicit NeuroCheckpoint(const QString & fname);
+
+        /// Destructor.  Waits for the last checkpoint to be written.
+        ~NeuroCheckpoint();
+
+        /// \return The name of the checkpoint file.
+        const QString & fileName() const { return _fname; }
+
+        /// Takes a checkpoint of a network.  Waits for the previous checkpoint to be written first.
+        /// \note Call only between timesteps, from the thread that steps the network.
+        /// \param timestep A count of the timesteps the network has been run; returned by NeuroCheckpoint::restore().
+        void take(const NeuroNet & network, const quint64 & timestep);
+
+        /// Blocks until the last checkpoint taken has been written.
+        /// Throws Common::IOError if it could not be.
+        void waitForFinished();
+
+        /// Restores a network to the last complete checkpoint in a file.
+        /// A checkpoint that was only partly written, because the program stopped while writing it, is ignored.
+        /// Throws Common::FileFormatError if the file holds no complete checkpoint, or if its cells don't match the network.
+        /// \return The timestep given when the checkpoint was taken.
+        static quint64 restore(const QString & fname, NeuroNet & network);
+
+    private:
+        /// A checkpoint holding every cell is written after this many that hold only the changes.
+        /// It starts a new file, so that the file doesn't grow without bound.
+        static const int FULL_INTERVAL = 32;
+
+        QString _fname;
+        QFile _file;
+        QFuture<void> _future;
+        int _num_since_full;
+
+        QByteArray _records;       ///< The cell records of the checkpoint being written.
+        QByteArray _prev_records;  ///< The cell records of the checkpoint written before it.
+        quint64 _timestep;
+        NeuroCell::Value _params[5];
+
+        /// Writes the checkpoint in \c _records; runs in a background thread.
+        void write();
+
+        /// Replaces the checkpoint file with a new one that starts with a full checkpoint.
+        void writeFull(const QByteArray & frame);
+
+        /// Appends a checkpoint that holds the runs of changed cells.
+        void writeDelta(const QByteArray & frame);
+
+        /// Writes a checkpoint's header and its runs of records into \c frame.
+        void encodeFrame(QByteArray & frame, const bool & full) const;
+    };
+
+} // namespace NeuroLib
+
+#endif // NEUROCHECKPOINT_H
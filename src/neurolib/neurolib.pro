@@ -11,10 +11,16 @@ include(../version.txt)
 DEFINES += NEUROLIB_LIBRARY
 
 SOURCES += neuronet.cpp \
-    neurocell.cpp
+    neurocell.cpp \
+    neuroarrays.cpp \
+    neurocheckpoint.cpp \
+    neuroprobe.cpp
 HEADERS += neuronet.h \
     neurolib_global.h \
-    neurocell.h
+    neurocell.h \
+    neuroarrays.h \
+    neurocheckpoint.h \
+    neuroprobe.h
 
 CONFIG(release, debug|release) { BUILDDIR=release }
 CONFIG(debug, debug|release) {
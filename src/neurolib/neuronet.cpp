@@ -35,8 +35,15 @@ POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include "neuronet.h"
+#include "neuroprobe.h"
 
 #include <QString>
+#include <QFile>
+#include <QtAlgorithms>
+#include <QtEndian>
+#include <QtConcurrentRun>
+
+#include <climits>
 
 namespace NeuroLib
 {
@@ -53,35 +60,460 @@ namespace NeuroLib
         _link_learn_rate(0),
         _node_learn_rate(0),
         _node_forget_rate(0),
-        _learn_time(10)
+        _learn_time(10),
+        _sort_post_updates(false),
+        _timestep(0),
+        _pass(0),
+        _storage_mode(CELL_STORAGE),
+        _step_mode(ASYNCHRONOUS_STEP),
+        _vector_kernels(false),
+        _active_set(false),
+        _compress_files(false),
+        _arrays_valid(false),
+        _array_task(*this)
+    {
+    }
+
+    void NeuroNet::setStorageMode(const StorageMode & mode)
+    {
+        if (mode == _storage_mode)
+            return;
+
+        syncCells();
+        resetArrays();
+
+        _storage_mode = mode;
+
+        if (_storage_mode == CELL_STORAGE)
+            _step_mode = ASYNCHRONOUS_STEP;
+    }
+
+    void NeuroNet::setStepMode(const StepMode & mode)
     {
+        if (mode == SYNCHRONOUS_STEP)
+            setStorageMode(ARRAY_STORAGE);
+
+        _step_mode = mode;
+        _pass = 0;
+        _arrays.activateAll();
     }
 
     void NeuroNet::preUpdate()
     {
+        for (int i = 0; i < NUM_POST_UPDATE_BUFFERS; ++i)
+            _post_update_buffers[i].recs.resize(0);
+
         _postUpdates.clear();
     }
 
+    static bool postUpdateIndexLessThan(const NeuroNet::PostUpdateRec & a, const NeuroNet::PostUpdateRec & b)
+    {
+        return a._index < b._index;
+    }
+
     void NeuroNet::postUpdate()
     {
-        foreach (const PostUpdateRec & rec, _postUpdates)
+        QElapsedTimer timer;
+        if (profiling())
+            timer.start();
+
+        if (_sort_post_updates)
+        {
+            QVector<PostUpdateRec> merged;
+            for (int i = 0; i < NUM_POST_UPDATE_BUFFERS; ++i)
+                merged += _post_update_buffers[i].recs;
+            foreach (const PostUpdateRec & rec, _postUpdates)
+                merged.append(rec);
+
+            qStableSort(merged.begin(), merged.end(), postUpdateIndexLessThan);
+
+            foreach (const PostUpdateRec & rec, merged)
+                applyPostUpdate(rec);
+        }
+        else
+        {
+            for (int i = 0; i < NUM_POST_UPDATE_BUFFERS; ++i)
+            {
+                const QVector<PostUpdateRec> & recs = _post_update_buffers[i].recs;
+                const int num = recs.size();
+                for (int j = 0; j < num; ++j)
+                    applyPostUpdate(recs[j]);
+            }
+
+            foreach (const PostUpdateRec & rec, _postUpdates)
+                applyPostUpdate(rec);
+        }
+
+        if (profiling())
+            addPostUpdateTime(timer.nsecsElapsed());
+
+        if (++_pass >= passesPerStep())
+        {
+            _pass = 0;
+            ++_timestep;
+
+            if (!_probes.isEmpty())
+                sampleProbes();
+        }
+    }
+
+    void NeuroNet::addProbe(NeuroProbe *probe)
+    {
+        Q_ASSERT(probe != 0);
+
+        foreach (const NeuroCell::Index & index, probe->cells())
+        {
+            if (index < 0 || index >= _nodes.size())
+                throw Common::IndexOverflow();
+        }
+
+        if (!_probes.contains(probe))
+            _probes.append(probe);
+    }
+
+    void NeuroNet::removeProbe(NeuroProbe *probe)
+    {
+        _probes.removeAll(probe);
+    }
+
+    void NeuroNet::sampleProbes()
+    {
+        foreach (NeuroProbe *probe, _probes)
+        {
+            if (_timestep % probe->stride() != 0)
+                continue;
+
+            NeuroCell::Value *value = probe->beginSample();
+            if (!value)
+                continue;
+
+            const bool output = (probe->quantities() & NeuroProbe::OUTPUT_VALUE) != 0;
+            const bool average = (probe->quantities() & NeuroProbe::RUNNING_AVERAGE) != 0;
+
+            // read the arrays directly, rather than copying the cells out of them
+            foreach (const NeuroCell::Index & index, probe->cells())
+            {
+                if (cellInArrays(index))
+                {
+                    if (output)
+                        *value++ = _arrays.outputValue(index);
+                    if (average)
+                        *value++ = _arrays.runningAverage(index);
+                }
+                else
+                {
+                    const NeuroCell & cell = _nodes[index].current();
+                    if (output)
+                        *value++ = cell.outputValue();
+                    if (average)
+                        *value++ = cell.runningAverage();
+                }
+            }
+
+            probe->endSample(_timestep);
+        }
+    }
+
+    void NeuroNet::applyPostUpdate(const PostUpdateRec & rec)
+    {
+        if (cellInArrays(rec._index))
+        {
+            if (_arrays.weight(rec._index) != rec._weight)
+                _arrays.activate(rec._index);
+
+            _arrays.setWeight(rec._index, rec._weight);
+        }
+        else
         {
             //_nodes[rec._index].former().setWeight(rec._weight);
             _nodes[rec._index].current().setWeight(rec._weight);
         }
     }
 
+    void NeuroNet::step()
+    {
+        if (_storage_mode == CELL_STORAGE)
+        {
+            BASE::step();
+            return;
+        }
+
+        freezeEdges();
+        syncArrays();
+
+        if (activeStepping())
+            beginActiveStep();
+
+        stepArrays();
+    }
+
+    void NeuroNet::stepInThread()
+    {
+        if (_storage_mode == CELL_STORAGE)
+        {
+            BASE::stepInThread();
+            return;
+        }
+
+        freezeEdges();
+        syncArrays();
+
+        if (activeStepping())
+            beginActiveStep();
+
+        QElapsedTimer timer;
+        if (profiling())
+            timer.start();
+
+        _array_task.run(0, activeStepping() ? _arrays.numActive() : _arrays.size());
+
+        if (_step_mode == SYNCHRONOUS_STEP)
+            _arrays.swapBuffers();
+
+        if (profiling())
+            finishProfiledStep(timer.nsecsElapsed());
+    }
+
+    QFuture<void> NeuroNet::stepAsync()
+    {
+        if (_storage_mode == CELL_STORAGE)
+            return BASE::stepAsync();
+
+        freezeEdges();
+        syncArrays();
+
+        if (activeStepping())
+            beginActiveStep();
+
+        return QtConcurrent::run(this, &NeuroNet::stepArrays);
+    }
+
+    void NeuroNet::stepArrays()
+    {
+        QElapsedTimer timer;
+        if (profiling())
+            timer.start();
+
+        stepPool()->run(&_array_task, activeStepping() ? _arrays.numActive() : _arrays.size(), cellsPerChunk());
+
+        // the buffers can only be swapped once all the cells are done
+        if (_step_mode == SYNCHRONOUS_STEP)
+            _arrays.swapBuffers();
+
+        if (profiling())
+            finishProfiledStep(timer.nsecsElapsed());
+    }
+
+    NeuroCell::Index NeuroNet::addNode(const NeuroCell & cell)
+    {
+        NeuroCell::Index index = BASE::addNode(cell);
+
+        if (_arrays_valid)
+            markCellChanged(index);
+
+        return index;
+    }
+
+    QVector<NeuroCell::Index> NeuroNet::addNodes(const QVector<NeuroCell> & cells)
+    {
+        QVector<NeuroCell::Index> indices = BASE::addNodes(cells);
+
+        if (_arrays_valid)
+        {
+            // grow the change bits once, rather than for each new cell
+            if (_cells_changed.size() < _nodes.size())
+                _cells_changed.resize(_nodes.size());
+
+            foreach (const NeuroCell::Index & index, indices)
+                markCellChanged(index);
+        }
+
+        return indices;
+    }
+
+    NeuroCell::Index NeuroNet::addTiles(const QVector<NeuroCell> & cells, const Automata::Tiling & tiling)
+    {
+        const NeuroCell::Index first = BASE::addTiles(cells, tiling);
+
+        if (_arrays_valid)
+        {
+            if (_cells_changed.size() < _nodes.size())
+                _cells_changed.resize(_nodes.size());
+
+            const NeuroCell::Index end = first + cells.size();
+            for (NeuroCell::Index index = first; index < end; ++index)
+                markCellChanged(index);
+        }
+
+        return first;
+    }
+
+    QVector<NeuroCell::Index> NeuroNet::resizeTiles(const NeuroCell::Index & tiled, const int & num_cols, const int & num_rows, const QVector<NeuroCell> & pattern)
+    {
+        QVector<NeuroCell::Index> added = BASE::resizeTiles(tiled, num_cols, num_rows, pattern);
+
+        // the cells of the tiles that are kept stay in the arrays
+        if (_arrays_valid)
+        {
+            if (_cells_changed.size() < _nodes.size())
+                _cells_changed.resize(_nodes.size());
+
+            foreach (const NeuroCell::Index & index, added)
+                markCellChanged(index);
+        }
+
+        return added;
+    }
+
+    void NeuroNet::clear()
+    {
+        BASE::clear();
+        resetArrays();
+        setTimestep(0);
+    }
+
+    qint64 NeuroNet::memoryUsed() const
+    {
+        return BASE::memoryUsed() + _arrays.memoryUsed();
+    }
+
+    int NeuroNet::readyState(const NeuroCell::Index & index) const
+    {
+        if (index < _nodes.size())
+            return cellInArrays(index) ? _arrays.readyState(index) : _nodes[index].r.load();
+        else
+            throw Common::IndexOverflow();
+    }
+
+    NeuroNet::ASYNC_STATE NeuroNet::operator[] (const NeuroCell::Index & index) const
+    {
+        if (index < _nodes.size())
+        {
+            ASYNC_STATE stored = _nodes[index];
+            if (cellInArrays(index))
+                _arrays.storeCell(index, stored);
+
+            return stored;
+        }
+        else
+        {
+            throw Common::IndexOverflow();
+        }
+    }
+
+    NeuroNet::ASYNC_STATE & NeuroNet::operator[] (const NeuroCell::Index & index)
+    {
+        if (index < _nodes.size())
+        {
+            if (cellInArrays(index))
+            {
+                _arrays.storeCell(index, _nodes[index]);
+                markCellChanged(index);
+            }
+
+            return _nodes[index];
+        }
+        else
+        {
+            throw Common::IndexOverflow();
+        }
+    }
+
+    void NeuroNet::markCellChanged(const NeuroCell::Index & index)
+    {
+        if (index >= _cells_changed.size())
+            _cells_changed.resize(_nodes.size());
+
+        if (!_cells_changed.testBit(index))
+        {
+            _cells_changed.setBit(index);
+            _changed_cells.append(index);
+        }
+    }
+
+    void NeuroNet::resetArrays()
+    {
+        _arrays.clear();
+        _arrays_valid = false;
+        _cells_changed.clear();
+        _changed_cells.clear();
+    }
+
+    void NeuroNet::syncArrays()
+    {
+        const int num = _nodes.size();
+
+        if (!_arrays_valid)
+        {
+            _arrays.resize(num);
+            for (int i = 0; i < num; ++i)
+                _arrays.loadCell(i, _nodes[i]);
+
+            _arrays_valid = true;
+        }
+        else
+        {
+            if (_arrays.size() != num)
+                _arrays.resize(num);
+
+            foreach (const NeuroCell::Index & index, _changed_cells)
+            {
+                _arrays.loadCell(index, _nodes[index]);
+                _arrays.activate(index);
+                _cells_changed.clearBit(index);
+            }
+        }
+
+        _changed_cells.clear();
+
+        if (_step_mode == SYNCHRONOUS_STEP)
+            _arrays.orderByKind();
+    }
+
+    void NeuroNet::beginActiveStep()
+    {
+        if (!reverseEdgesFrozen())
+        {
+            _arrays.activateAll();
+            freezeReverseEdges();
+        }
+
+        _arrays.beginActiveStep(this);
+    }
+
+    void NeuroNet::syncCells()
+    {
+        if (!_arrays_valid)
+            return;
+
+        const int num = _arrays.size();
+        for (int i = 0; i < num; ++i)
+        {
+            if (cellInArrays(i))
+                _arrays.storeCell(i, _nodes[i]);
+        }
+    }
+
     void NeuroNet::addPostUpdate(const PostUpdateRec & rec)
     {
-        QWriteLocker wl(&_postUpdatesLock);
-        _postUpdates.append(rec);
+        const int thread = Automata::ThreadIndex::current();
+
+        if (thread < NUM_POST_UPDATE_BUFFERS)
+        {
+            _post_update_buffers[thread].recs.append(rec);
+        }
+        else
+        {
+            QWriteLocker wl(&_postUpdatesLock);
+            _postUpdates.append(rec);
+        }
     }
 
     void NeuroNet::writeBinary(QDataStream & ds, const Automata::AutomataFileVersion & file_version) const
     {
         Automata::AutomataFileVersion & fv = const_cast<Automata::AutomataFileVersion &>(file_version);
 
-        fv.automata_version = Automata::AUTOMATA_NUM_FILE_VERSIONS - 1;
+        fv.automata_version = _compress_files ? Automata::AUTOMATA_FILE_VERSION_5 : Automata::AUTOMATA_FILE_VERSION_4;
         fv.client_version = NeuroLib::NEUROLIB_NUM_FILE_VERSIONS - 1;
 
         ds << NETWORK_COOKIE_NEW;
@@ -93,13 +525,19 @@ namespace NeuroLib
         ds << static_cast<float>(_node_forget_rate);
         ds << static_cast<float>(_learn_time);
 
-        BASE::writeBinary(ds, fv);
+        if (_compress_files)
+            writeCompressed(ds);
+        else
+            writeMappable(ds);
     }
 
     void NeuroNet::readBinary(QDataStream & ds, const Automata::AutomataFileVersion & file_version)
     {
         Automata::AutomataFileVersion & fv = const_cast<Automata::AutomataFileVersion &>(file_version);
 
+        resetArrays();
+        setTimestep(0);
+
         QString cookie;
         ds >> cookie;
 
@@ -137,12 +575,483 @@ namespace NeuroLib
 
             ds >> n; _learn_time = static_cast<NeuroCell::Value>(n);
 
-            BASE::readBinary(ds, fv);
+            if (fv.automata_version >= Automata::AUTOMATA_FILE_VERSION_5)
+                readCompressed(ds);
+            else if (fv.automata_version >= Automata::AUTOMATA_FILE_VERSION_4)
+                readMappable(ds);
+            else
+                BASE::readBinary(ds, fv);
+        }
+        else
+        {
+            throw Common::FileFormatError();
+        }
+    }
+
+    /// The number of zero bytes to write so that the cell records start on a 16-byte boundary of the file;
+    /// the count is written before them, as the file may be read back at a different position.
+    static int mappablePadding(QDataStream & ds)
+    {
+        const qint64 pos = (ds.device() ? ds.device()->pos() : 0) + sizeof(quint8);
+        return static_cast<int>((16 - (pos % 16)) % 16);
+    }
+
+    void NeuroNet::writeMappable(QDataStream & ds) const
+    {
+        const_cast<NeuroNet *>(this)->freezeEdges();
+
+        ds << _directed;
+        ds << static_cast<quint32>(_nodes.size());
+        ds << static_cast<quint32>(_csr_edges.size());
+        ds << static_cast<quint32>(_free_nodes.size());
+
+        static const char zeros[16] = { 0 };
+        const int padding = mappablePadding(ds);
+        ds << static_cast<quint8>(padding);
+        ds.writeRawData(zeros, padding);
+
+        // cells, a block at a time
+        const int num = _nodes.size();
+        const int BLOCK_SIZE = 1024;
+        QVector<uchar> block(BLOCK_SIZE * CELL_RECORD_SIZE);
+
+        for (int begin = 0; begin < num; begin += BLOCK_SIZE)
+        {
+            const int end = qMin(begin + BLOCK_SIZE, num);
+            writeCellRecords(block.data(), begin, end);
+            ds.writeRawData(reinterpret_cast<const char *>(block.constData()), (end - begin) * CELL_RECORD_SIZE);
+        }
+
+        // edges and free nodes
+        writeFrozenEdges(ds);
+        writeLittleEndian(ds, _free_nodes.constData(), _free_nodes.size());
+    }
+
+    void NeuroNet::writeCellRecords(uchar *data, const int & begin, const int & end) const
+    {
+        ASYNC_STATE stored;
+
+        for (int i = begin; i < end; ++i, data += CELL_RECORD_SIZE)
+        {
+            const ASYNC_STATE *cell = _nodes.constData() + i;
+            if (cellInArrays(i))
+            {
+                _arrays.storeCell(i, stored);
+                cell = &stored;
+            }
+
+            cell->current().writeRecord(data);
+            cell->former().writeRecord(data + NeuroCell::RECORD_SIZE);
+            qToLittleEndian<quint16>(cell->r, data + 2 * NeuroCell::RECORD_SIZE);
+            data[2 * NeuroCell::RECORD_SIZE + 2] = 0;
+            data[2 * NeuroCell::RECORD_SIZE + 3] = 0;
+        }
+    }
+
+    /// \internal Decodes a range of cell records for the step pool.
+    struct DecodeRecordsTask
+        : public Automata::StepPool::Task
+    {
+        NeuroNet::ASYNC_STATE *cells;
+        const uchar *data;
+
+        DecodeRecordsTask(NeuroNet::ASYNC_STATE *cells, const uchar *data) : cells(cells), data(data) {}
+
+        virtual void run(const int & begin, const int & end)
+        {
+            NeuroNet::ASYNC_STATE *cell = cells + begin;
+            const uchar *record = data + begin * NeuroNet::CELL_RECORD_SIZE;
+
+            for (int i = begin; i < end; ++i, ++cell, record += NeuroNet::CELL_RECORD_SIZE)
+            {
+                cell->r = qFromLittleEndian<quint16>(record + 2 * NeuroCell::RECORD_SIZE);
+                cell->current().readRecord(record);
+                cell->former().readRecord(record + NeuroCell::RECORD_SIZE);
+            }
         }
+    };
+
+    void NeuroNet::readCellRecords(const uchar *data, const int & begin, const int & end)
+    {
+        if (begin < 0 || end > _nodes.size())
+            throw Common::IndexOverflow();
+
+        // the cells will hold the network's state until the next step
+        syncCells();
+        resetArrays();
+
+        // large networks are decoded in parallel
+        const int DECODE_CHUNK_SIZE = 16384;
+        DecodeRecordsTask task(_nodes.data() + begin, data);
+
+        if (end - begin > DECODE_CHUNK_SIZE)
+            stepPool()->run(&task, end - begin, DECODE_CHUNK_SIZE);
         else
+            task.run(0, end - begin);
+
+        for (int i = begin; i < end; ++i)
+        {
+            if (_nodes[i].r > 2)
+                throw Common::FileFormatError();
+        }
+    }
+
+    void NeuroNet::readMappable(QDataStream & ds)
+    {
+        quint32 num, num_edges, num_free;
+        quint8 padding;
+        ds >> _directed;
+        ds >> num;
+        ds >> num_edges;
+        ds >> num_free;
+        ds >> padding;
+
+        if (ds.status() != QDataStream::Ok || padding >= 16 || num_free > num)
+            throw Common::FileFormatError();
+        const qint64 cells_size = static_cast<qint64>(num) * CELL_RECORD_SIZE;
+        const qint64 size = padding + cells_size + frozenEdgesSize(num, num_edges) + static_cast<qint64>(num_free) * sizeof(quint32);
+
+        // a corrupt header must not make us map or allocate more than the file holds
+        if (!ds.device() || size > ds.device()->bytesAvailable() || size > INT_MAX)
+            throw Common::FileFormatError();
+
+        // map the rest of the graph if we can; otherwise read it into memory
+        QFile *file = qobject_cast<QFile *>(ds.device());
+        const qint64 pos = file ? file->pos() : 0;
+        uchar *mapped = file ? file->map(pos, size) : 0;
+
+        QByteArray buffer;
+        const uchar *data = mapped;
+
+        if (!data)
+        {
+            buffer.resize(static_cast<int>(size));
+            if (ds.readRawData(buffer.data(), buffer.size()) != buffer.size())
+                throw Common::FileFormatError();
+            data = reinterpret_cast<const uchar *>(buffer.constData());
+        }
+
+        try
+        {
+            data += padding;
+
+            // cells
+            _nodes.resize(num);
+            for (quint32 i = 0; i < num; ++i)
+                _nodes[i].index = i;
+
+            readCellRecords(data, 0, num);
+            data += cells_size;
+
+            // edges
+            readFrozenEdges(data, num, num_edges);
+            data += frozenEdgesSize(num, num_edges);
+
+            // free nodes
+            _free_nodes.resize(num_free);
+            readLittleEndian(data, _free_nodes.data(), num_free);
+
+            foreach (const NeuroCell::Index & index, _free_nodes)
+            {
+                if (index < 0 || static_cast<quint32>(index) >= num)
+                    throw Common::FileFormatError();
+            }
+        }
+        catch (...)
+        {
+            if (mapped)
+                file->unmap(mapped);
+            throw;
+        }
+
+        if (mapped)
+        {
+            file->unmap(mapped);
+            file->seek(pos + size);
+        }
+    }
+
+    /// Appends an unsigned integer to a buffer, seven bits at a time.
+    static inline void writeVarint(QByteArray & buf, quint32 value)
+    {
+        while (value >= 0x80)
         {
+            buf.append(static_cast<char>((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+        buf.append(static_cast<char>(value));
+    }
+
+    /// Reads an unsigned integer written by writeVarint().
+    /// \return False if the buffer ends before the integer does.
+    static inline bool readVarint(const uchar * & pos, const uchar *end, quint32 & value)
+    {
+        value = 0;
+        for (int shift = 0; shift < 35 && pos < end; shift += 7)
+        {
+            const uchar b = *pos++;
+            value |= static_cast<quint32>(b & 0x7f) << shift;
+            if (!(b & 0x80))
+                return true;
+        }
+        return false;
+    }
+
+    /// The flag in a compressed cell's ready state byte that marks a former state that differs from the current one.
+    static const uchar FORMER_DIFFERS = 0x80;
+
+    /// \internal Encodes and compresses blocks of cells and their edges for the step pool.
+    /// A block holds, for each cell, its current state's record, a byte for its ready state, and its former state's
+    /// record if it differs from the current one; then, for each cell, the number of its edges and the difference
+    /// of each neighbor's index from the one before (starting from the cell's own index), zigzag-encoded.
+    struct EncodeBlocksTask
+        : public Automata::StepPool::Task
+    {
+        const NeuroNet *network;
+        const int *offsets;
+        const NeuroCell::Index *edges;
+        int num_cells, block_size;
+        QByteArray *blocks;
+
+        virtual void run(const int & begin, const int & end)
+        {
+            QByteArray raw;
+            uchar q0[NeuroCell::RECORD_SIZE], q1[NeuroCell::RECORD_SIZE];
+
+            for (int b = begin; b < end; ++b)
+            {
+                const int first = b * block_size;
+                const int last = qMin(first + block_size, num_cells);
+
+                raw.clear();
+                raw.reserve((last - first) * (NeuroCell::RECORD_SIZE + 4) + (offsets[last] - offsets[first]) * 2);
+
+                for (int i = first; i < last; ++i)
+                {
+                    const NeuroNet::ASYNC_STATE cell = (*network)[i];
+                    cell.current().writeRecord(q0);
+                    cell.former().writeRecord(q1);
+
+                    const bool differs = ::memcmp(q0, q1, NeuroCell::RECORD_SIZE) != 0;
+
+                    raw.append(reinterpret_cast<const char *>(q0), NeuroCell::RECORD_SIZE);
+                    raw.append(static_cast<char>(cell.r | (differs ? FORMER_DIFFERS : 0)));
+                    if (differs)
+                        raw.append(reinterpret_cast<const char *>(q1), NeuroCell::RECORD_SIZE);
+                }
+
+                for (int i = first; i < last; ++i)
+                {
+                    writeVarint(raw, static_cast<quint32>(offsets[i + 1] - offsets[i]));
+
+                    qint32 prev = i;
+                    for (int j = offsets[i]; j < offsets[i + 1]; ++j)
+                    {
+                        const qint32 delta = static_cast<qint32>(edges[j]) - prev;
+                        writeVarint(raw, (static_cast<quint32>(delta) << 1) ^ static_cast<quint32>(delta >> 31));
+                        prev = static_cast<qint32>(edges[j]);
+                    }
+                }
+
+                blocks[b] = qCompress(raw);
+            }
+        }
+    };
+
+    /// \internal Decompresses and decodes blocks written by EncodeBlocksTask for the step pool.
+    /// Each block's edges go into the frozen layout, starting at the position given by \c edge_begin.
+    struct DecodeBlocksTask
+        : public Automata::StepPool::Task
+    {
+        NeuroNet::ASYNC_STATE *cells;
+        int *offsets;
+        NeuroCell::Index *edges;
+        const quint32 *edge_begin;
+        int num_cells, block_size;
+        const QByteArray *blocks;
+        char *ok;
+
+        virtual void run(const int & begin, const int & end)
+        {
+            for (int b = begin; b < end; ++b)
+                ok[b] = decode(b);
+        }
+
+        bool decode(const int & b)
+        {
+            const QByteArray raw = qUncompress(blocks[b]);
+            const uchar *pos = reinterpret_cast<const uchar *>(raw.constData());
+            const uchar *raw_end = pos + raw.size();
+
+            const int first = b * block_size;
+            const int last = qMin(first + block_size, num_cells);
+
+            for (int i = first; i < last; ++i)
+            {
+                if (raw_end - pos < NeuroCell::RECORD_SIZE + 1)
+                    return false;
+
+                NeuroNet::ASYNC_STATE & cell = cells[i];
+                cell.q0.readRecord(pos);
+                pos += NeuroCell::RECORD_SIZE;
+
+                const uchar r = *pos++;
+                cell.r = r & ~FORMER_DIFFERS;
+                if (cell.r > 2)
+                    return false;
+
+                if (r & FORMER_DIFFERS)
+                {
+                    if (raw_end - pos < NeuroCell::RECORD_SIZE)
+                        return false;
+                    cell.q1.readRecord(pos);
+                    pos += NeuroCell::RECORD_SIZE;
+                }
+                else
+                {
+                    cell.q1 = cell.q0;
+                }
+
+                // the block holds the current state first; in the middle of a timestep that is the next state
+                if (cell.r != 0)
+                    qSwap(cell.q0, cell.q1);
+            }
+
+            quint32 e = edge_begin[b];
+            const quint32 e_end = edge_begin[b + 1];
+
+            for (int i = first; i < last; ++i)
+            {
+                quint32 count;
+                if (!readVarint(pos, raw_end, count) || count > e_end - e)
+                    return false;
+
+                qint32 prev = i;
+                for (quint32 k = 0; k < count; ++k)
+                {
+                    quint32 zigzag;
+                    if (!readVarint(pos, raw_end, zigzag))
+                        return false;
+
+                    const qint32 index = prev + static_cast<qint32>((zigzag >> 1) ^ (~(zigzag & 1) + 1));
+                    if (index < 0 || index >= num_cells)
+                        return false;
+
+                    edges[e++] = index;
+                    prev = index;
+                }
+
+                offsets[i + 1] = static_cast<int>(e);
+            }
+
+            return e == e_end && pos == raw_end;
+        }
+    };
+
+    void NeuroNet::writeCompressed(QDataStream & ds) const
+    {
+        const_cast<NeuroNet *>(this)->freezeEdges();
+
+        const int num = _nodes.size();
+        const int num_blocks = (num + COMPRESSED_BLOCK_SIZE - 1) / COMPRESSED_BLOCK_SIZE;
+        QVector<QByteArray> blocks(num_blocks);
+
+        EncodeBlocksTask task;
+        task.network = this;
+        task.offsets = _csr_offsets.constData();
+        task.edges = _csr_edges.constData();
+        task.num_cells = num;
+        task.block_size = COMPRESSED_BLOCK_SIZE;
+        task.blocks = blocks.data();
+        stepPool()->run(&task, num_blocks, 1);
+
+        ds << _directed;
+        ds << static_cast<quint32>(num);
+        ds << static_cast<quint32>(_csr_edges.size());
+
+        ds << static_cast<quint32>(_free_nodes.size());
+        foreach (const NeuroCell::Index & index, _free_nodes)
+            ds << static_cast<quint32>(index);
+
+        ds << static_cast<quint32>(num_blocks);
+        for (int b = 0; b < num_blocks; ++b)
+        {
+            const int first = b * COMPRESSED_BLOCK_SIZE;
+            const int last = qMin(first + COMPRESSED_BLOCK_SIZE, num);
+
+            ds << static_cast<quint32>(_csr_offsets[last] - _csr_offsets[first]);
+            ds << blocks[b];
+        }
+    }
+
+    void NeuroNet::readCompressed(QDataStream & ds)
+    {
+        quint32 num, num_edges, num_free, num_blocks;
+        ds >> _directed;
+        ds >> num;
+        ds >> num_edges;
+
+        ds >> num_free;
+        if (ds.status() != QDataStream::Ok || num_free > num)
             throw Common::FileFormatError();
+
+        _free_nodes.resize(num_free);
+        for (quint32 i = 0; i < num_free; ++i)
+        {
+            quint32 index;
+            ds >> index;
+            if (index >= num)
+                throw Common::FileFormatError();
+            _free_nodes[i] = static_cast<NeuroCell::Index>(index);
         }
+
+        ds >> num_blocks;
+        if (ds.status() != QDataStream::Ok || num_blocks != (num + COMPRESSED_BLOCK_SIZE - 1) / COMPRESSED_BLOCK_SIZE)
+            throw Common::FileFormatError();
+
+        QVector<QByteArray> blocks(num_blocks);
+        QVector<quint32> edge_begin(num_blocks + 1);
+        edge_begin[0] = 0;
+
+        for (quint32 b = 0; b < num_blocks; ++b)
+        {
+            quint32 block_edges;
+            ds >> block_edges;
+            ds >> blocks[b];
+
+            if (block_edges > num_edges - edge_begin[b])
+                throw Common::FileFormatError();
+            edge_begin[b + 1] = edge_begin[b] + block_edges;
+        }
+
+        if (ds.status() != QDataStream::Ok || edge_begin[num_blocks] != num_edges)
+            throw Common::FileFormatError();
+
+        // decode the blocks in parallel
+        _nodes.resize(num);
+        for (quint32 i = 0; i < num; ++i)
+            _nodes[i].index = i;
+
+        QVector<int> offsets(num + 1);
+        QVector<NeuroCell::Index> edges(num_edges);
+        QVector<char> ok(num_blocks);
+        offsets[0] = 0;
+
+        DecodeBlocksTask task;
+        task.cells = _nodes.data();
+        task.offsets = offsets.data();
+        task.edges = edges.data();
+        task.edge_begin = edge_begin.constData();
+        task.num_cells = num;
+        task.block_size = COMPRESSED_BLOCK_SIZE;
+        task.blocks = blocks.constData();
+        task.ok = ok.data();
+        stepPool()->run(&task, num_blocks, 1);
+
+        if (ok.contains(0))
+            throw Common::FileFormatError();
+
+        adoptFrozenEdges(offsets, edges);
     }
 
     static const QString NODE("N");
@@ -174,7 +1083,12 @@ namespace NeuroLib
         ts << "  graph [overlap = false];\n";
         ts << "  node [shape = circle];\n";
 
+        syncCells();
+
+        thawEdges();
+
         const NeuroCell::Index num = _edges.size();
+        QVector<NeuroCell::Index> neighbors;
         for (NeuroCell::Index i = 0; i < num; ++i)
         {
             if (_free_nodes.contains(i))
@@ -183,11 +1097,11 @@ namespace NeuroLib
                 continue;
             }
 
-            const QVector<NeuroCell::Index> & neighbors = _edges[i];
+            edgesOf(i, neighbors);
             if (neighbors.size() > 0)
             {
-                if (_nodes[i].q0.outputValue() > 0.5)
-                    ts << "  " << nodeType(_nodes[i].q0) << i << " [color=\"red\"]" << "\n";
+                if (_nodes[i].current().outputValue() > 0.5)
+                    ts << "  " << nodeType(_nodes[i].current()) << i << " [color=\"red\"]" << "\n";
 
                 foreach (const NeuroCell::Index & nbr, neighbors)
                 {
@@ -195,17 +1109,17 @@ namespace NeuroLib
                         continue;
 
                     if (reverse)
-                        ts << "  " << nodeType(_nodes[nbr].q0) << nbr << " -> " << nodeType(_nodes[i].q0) << i << "\n";
+                        ts << "  " << nodeType(_nodes[nbr].current()) << nbr << " -> " << nodeType(_nodes[i].current()) << i << "\n";
                     else
-                        ts << "  " << nodeType(_nodes[i].q0) << i << " -> " << nodeType(_nodes[nbr].q0) << nbr << "\n";
+                        ts << "  " << nodeType(_nodes[i].current()) << i << " -> " << nodeType(_nodes[nbr].current()) << nbr << "\n";
                 }
             }
             else
             {
-                if (_nodes[i].q0.outputValue() > 0.5)
-                    ts << "  " << nodeType(_nodes[i].q0) << i << " [color=\"red\"]" << "\n";
+                if (_nodes[i].current().outputValue() > 0.5)
+                    ts << "  " << nodeType(_nodes[i].current()) << i << " [color=\"red\"]" << "\n";
                 else
-                    ts << "  " << nodeType(_nodes[i].q0) << i << "\n";
+                    ts << "  " << nodeType(_nodes[i].current()) << i << "\n";
             }
         }
 
@@ -39,15 +39,20 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #include "neurolib_global.h"
 #include "neurocell.h"
+#include "neuroarrays.h"
 
 #include "../automata/automaton.h"
 
 #include <QDataStream>
 #include <QReadWriteLock>
+#include <QBitArray>
+#include <QList>
 
 namespace NeuroLib
 {
 
+    class NeuroProbe;
+
     /// A neurocognitive network.
     class NEUROLIBSHARED_EXPORT NeuroNet
         : public NeuroCell::NEURONET_BASE
@@ -59,16 +64,85 @@ namespace NeuroLib
         NeuroCell::Value _learn_time;
 
     public:
+        /// How the network stores its cells while stepping.
+        enum StorageMode
+        {
+            CELL_STORAGE = 0, ///< Step the Automata::AsyncState records directly.
+            ARRAY_STORAGE     ///< Step a structure-of-arrays copy of the cells (see NeuroArrays).
+        };
+
+        /// How the network advances its cells.
+        enum StepMode
+        {
+            ASYNCHRONOUS_STEP = 0, ///< The three-phase asynchronous update of Automata::Automaton; a timestep takes three steps.
+            SYNCHRONOUS_STEP       ///< Every cell reads its neighbors' current values and writes its next values into a back buffer; a timestep takes one step.
+        };
+
         /// Constructor.
         NeuroNet();
 
+        /// \return How the network stores its cells while stepping.
+        /// \see NeuroNet::setStorageMode()
+        StorageMode storageMode() const { return _storage_mode; }
+
+        /// Sets how the network stores its cells while stepping.  In NeuroNet::ARRAY_STORAGE mode the cells
+        /// are still available through NeuroNet::operator[](), which copies them out of the arrays as needed.
+        /// \see NeuroNet::storageMode()
+        void setStorageMode(const StorageMode & mode);
+
+        /// \return How the network advances its cells.
+        /// \see NeuroNet::setStepMode()
+        StepMode stepMode() const { return _step_mode; }
+
+        /// Sets how the network advances its cells.  A synchronous step gives the same results as a fully-settled
+        /// asynchronous timestep, in one pass over the cells.  The synchronous mode always uses NeuroNet::ARRAY_STORAGE.
+        /// \note Switch modes only between timesteps, when all cells have the same ready state.
+        /// \see NeuroNet::stepMode()
+        void setStepMode(const StepMode & mode);
+
+        /// \return Whether the synchronous step uses the batch update kernels.
+        /// \see NeuroNet::setVectorKernels()
+        bool vectorKernels() const { return _vector_kernels; }
+
+        /// Sets whether the synchronous step gathers runs of cells of the same kind into batches, and updates them
+        /// with vectorised kernels where the CPU supports them (see NeuroArrays::updateBatch()).  This is faster,
+        /// but node outputs may differ slightly from those of the other modes.  Off by default.
+        /// \see NeuroNet::vectorKernels()
+        void setVectorKernels(const bool & vector_kernels) { _vector_kernels = vector_kernels; _arrays.activateAll(); }
+
+        /// \return Whether the synchronous step only updates the cells whose state or inputs changed in the last step.
+        /// \see NeuroNet::setActiveSet()
+        bool activeSet() const { return _active_set; }
+
+        /// Sets whether the synchronous step only updates the active cells: those whose state changed in the last step
+        /// or since, and those that read them.  A cell at rest would only compute the same state again, so the results are
+        /// exactly those of a full step, but the work per step scales with the activity in the network instead of its size.
+        /// Has no effect on the asynchronous step.  Off by default.
+        /// \see NeuroNet::activeSet(), NeuroNet::numActiveCells()
+        void setActiveSet(const bool & active_set) { _active_set = active_set; _arrays.activateAll(); }
+
+        /// \return The number of cells updated by the last active-set step.
+        int numActiveCells() const { return _arrays.numActive(); }
+
+        /// \return Whether NeuroNet::writeBinary() writes the compressed file layout.
+        /// \see NeuroNet::setCompressFiles()
+        bool compressFiles() const { return _compress_files; }
+
+        /// Sets whether NeuroNet::writeBinary() writes the compressed file layout (Automata::AUTOMATA_FILE_VERSION_5).
+        /// Compressed files are much smaller, but can't be memory-mapped, and take longer to write.  Off by default.
+        /// \see NeuroNet::compressFiles()
+        void setCompressFiles(const bool & compress) { _compress_files = compress; }
+
+        /// \return The number of calls to NeuroNet::step() that make up one timestep in the current step mode.
+        virtual int passesPerStep() const { return _step_mode == SYNCHRONOUS_STEP ? 1 : 3; }
+
         /// The decay rate of nodes in the network per timestep.
         /// \see NeuroNet::setDecay()
         NeuroCell::Value decay() const { return _decay; }
 
         /// Sets the decay rate of nodes in the network.
         /// \see NeuroNet::decay()
-        void setDecay(const NeuroCell::Value & decay) { _decay = decay; }
+        void setDecay(const NeuroCell::Value & decay) { _decay = decay; _arrays.activateAll(); }
 
         /// The learn rate of links in the network.  This is the maximum amount a link's weight will increase via Hebbian learning each timestep.
         /// \see NeuroNet::setLearn()
@@ -76,13 +150,13 @@ namespace NeuroLib
 
         /// Sets the learn rate of links in the network.
         /// \see NeuroNet::learn()
-        void setLinkLearnRate(const NeuroCell::Value & learn) { _link_learn_rate = learn; }
+        void setLinkLearnRate(const NeuroCell::Value & learn) { _link_learn_rate = learn; _arrays.activateAll(); }
 
         NeuroCell::Value nodeLearnRate() const { return _node_learn_rate; }
-        void setNodeLearnRate(const NeuroCell::Value & rate) { _node_learn_rate = rate; }
+        void setNodeLearnRate(const NeuroCell::Value & rate) { _node_learn_rate = rate; _arrays.activateAll(); }
 
         NeuroCell::Value nodeForgetRate() const { return _node_forget_rate; }
-        void setNodeForgetRate(const NeuroCell::Value & rate) { _node_forget_rate = rate; }
+        void setNodeForgetRate(const NeuroCell::Value & rate) { _node_forget_rate = rate; _arrays.activateAll(); }
 
         /// This is the number of timesteps for which a cell's running average is calculated, for the purposes of Hebbian learning.
         /// \see NeuroNet::setLearnTime()
@@ -90,32 +164,226 @@ namespace NeuroLib
 
         /// Sets the number of timesteps for which a cell's running average is calculated.
         /// \see NeuroNet::learnTime()
-        void setLearnTime(const NeuroCell::Value & learnTime) { _learn_time = learnTime; }
+        void setLearnTime(const NeuroCell::Value & learnTime) { _learn_time = learnTime; _arrays.activateAll(); }
 
         struct PostUpdateRec
         {
             NeuroCell::Index _index;
             NeuroCell::Value _weight;
 
+            PostUpdateRec()
+                : _index(-1), _weight(0)
+            {
+            }
+
             PostUpdateRec(const NeuroCell::Index & index, const NeuroCell::Value & weight)
                 : _index(index), _weight(weight)
             {
             }
         };
 
+        /// Records a change to a link's weight, to be made by NeuroNet::postUpdate() once the step is done.
+        /// Each thread appends to its own buffer, so stepping threads do not contend for a lock.
         void addPostUpdate(const PostUpdateRec &);
 
+        /// \return Whether NeuroNet::postUpdate() sorts the post-updates by cell index before applying them.
+        /// \see NeuroNet::setSortPostUpdates()
+        bool sortPostUpdates() const { return _sort_post_updates; }
+
+        /// Sets whether NeuroNet::postUpdate() sorts the post-updates by cell index before applying them,
+        /// for better locality of the writes on large networks.  Updates to the same cell from the same thread stay in order.
+        /// \see NeuroNet::sortPostUpdates()
+        void setSortPostUpdates(const bool & sort) { _sort_post_updates = sort; }
+
         void preUpdate();
+
+        /// Applies the post-updates recorded during a step.  At the end of each timestep (every
+        /// NeuroNet::passesPerStep() calls), also advances NeuroNet::timestep() and samples the network's probes.
         void postUpdate();
 
+        /// \return The number of timesteps completed since the network was loaded or restored.
+        /// \see NeuroNet::setTimestep()
+        quint64 timestep() const { return _timestep; }
+
+        /// Sets the number of timesteps completed, e.g. when the network is restored from a checkpoint.
+        /// \note Call only between timesteps.
+        /// \see NeuroNet::timestep()
+        void setTimestep(const quint64 & timestep) { _timestep = timestep; _pass = 0; }
+
+        /// Adds a probe, which will be sampled at the end of every NeuroProbe::stride() timesteps by the thread that calls NeuroNet::postUpdate().
+        /// The network does not take ownership of the probe.
+        /// \note Call only between steps.
+        void addProbe(NeuroProbe *probe);
+
+        /// Removes a probe from the network.
+        /// \note Call only between steps.
+        void removeProbe(NeuroProbe *probe);
+
+        //@{
+        /// Override the automaton's versions, so that the network's storage mode is used
+        /// even through a pointer or reference to the automaton or the graph.
+        virtual void step();
+        virtual void stepInThread();
+        virtual QFuture<void> stepAsync();
+        virtual NeuroCell::Index addNode(const NeuroCell & cell);
+        virtual QVector<NeuroCell::Index> addNodes(const QVector<NeuroCell> & cells);
+        virtual NeuroCell::Index addTiles(const QVector<NeuroCell> & cells, const Automata::Tiling & tiling);
+        virtual QVector<NeuroCell::Index> resizeTiles(const NeuroCell::Index & tiled, const int & num_cols, const int & num_rows, const QVector<NeuroCell> & pattern);
+        virtual void clear();
+        virtual int readyState(const NeuroCell::Index & index) const;
+        //@}
+
+        /// Access a cell in the network.
+        /// In NeuroNet::ARRAY_STORAGE mode, the copy is built from the arrays; the network is left as it is,
+        /// so this is safe to call while a step is running ahead.
+        virtual ASYNC_STATE operator[] (const NeuroCell::Index & index) const;
+
+        /// Access a cell in the network.
+        /// In NeuroNet::ARRAY_STORAGE mode, the cell is first brought up to date from the arrays,
+        /// and any changes made to it are copied back into the arrays before the next step.
+        virtual ASYNC_STATE & operator[] (const NeuroCell::Index & index);
+
         virtual void writeBinary(QDataStream & ds, const Automata::AutomataFileVersion & file_version) const;
         virtual void readBinary(QDataStream & ds, const Automata::AutomataFileVersion & file_version);
 
+        /// The size in bytes of a cell's record as written by NeuroNet::writeCellRecords(): both states and the ready state, padded to a multiple of 4.
+        static const int CELL_RECORD_SIZE = 2 * NeuroCell::RECORD_SIZE + 4;
+
+        /// Writes the complete states of a range of cells as fixed-width, little-endian records of NeuroNet::CELL_RECORD_SIZE bytes.
+        /// Cells held in the arrays are written straight from them, so the cells are neither brought up to date nor written to,
+        /// and the stepping thread may call this while the GUI thread reads cells.
+        /// \note Call only between steps.
+        void writeCellRecords(uchar *data, const int & begin, const int & end) const;
+
+        /// Sets the states of a range of cells from records written by NeuroNet::writeCellRecords().
+        /// \note Call only between steps.
+        void readCellRecords(const uchar *data, const int & begin, const int & end);
+
+        /// \return An estimate of the number of bytes taken by the network's cells, edges and arrays.
+        virtual qint64 memoryUsed() const;
+
         void dumpGraph(QTextStream & ts, bool reverse);
 
+    protected:
+        /// \return The number of steps already done in the current timestep.
+        virtual int stepPhase() const { return _pass; }
+
     private:
+        /// Writes the graph in the mappable layout of Automata::AUTOMATA_FILE_VERSION_4.
+        void writeMappable(QDataStream & ds) const;
+
+        /// Reads the graph in the mappable layout of Automata::AUTOMATA_FILE_VERSION_4.
+        /// If the stream is reading a file, the cells and edges are decoded straight from a memory map of it.
+        void readMappable(QDataStream & ds);
+
+        /// The number of nodes in each block of the compressed layout.
+        static const int COMPRESSED_BLOCK_SIZE = 16384;
+
+        /// Writes the graph in the compressed layout of Automata::AUTOMATA_FILE_VERSION_5.
+        void writeCompressed(QDataStream & ds) const;
+
+        /// Reads the graph in the compressed layout of Automata::AUTOMATA_FILE_VERSION_5.
+        void readCompressed(QDataStream & ds);
+
+        /// Threads with indices below this get their own post-update buffer; any others share \c _postUpdates.
+        static const int NUM_POST_UPDATE_BUFFERS = 64;
+
+        /// A thread's post-updates; padded so that different threads' buffers don't share a cache line.
+        struct PostUpdateBuffer
+        {
+            QVector<PostUpdateRec> recs;
+            char _pad[64 - sizeof(QVector<PostUpdateRec>)];
+        };
+
+        PostUpdateBuffer _post_update_buffers[NUM_POST_UPDATE_BUFFERS];
+        bool _sort_post_updates;
+
         QList<PostUpdateRec> _postUpdates;
         QReadWriteLock _postUpdatesLock;
+
+        /// Sets the weight of a cell, wherever its state currently is.
+        void applyPostUpdate(const PostUpdateRec & rec);
+
+        quint64 _timestep;
+        int _pass;                                 ///< The number of steps done in the current timestep.
+        QList<NeuroProbe *> _probes;
+
+        /// Writes a sample of each probe that is due into its ring buffer.
+        void sampleProbes();
+
+        StorageMode _storage_mode;
+        StepMode _step_mode;
+        bool _vector_kernels;
+        bool _active_set;
+        bool _compress_files;
+        NeuroArrays _arrays;
+        bool _arrays_valid;                        ///< Whether the arrays hold the cells' states.
+        QBitArray _cells_changed;                  ///< Cells that may have been changed through NeuroNet::operator[]() since the last step.
+        QVector<NeuroCell::Index> _changed_cells;  ///< The indices of the set bits in \c _cells_changed.
+
+        /// \return Whether the arrays hold the most recent state of a cell.
+        bool cellInArrays(const NeuroCell::Index & index) const
+        {
+            return _arrays_valid && !(index < _cells_changed.size() && _cells_changed.testBit(index));
+        }
+
+        /// Notes that a cell may have been changed outside the arrays.
+        void markCellChanged(const NeuroCell::Index & index);
+
+        /// Discards the arrays; the cells hold the network's state until the next step.
+        void resetArrays();
+
+        /// Brings the arrays up to date with the cells, before a step.
+        void syncArrays();
+
+        /// Brings the cells up to date with the arrays.
+        void syncCells();
+
+        /// \return Whether the step only updates the cells scheduled by NeuroArrays::beginActiveStep().
+        bool activeStepping() const { return _active_set && _step_mode == SYNCHRONOUS_STEP; }
+
+        /// Schedules the cells for an active-set step, before the step.  If the edges have changed since the last one, schedules all the cells.
+        void beginActiveStep();
+
+        /// Steps the arrays in parallel on the step pool, blocking until all the cells are done.
+        void stepArrays();
+
+        /// \internal Updates a range of cells in the arrays for the step pool.
+        struct ArrayTask
+            : public Automata::StepPool::Task
+        {
+            NeuroNet & network;
+
+            ArrayTask(NeuroNet & network) : network(network) {}
+
+            virtual void run(const int & begin, const int & end)
+            {
+                if (network._step_mode == SYNCHRONOUS_STEP)
+                {
+                    if (network._active_set)
+                        network._arrays.updateSyncActive(&network, begin, end);
+                    else
+                        network._arrays.updateSync(&network, begin, end);
+
+                    if (network.profiling())
+                        network.addStepCounts(end - begin, 0);
+                }
+                else
+                {
+                    int updated = 0;
+                    for (NeuroCell::Index i = begin; i < end; ++i)
+                    {
+                        if (network._arrays.update(&network, i))
+                            ++updated;
+                    }
+
+                    if (network.profiling())
+                        network.addStepCounts(updated, (end - begin) - updated);
+                }
+            }
+        };
+
+        ArrayTask _array_task;
     };
 
 } // namespace NeuroLib
@@ -0,0 +1,131 @@
+/*
+Neurocognitive Linguistics Lab
+Copyright (c) 2010,2011 Gordon Tisher
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+ - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+ - Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in
+   the documentation and/or other materials provided with the
+   distribution.
+
+ - Neither the name of the Neurocognitive Linguistics Lab nor the
+   names of its contributors may be used to endorse or promote
+   products derived from this software without specific prior
+   written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "neuroprobe.h"
+
+#include <cstring>
+
+namespace NeuroLib
+{
+
+    const int NeuroProbe::DEFAULT_CAPACITY;
+
+    // the positions of the front and back of the ring wrap around, so the distance between them is taken as unsigned;
+    // the capacity is a power of two, so a position's slot doesn't jump when it wraps
+
+    static inline uint distance(const int & front, const int & back)
+    {
+        return static_cast<uint>(back) - static_cast<uint>(front);
+    }
+
+    static inline int advance(const int & pos)
+    {
+        return static_cast<int>(static_cast<uint>(pos) + 1);
+    }
+
+    NeuroProbe::NeuroProbe(const QVector<NeuroCell::Index> & cells, const int & stride, const int & quantities, const int & capacity)
+        : _cells(cells),
+          _stride(qMax(stride, 1)),
+          _quantities(quantities & (OUTPUT_VALUE | RUNNING_AVERAGE)),
+          _sample_size(0),
+          _capacity(1),
+          _back(0),
+          _front(0),
+          _dropped(0)
+    {
+        if (_quantities == 0)
+            _quantities = OUTPUT_VALUE;
+
+        const int per_cell = ((_quantities & OUTPUT_VALUE) ? 1 : 0) + ((_quantities & RUNNING_AVERAGE) ? 1 : 0);
+        _sample_size = _cells.size() * per_cell;
+
+        while (_capacity < capacity && _capacity < (1 << 30))
+            _capacity <<= 1;
+
+        _values.resize(_capacity * _sample_size);
+        _timesteps.resize(_capacity);
+    }
+
+    int NeuroProbe::available() const
+    {
+        // the acquire pairs with the writer's release, so the sample is in place before we see it
+        const int back = _back.fetchAndAddAcquire(0);
+        return static_cast<int>(distance(_front, back));
+    }
+
+    bool NeuroProbe::read(quint64 & timestep, NeuroCell::Value *values)
+    {
+        const int front = _front;
+        const int back = _back.fetchAndAddAcquire(0);
+
+        if (distance(front, back) == 0)
+            return false;
+
+        const int slot = static_cast<int>(static_cast<uint>(front) & (_capacity - 1));
+
+        timestep = _timesteps[slot];
+        ::memcpy(values, _values.constData() + slot * _sample_size, _sample_size * sizeof(NeuroCell::Value));
+
+        // the release makes sure we're done with the slot before the writer can reuse it
+        _front.fetchAndStoreRelease(advance(front));
+        return true;
+    }
+
+    NeuroCell::Value *NeuroProbe::beginSample()
+    {
+        const int back = _back;
+        const int front = _front.fetchAndAddAcquire(0);
+
+        if (distance(front, back) >= static_cast<uint>(_capacity))
+        {
+            _dropped.fetchAndAddRelaxed(1);
+            return 0;
+        }
+
+        const int slot = static_cast<int>(static_cast<uint>(back) & (_capacity - 1));
+        return _values.data() + slot * _sample_size;
+    }
+
+    void NeuroProbe::endSample(const quint64 & timestep)
+    {
+        const int back = _back;
+        const int slot = static_cast<int>(static_cast<uint>(back) & (_capacity - 1));
+
+        _timesteps[slot] = timestep;
+        _back.fetchAndStoreRelease(advance(back));
+    }
+
+} // namespace NeuroLib
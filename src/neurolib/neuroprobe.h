@@ -0,0 +1,133 @@
+#ifndef NEUROPROBE_H
+#define NEUROPROBE_H
+
+/*
+Neurocognitive Linguistics Lab
+Copyright (c) 2010,2011 Gordon Tisher
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+ - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+ - Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in
+   the documentation and/or other materials provided with the
+   distribution.
+
+ - Neither the name of the Neurocognitive Linguistics Lab nor the
+   names of its contributors may be used to endorse or promote
+   products derived from this software without specific prior
+   written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "neurolib_global.h"
+#include "neurocell.h"
+
+#include <QVector>
+#include <QAtomicInt>
+
+namespace NeuroLib
+{
+
+    class NeuroNet;
+
+    /// Records the values of a set of cells at the end of every few timesteps, for cells that have no item in the GUI
+    /// to record them.  Add the probe to a network with NeuroNet::addProbe(); the thread that steps the network
+    /// writes each sample into a ring buffer that is allocated up front, and another thread drains it with NeuroProbe::read().
+    /// Neither thread waits for the other: with one writer and one reader, the ring only needs the atomic positions
+    /// of its front and back.  If the reader falls behind and the ring fills up, samples are dropped rather than
+    /// holding up the network; see NeuroProbe::dropped().
+    class NEUROLIBSHARED_EXPORT NeuroProbe
+    {
+    public:
+        /// The values a probe records for each cell.
+        enum Quantity
+        {
+            OUTPUT_VALUE = 1,   ///< NeuroCell::outputValue()
+            RUNNING_AVERAGE = 2 ///< NeuroCell::runningAverage()
+        };
+
+        /// The default number of samples a probe's ring buffer holds.
+        static const int DEFAULT_CAPACITY = 1024;
+
+        /// Constructor.
+        /// \param cells The indices of the cells to record.
+        /// \param stride The number of timesteps between samples.
+        /// \param quantities A combination of NeuroProbe::Quantity flags.
+        /// \param capacity The number of samples the ring buffer holds; rounded up to a power of two.
+        explicit NeuroProbe(const QVector<NeuroCell::Index> & cells, const int & stride = 1,
+                            const int & quantities = OUTPUT_VALUE, const int & capacity = DEFAULT_CAPACITY);
+
+        const QVector<NeuroCell::Index> & cells() const { return _cells; }
+        int stride() const { return _stride; }
+        int quantities() const { return _quantities; }
+
+        /// \return The number of values in a sample: one for each quantity of each cell, grouped by cell.
+        int sampleSize() const { return _sample_size; }
+
+        /// \return The number of samples the ring buffer holds.
+        int capacity() const { return _capacity; }
+
+        /// \return The number of samples waiting to be read.
+        /// \note Call only from the reading thread.
+        int available() const;
+
+        /// Takes the oldest sample from the ring buffer.
+        /// \param timestep Set to the network's timestep at the end of which the sample was taken.
+        /// \param values Filled with NeuroProbe::sampleSize() values.
+        /// \return False if there is no sample waiting.
+        /// \note Call only from the reading thread.
+        bool read(quint64 & timestep, NeuroCell::Value *values);
+
+        /// \return The number of samples dropped because the ring buffer was full.
+        int dropped() const { return _dropped; }
+
+    private:
+        friend class NeuroNet;
+
+        /// \return The slot in which to write the next sample, or 0 if the ring buffer is full.
+        NeuroCell::Value *beginSample();
+
+        /// Publishes the sample written into the slot returned by NeuroProbe::beginSample().
+        void endSample(const quint64 & timestep);
+
+        QVector<NeuroCell::Index> _cells;
+        int _stride;
+        int _quantities;
+        int _sample_size;
+        int _capacity;
+
+        QVector<NeuroCell::Value> _values;
+        QVector<quint64> _timesteps;
+
+        /// Incremented by the writer once a sample is in place; wraps around.
+        mutable QAtomicInt _back;
+        char _pad_back[64 - sizeof(QAtomicInt)];
+
+        /// Incremented by the reader once it has copied a sample out; wraps around.
+        mutable QAtomicInt _front;
+        char _pad_front[64 - sizeof(QAtomicInt)];
+
+        QAtomicInt _dropped;
+    }; // class NeuroProbe
+
+} // namespace NeuroLib
+
+#endif // NEUROPROBE_H
@@ -0,0 +1,519 @@
+/*
+Neurocognitive Linguistics Lab
+Copyright (c) 2010,2011 Gordon Tisher
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+ - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+ - Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in
+   the documentation and/or other materials provided with the
+   distribution.
+
+ - Neither the name of the Neurocognitive Linguistics Lab nor the
+   names of its contributors may be used to endorse or promote
+   products derived from this software without specific prior
+   written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "../common/exception.h"
+#include "../automata/steppool.h"
+#include "../neurolib/neuronet.h"
+#include "../neurolib/neurocheckpoint.h"
+#include "../neurolib/neuroprobe.h"
+
+#include <QCoreApplication>
+#include <QStringList>
+#include <QFile>
+#include <QTextStream>
+#include <QTime>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QtConcurrentRun>
+
+#include <cstdio>
+
+using namespace NeuroLib;
+
+static const char *USAGE =
+    "Usage: neurolab-run [options] network.nnn|network.nln\n"
+    "Loads a network, steps it, and reports the time taken.\n"
+    "\n"
+    "  -n, --steps N         Number of timesteps to run (default 1).\n"
+    "  -t, --threads N       Number of threads to step with, including the main thread\n"
+    "                        (default: the number of cores).\n"
+    "  -c, --chunk N         Number of cells a thread updates at a time.\n"
+    "      --sync            Use the synchronous step mode.\n"
+    "      --vector          Use the vectorised kernels (with --sync).\n"
+    "      --active-set      Only update the cells whose state or inputs changed (with --sync).\n"
+    "      --cell-storage    Step the cells directly rather than in arrays.\n"
+    "      --set NAME=VALUE  Set a network parameter: decay, link-learn-rate,\n"
+    "                        node-learn-rate, node-forget-rate or learn-time.\n"
+    "  -o, --output FILE     Write the stepped network to FILE (.nnn format).\n"
+    "      --compress        Write the output file in the compressed layout.\n"
+    "      --values FILE     Write the cells' values to FILE as tab-separated text.\n"
+    "      --checkpoint FILE Write checkpoints of the cells to FILE (.nnc format).\n"
+    "      --checkpoint-every N\n"
+    "                        Number of timesteps between checkpoints (default 100).\n"
+    "      --resume FILE     Restore the cells from a checkpoint file, and run only\n"
+    "                        the timesteps that remain.\n"
+    "      --probe FILE      Write the values of some cells after each timestep to FILE\n"
+    "                        as tab-separated text, while the network runs.\n"
+    "      --probe-cells LIST\n"
+    "                        The cells to probe, e.g. 0-99,250 (default: all).\n"
+    "      --probe-every N   Number of timesteps between probe samples (default 1).\n"
+    "      --probe-average   Also write the cells' running averages.\n"
+    "  -q, --quiet           Don't print the timing.\n"
+    "  -h, --help            Show this message.\n";
+
+/// The options given on the command line.
+struct RunOptions
+{
+    QString network_fname;
+    QString output_fname;
+    QString values_fname;
+    QString checkpoint_fname;
+    QString resume_fname;
+    QString probe_fname;
+    QString probe_cells;
+    int probe_every;
+    bool probe_average;
+    int checkpoint_every;
+    int steps;
+    int threads;
+    int chunk;
+    bool sync;
+    bool vector;
+    bool active_set;
+    bool cell_storage;
+    bool compress;
+    bool quiet;
+    QList<QPair<QString, float> > params;
+
+    RunOptions()
+        : probe_every(1), probe_average(false), checkpoint_every(100), steps(1), threads(0), chunk(0), sync(false), vector(false), active_set(false), cell_storage(false), compress(false), quiet(false)
+    {
+    }
+};
+
+static int toInt(const QString & arg, const QString & value)
+{
+    bool ok;
+    int result = value.toInt(&ok);
+    if (!ok || result < 0)
+        throw Common::Exception(QObject::tr("Invalid value for %1: %2").arg(arg).arg(value));
+    return result;
+}
+
+/// Parses the command line.
+/// \return False if the usage should be shown.
+static bool parseArguments(const QStringList & args, RunOptions & options)
+{
+    for (int i = 1; i < args.size(); ++i)
+    {
+        const QString & arg = args[i];
+
+        if (arg == "-h" || arg == "--help")
+            return false;
+        else if (arg == "--sync")
+            options.sync = true;
+        else if (arg == "--vector")
+            options.vector = true;
+        else if (arg == "--active-set")
+            options.active_set = true;
+        else if (arg == "--cell-storage")
+            options.cell_storage = true;
+        else if (arg == "--compress")
+            options.compress = true;
+        else if (arg == "--probe-average")
+            options.probe_average = true;
+        else if (arg == "-q" || arg == "--quiet")
+            options.quiet = true;
+        else if (arg.startsWith("-"))
+        {
+            if (i + 1 >= args.size())
+                throw Common::Exception(QObject::tr("Missing value for %1").arg(arg));
+
+            const QString & value = args[++i];
+
+            if (arg == "-n" || arg == "--steps")
+                options.steps = toInt(arg, value);
+            else if (arg == "-t" || arg == "--threads")
+                options.threads = toInt(arg, value);
+            else if (arg == "-c" || arg == "--chunk")
+                options.chunk = toInt(arg, value);
+            else if (arg == "-o" || arg == "--output")
+                options.output_fname = value;
+            else if (arg == "--values")
+                options.values_fname = value;
+            else if (arg == "--checkpoint")
+                options.checkpoint_fname = value;
+            else if (arg == "--checkpoint-every")
+                options.checkpoint_every = qMax(toInt(arg, value), 1);
+            else if (arg == "--resume")
+                options.resume_fname = value;
+            else if (arg == "--probe")
+                options.probe_fname = value;
+            else if (arg == "--probe-cells")
+                options.probe_cells = value;
+            else if (arg == "--probe-every")
+                options.probe_every = qMax(toInt(arg, value), 1);
+            else if (arg == "--set")
+            {
+                int eq = value.indexOf("=");
+                bool ok = eq > 0;
+                float f = ok ? value.mid(eq + 1).toFloat(&ok) : 0;
+                if (!ok)
+                    throw Common::Exception(QObject::tr("Invalid parameter setting: %1").arg(value));
+                options.params.append(qMakePair(value.left(eq), f));
+            }
+            else
+            {
+                throw Common::Exception(QObject::tr("Unknown option: %1").arg(arg));
+            }
+        }
+        else if (options.network_fname.isEmpty())
+        {
+            options.network_fname = arg;
+        }
+        else
+        {
+            throw Common::Exception(QObject::tr("Only one network can be run at a time."));
+        }
+    }
+
+    return !options.network_fname.isEmpty();
+}
+
+static void setParameter(NeuroNet & network, const QString & name, const float & value)
+{
+    if (name == "decay")
+        network.setDecay(value);
+    else if (name == "link-learn-rate")
+        network.setLinkLearnRate(value);
+    else if (name == "node-learn-rate")
+        network.setNodeLearnRate(value);
+    else if (name == "node-forget-rate")
+        network.setNodeForgetRate(value);
+    else if (name == "learn-time")
+        network.setLearnTime(value);
+    else
+        throw Common::Exception(QObject::tr("Unknown network parameter: %1").arg(name));
+}
+
+/// Loads a network.  A LabNetwork file (.nln) is run from its corresponding NeuroNet file (.nnn).
+static void loadNetwork(NeuroNet & network, const QString & fname)
+{
+    QString nnn_fname = fname;
+    if (nnn_fname.endsWith(".nln", Qt::CaseInsensitive))
+        nnn_fname = nnn_fname.left(nnn_fname.length() - 4) + ".nnn";
+
+    QFile file(nnn_fname);
+    if (!file.open(QIODevice::ReadOnly))
+        throw Common::IOError(QObject::tr("Unable to open network file %1.").arg(nnn_fname));
+
+    QDataStream ds(&file);
+    ds.setVersion(QDataStream::Qt_4_6);
+
+    Automata::AutomataFileVersion fv;
+    network.readBinary(ds, fv);
+
+    if (ds.status() != QDataStream::Ok)
+        throw Common::FileFormatError(QObject::tr("Network file %1 is truncated or corrupt.").arg(nnn_fname));
+}
+
+static void saveNetwork(const NeuroNet & network, const QString & fname)
+{
+    QFile file(fname);
+    if (!file.open(QIODevice::WriteOnly))
+        throw Common::IOError(QObject::tr("Unable to write network file %1.").arg(fname));
+
+    QDataStream ds(&file);
+    ds.setVersion(QDataStream::Qt_4_6);
+
+    Automata::AutomataFileVersion fv;
+    network.writeBinary(ds, fv);
+}
+
+static void saveValues(const NeuroNet & network, const QString & fname)
+{
+    QFile file(fname);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+        throw Common::IOError(QObject::tr("Unable to write values file %1.").arg(fname));
+
+    QTextStream ts(&file);
+    ts << "index\tkind\toutput\taverage\tweight\n";
+
+    const int num = network.size();
+    for (int i = 0; i < num; ++i)
+    {
+        const NeuroCell cell = network[i].current();
+        ts << i << "\t" << static_cast<int>(cell.kind()) << "\t" << cell.outputValue() << "\t" << cell.runningAverage() << "\t";
+        if (cell.kind() == NeuroCell::OSCILLATOR)
+            ts << "-\n";
+        else
+            ts << cell.weight() << "\n";
+    }
+}
+
+/// Parses a list of cell indices and ranges of them, such as \c 0-99,250.  An empty list means all the cells.
+static QVector<NeuroCell::Index> parseCells(const QString & list, const int & num_cells)
+{
+    QVector<NeuroCell::Index> cells;
+
+    if (list.isEmpty())
+    {
+        for (int i = 0; i < num_cells; ++i)
+            cells.append(i);
+        return cells;
+    }
+
+    foreach (const QString & item, list.split(",", QString::SkipEmptyParts))
+    {
+        const int dash = item.indexOf("-");
+        const int first = toInt("--probe-cells", dash > 0 ? item.left(dash) : item);
+        const int last = dash > 0 ? toInt("--probe-cells", item.mid(dash + 1)) : first;
+
+        if (last >= num_cells)
+            throw Common::Exception(QObject::tr("Probed cell %1 is not in the network.").arg(last));
+
+        for (int i = first; i <= last; ++i)
+            cells.append(i);
+    }
+
+    return cells;
+}
+
+/// Writes a probe's samples to a file in a background thread, while the network steps.
+class ProbeWriter
+{
+    /// How long the writer sleeps when it has caught up with the network.
+    static const int DRAIN_MSECS = 10;
+
+    NeuroProbe & _probe;
+    QFile _file;
+    QFuture<void> _future;
+
+    QAtomicInt _done;
+    QMutex _mutex;
+    QWaitCondition _wake;
+
+public:
+    ProbeWriter(NeuroProbe & probe, const QString & fname)
+        : _probe(probe), _file(fname), _done(0)
+    {
+        if (!_file.open(QIODevice::WriteOnly | QIODevice::Text))
+            throw Common::IOError(QObject::tr("Unable to write probe file %1.").arg(fname));
+
+        _future = QtConcurrent::run(this, &ProbeWriter::drain);
+    }
+
+    /// Writes the samples that remain, and closes the file.
+    void finish()
+    {
+        _done.fetchAndStoreRelease(1);
+
+        {
+            QMutexLocker lock(&_mutex);
+            _wake.wakeAll();
+        }
+
+        _future.waitForFinished();
+        _file.close();
+    }
+
+private:
+    void drain()
+    {
+        QTextStream ts(&_file);
+
+        const bool output = (_probe.quantities() & NeuroProbe::OUTPUT_VALUE) != 0;
+        const bool average = (_probe.quantities() & NeuroProbe::RUNNING_AVERAGE) != 0;
+
+        ts << "timestep";
+        foreach (const NeuroCell::Index & index, _probe.cells())
+        {
+            if (output)
+                ts << "\toutput" << index;
+            if (average)
+                ts << "\taverage" << index;
+        }
+        ts << "\n";
+
+        QVector<NeuroCell::Value> values(_probe.sampleSize());
+        quint64 timestep;
+
+        forever
+        {
+            // check before reading, so that the samples taken before finish() was called are all written
+            const bool done = _done.fetchAndAddAcquire(0) != 0;
+
+            while (_probe.read(timestep, values.data()))
+            {
+                ts << timestep;
+                for (int i = 0; i < values.size(); ++i)
+                    ts << "\t" << values[i];
+                ts << "\n";
+            }
+
+            if (done)
+                break;
+
+            QMutexLocker lock(&_mutex);
+            if (_done.fetchAndAddAcquire(0) == 0)
+                _wake.wait(&_mutex, DRAIN_MSECS);
+        }
+
+        ts.flush();
+    }
+};
+
+static int run(const RunOptions & options)
+{
+    NeuroNet network;
+    loadNetwork(network, options.network_fname);
+
+    int first_step = 0;
+    if (!options.resume_fname.isEmpty())
+    {
+        first_step = static_cast<int>(qMin(NeuroCheckpoint::restore(options.resume_fname, network), static_cast<quint64>(options.steps)));
+        if (!options.quiet)
+            printf("%s: resuming at timestep %d\n", qPrintable(options.network_fname), first_step);
+    }
+
+    for (int i = 0; i < options.params.size(); ++i)
+        setParameter(network, options.params[i].first, options.params[i].second);
+
+    network.setStorageMode(options.cell_storage ? NeuroNet::CELL_STORAGE : NeuroNet::ARRAY_STORAGE);
+    network.setStepMode(options.sync ? NeuroNet::SYNCHRONOUS_STEP : NeuroNet::ASYNCHRONOUS_STEP);
+    network.setVectorKernels(options.vector);
+    network.setActiveSet(options.active_set);
+    network.setCompressFiles(options.compress);
+    if (options.chunk > 0)
+        network.setCellsPerChunk(options.chunk);
+
+    Automata::StepPool pool(options.threads);
+    network.setStepPool(&pool);
+
+    const int passes = network.passesPerStep();
+
+    NeuroCheckpoint *checkpoint = options.checkpoint_fname.isEmpty() ? 0 : new NeuroCheckpoint(options.checkpoint_fname);
+
+    NeuroProbe *probe = 0;
+    ProbeWriter *probe_writer = 0;
+    if (!options.probe_fname.isEmpty())
+    {
+        // keep about 16 MB of samples in hand, in case the writer falls behind
+        const QVector<NeuroCell::Index> cells = parseCells(options.probe_cells, network.size());
+        const int quantities = NeuroProbe::OUTPUT_VALUE | (options.probe_average ? NeuroProbe::RUNNING_AVERAGE : 0);
+        const int per_sample = qMax(cells.size() * (options.probe_average ? 2 : 1), 1);
+
+        probe = new NeuroProbe(cells, options.probe_every, quantities, qMax((4 << 20) / per_sample, static_cast<int>(NeuroProbe::DEFAULT_CAPACITY)));
+        network.addProbe(probe);
+        probe_writer = new ProbeWriter(*probe, options.probe_fname);
+    }
+
+    QTime timer;
+    timer.start();
+
+    for (int s = first_step; s < options.steps; ++s)
+    {
+        for (int p = 0; p < passes; ++p)
+        {
+            network.preUpdate();
+            network.step();
+            network.postUpdate();
+        }
+
+        if (checkpoint && (s + 1) % options.checkpoint_every == 0)
+            checkpoint->take(network, s + 1);
+    }
+
+    const int msecs = timer.elapsed();
+    const int num_steps = options.steps - first_step;
+
+    if (checkpoint)
+    {
+        checkpoint->waitForFinished();
+        delete checkpoint;
+    }
+
+    if (probe)
+    {
+        probe_writer->finish();
+        delete probe_writer;
+
+        network.removeProbe(probe);
+        if (probe->dropped() > 0)
+            fprintf(stderr, "%s: %d probe samples were dropped because the file could not be written fast enough\n",
+                    qPrintable(options.network_fname), probe->dropped());
+        delete probe;
+    }
+
+    if (!options.quiet)
+    {
+        double secs = msecs / 1000.0;
+        printf("%s: %d steps of %d cells in %.3f s (%.1f steps/s, %.3g cell updates/s) on %d threads\n",
+               qPrintable(options.network_fname), num_steps, network.size(), secs,
+               secs > 0 ? num_steps / secs : 0.0,
+               secs > 0 ? static_cast<double>(num_steps) * network.size() / secs : 0.0,
+               pool.numThreads());
+    }
+
+    if (!options.output_fname.isEmpty())
+        saveNetwork(network, options.output_fname);
+    if (!options.values_fname.isEmpty())
+        saveValues(network, options.values_fname);
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication application(argc, argv);
+
+    try
+    {
+        RunOptions options;
+        if (!parseArguments(application.arguments(), options))
+        {
+            fputs(USAGE, stderr);
+            return 2;
+        }
+
+        return run(options);
+    }
+    catch (Common::Exception & e)
+    {
+        fprintf(stderr, "neurolab-run: %s\n", qPrintable(e.message()));
+    }
+    catch (std::exception & se)
+    {
+        fprintf(stderr, "neurolab-run: %s\n", se.what());
+    }
+    catch (...)
+    {
+        fprintf(stderr, "neurolab-run: unknown error\n");
+    }
+
+    return 1;
+}
@@ -0,0 +1,43 @@
+CONFIG += debug_and_release
+CONFIG += console
+CONFIG -= app_bundle
+QT -= gui
+
+TARGET = neurolab-run
+TEMPLATE = app
+
+include(../version.txt)
+
+SOURCES += main.cpp
+
+CONFIG(release, debug|release) { BUILDDIR=release }
+CONFIG(debug, debug|release) {
+    BUILDDIR=debug
+    DEFINES += DEBUG
+}
+
+DESTDIR = $$OUT_PWD/../$$BUILDDIR
+TEMPDIR = $$OUT_PWD/$$BUILDDIR
+
+OBJECTS_DIR = $$TEMPDIR
+MOC_DIR = $$TEMPDIR
+UI_DIR = $$TEMPDIR
+RCC_DIR = $$TEMPDIR
+
+win32 {
+    LIBS += -L$$DESTDIR \
+        -lcommon1 \
+        -lneurolib1 \
+        -lautomata1
+} else:macx {
+    QMAKE_LFLAGS += -F$$DESTDIR/neurolab.app/Contents/Frameworks
+    LIBS += \
+        -framework common \
+        -framework neurolib \
+        -framework automata
+} else {
+    LIBS += -L$$DESTDIR \
+        -lcommon \
+        -lneurolib \
+        -lautomata
+}